@@ -1,108 +1,150 @@
 #include "body.h"
-#include "path.h"
+#include "sceneloader.h"
 
 #include <cmath>
-#include <QSettings>
-#include <QStringList>
+#include <QMap>
 #include <QImage>
-#include <QtMath>
 
 int Body::ObjectID(0);
 bool Body::ShowAxis(false);
 bool Body::ShowOrbit(true);
+bool Body::ShowTrail(false);
 float Body::PointSizeThreshold(10.0);
+LabelBatch *Body::Labels(0);
+PointBatch *Body::Points(0);
+OrbitBatch *Body::Orbits(0);
+KeplerBatch *Body::SmallBodies(0);
+TrailBatch *Body::Trails(0);
+NBodyIntegrator *Body::Integrator(0);
+
+// The scene loader prepares every body of the catalog, anything else is a bug
+static const BodyResources &resourcesOf(const BodyDescriptor &descriptor, const SceneLoader &scene)
+{
+    const BodyResources *resources = scene.resources(descriptor.name);
+    if (!resources)
+        qFatal("%s was not prepared by the scene loader", qPrintable(descriptor.name));
+    return *resources;
+}
 
-Body::Body(const QString &name, QObject *parent)
+Body::Body(const BodyDescriptor &descriptor, const SceneLoader &scene, QObject *parent)
     : QObject(parent)
-    , m_name(name)
+    , m_name(descriptor.name)
     , m_objectId(++ObjectID)
     , m_radius(0.0)
     , m_boundingRadius(0.0)
+    , m_lightRadius(0.0)
     , m_sphere(0)
     , m_ring(0)
+    , m_atmosphere(0)
     , m_orbit(0)
+    , m_orbitLine(-1)
+    , m_smallBodies(-1)
+    , m_trail(-1)
+    , m_integratorIndex(-1)
     , m_axis(0)
-    , m_pointObject(0)
     , m_onScreenRadius(0)
     , m_onScreenDistanceToParent(-1)
-    , m_text(0)
+    , m_label(-1)
+    , m_point(-1)
     , m_flare(0)
-    , m_root(0)
+    , m_root(dynamic_cast<Body*>(parent))
+    , m_motion(descriptor, m_root != 0, resourcesOf(descriptor, scene).ephemeris)
     , m_texture(0)
     , m_nightTexture(0)
     , m_ringTexture(0)
 {
-    float unitcoeff = 1.0;
     initializeOpenGLFunctions();
 
-    m_root = dynamic_cast<Body*>(parent);
+    const BodyResources &resources = resourcesOf(descriptor, scene);
 
-    QSettings data(resPath()+"data/data.txt", QSettings::IniFormat);
-    data.beginGroup(name);
+    m_texture = loadTexture(resources.texture);
+    if (!descriptor.nightTexture.isEmpty())
+        m_nightTexture = loadTexture(resources.nightTexture);
 
-    m_texture = loadTexture(resPath()+data.value("texture").toString());
-    if (data.contains("nightTexture"))
-        m_nightTexture = loadTexture(resPath()+data.value("nightTexture").toString());
-
-    float radius = data.value("radius").toFloat()*unitcoeff;
-    m_isLightSource = data.contains("lightsource") ? data.value("lightsource").toBool() : false;
+    float radius = descriptor.radius;
+    m_isLightSource = descriptor.isLightSource;
     if (m_isLightSource) {
         m_flare = new Flare(this);
     }
-    float flattening = data.contains("flattening") ? data.value("flattening").toFloat() : 0.0;
-    m_sphere = new Sphere(radius, flattening, this);
-    if (data.contains("shader")) {
-        m_sphere->setCustomShader(data.value("shader").toString());
+    m_sphere = new Sphere(resources.sphere, this);
+    if (!descriptor.shader.isEmpty()) {
+        m_sphere->setCustomShader(descriptor.shader);
     }
-    m_sphere->setColor(m_isLightSource ? QVector3D(1.0, 1.0, 1.0) : QVector3D(0.0, 0.0, 0.0));
     m_radius = radius;
     m_boundingRadius = m_radius;
 
-    if (data.contains("ringTexture")) {
-        m_ringTexture = loadTexture(resPath()+data.value("ringTexture").toString());
-        float innerRadius = data.value("innerRadius").toFloat()*unitcoeff;
-        float outerRadius = data.value("outerRadius").toFloat()*unitcoeff;
+    // The root of the system is the light source
+    const Body *top = this;
+    while (top->m_root) top = top->m_root;
+    m_lightRadius = top->m_radius;
+    m_sphere->setLightRadius(m_lightRadius);
+
+    if (descriptor.hasRing) {
+        m_ringTexture = loadTexture(resources.ringTexture);
+        float innerRadius = descriptor.ringInnerRadius;
+        float outerRadius = descriptor.ringOuterRadius;
         m_ring = new Ring(innerRadius, outerRadius, this);
+        m_ring->setLightRadius(m_lightRadius);
+        m_ring->setPlanetRadius(radius);
+        m_sphere->setRingShadow(innerRadius, outerRadius);
         m_boundingRadius = outerRadius;
     }
 
-    QVector3D color = QVector3D(0.5, 0.5, 0.5);
-    if (data.contains("color")) {
-        QList<QVariant> vec = data.value("color").toList();
-        if (vec.size()!=3)
-            qWarning()<<vec<<"color size is not 3";
-        color = QVector3D(vec.at(0).toFloat(), vec.at(1).toFloat(), vec.at(2).toFloat());
+    if (descriptor.hasAtmosphere) {
+        m_atmosphere = new Atmosphere(radius, descriptor.atmosphere, resources.atmosphere, this);
+        m_boundingRadius = qMax(m_boundingRadius, (float)(radius+descriptor.atmosphere.height));
     }
 
-    m_pointObject = new PointObject(color, this);
-    m_pointObject->setColor(m_objectId);
+    QVector3D color = descriptor.color;
+
+    if (Points)
+        m_point = Points->addPoint(color, m_objectId);
 
     if (m_root) {
-        OrbitalElements elements;
-        elements.eccentricity = data.value("eccentricity").toDouble();
-        elements.semiMajorAxis = data.value("semimajoraxis").toDouble()*unitcoeff;
-        elements.inclination = qDegreesToRadians(data.value("inclination").toDouble());
-        elements.longitudeOfAscendingNode = qDegreesToRadians(data.value("ascendingnode").toDouble());
-        elements.argumentOfPeriapsis = qDegreesToRadians(data.value("argumentperiapsis").toDouble());
-        elements.meanAnomalyAtEpoch = qDegreesToRadians(data.value("meanAnomaly").toDouble());
-        elements.revolutionPeriod = data.value("siderealrev").toDouble()*86400.0;
-        m_orbit = new Orbit(elements, color, this);
+        m_orbit = new Orbit(descriptor.orbit, this);
+        if (Orbits)
+            m_orbitLine = Orbits->addOrbit(resources.orbit, color);
+        // Over a revolution around the parent
+        if (Trails && (descriptor.orbit.revolutionPeriod > 0.0))
+            m_trail = Trails->addTrail(descriptor.orbit.revolutionPeriod, color);
     }
 
-    m_rotation.period = data.value("siderealrot").toDouble()*86400.0;
-    m_rotation.axialTilt = qDegreesToRadians(data.value("axialtilt").toDouble());
+    if (Integrator) {
+        double gm = descriptor.gm*1e-9;
+        // Without a mass in the catalog, Kepler's third law on the first satellite
+        const BodyDescriptor *satellite = descriptor.satellites.isEmpty() ? 0 : scene.catalog().body(descriptor.satellites.first());
+        if ((gm == 0.0) && satellite && (satellite->orbit.revolutionPeriod > 0.0) && !Orbit::isOpen(satellite->orbit)) {
+            double n = 2.0*M_PI/satellite->orbit.revolutionPeriod;
+            gm = n*n*pow(satellite->orbit.semiMajorAxis, 3.0);
+        }
+        m_integratorIndex = Integrator->addBody(m_root ? m_root->m_integratorIndex : -1, gm);
+    }
 
-    m_text = new TextBillboard(m_name, color, this);
-    m_text->setColor(m_objectId);
+    if (Labels)
+        m_label = Labels->addLabel(m_name, color, m_objectId);
 
     m_axis = new Axis(2.0*radius, this);
 
-    QStringList satellites = data.value("satellites").toString().split(":");
-    data.endGroup();
-    foreach (const QString &satellite, satellites) {
-        if (!satellite.isEmpty()) {
-            m_satellites.append(new Body(satellite, this));
+    // Before the satellites, the bodies of a group are contiguous
+    if (SmallBodies && !descriptor.smallBodies.isEmpty()) {
+        m_smallBodies = SmallBodies->addGroup();
+        foreach (const QString &smallBody, descriptor.smallBodies) {
+            const BodyDescriptor *smallBodyDescriptor = scene.catalog().body(smallBody);
+            if (!smallBodyDescriptor) {
+                qWarning()<<smallBody<<"not found in the catalog";
+                continue;
+            }
+            SmallBodies->addBody(smallBodyDescriptor->orbit, smallBodyDescriptor->color);
+        }
+    }
+
+    foreach (const QString &satellite, descriptor.satellites) {
+        const BodyDescriptor *satelliteDescriptor = scene.catalog().body(satellite);
+        if (!satelliteDescriptor) {
+            qWarning()<<satellite<<"not found in the catalog";
+            continue;
         }
+        m_satellites.append(new Body(*satelliteDescriptor, scene, this));
     }
 }
 
@@ -115,35 +157,43 @@ Body::~Body()
 
 void Body::setTime(double time)
 {
-    double longitudeOfPeriapsis = 0;
-    double rot0 = 0;
-    if (m_orbit) {
-        // Orbital orientation
-        m_referenceFrame = m_referenceFrame*m_orbit->orientation();
-        m_orbitFrame = m_referenceFrame;
-        // Orbital position
-        Eigen::Vector2d position = m_orbit->position(time);
-        m_orbit->setBodyPosition(position, time);
-        m_referenceFrame.translate(Eigen::Vector3d(position.x(), position.y(), 0.0));
-        longitudeOfPeriapsis = m_orbit->elements().argumentOfPeriapsis
-                                    + m_orbit->elements().longitudeOfAscendingNode;
-        rot0 = m_orbit->elements().meanAnomalyAtEpoch;// FIXME: only works for moon and earth by definition
+    const BodyMotion *parent = m_root ? &m_root->m_motion : 0;
+    if (Integrator && Integrator->isRunning() && parent && (m_integratorIndex >= 0)) {
+        // The integrator is in the world axes
+        Eigen::Vector3d position = Integrator->position(m_integratorIndex)-Integrator->position(m_root->m_integratorIndex);
+        m_motion.setTime(time, parent, &position);
+    } else {
+        m_motion.setTime(time, parent);
     }
-    m_referenceFrame.rotate(Eigen::AngleAxisd(M_PI/2.0-longitudeOfPeriapsis, Eigen::Vector3d::UnitZ()));
-    m_referenceFrame.rotate(Eigen::AngleAxisd(m_rotation.axialTilt, Eigen::Vector3d::UnitY()));
-    // Draw all satellites in the equatorial plane for the sake of simplicity.
-    // TODO: In reality they should be in the Laplace plane, which can be closer to the body's orbital plane.
-    m_laplaceFrame = m_referenceFrame;
-    m_referenceFrame.rotate(Eigen::AngleAxisd(-M_PI/2.0+longitudeOfPeriapsis, Eigen::Vector3d::UnitZ()));
-    m_referenceFrame.rotate(Eigen::AngleAxisd(rot0 + fmod(2.0*M_PI/m_rotation.period*time, 2.0*M_PI), Eigen::Vector3d::UnitZ()));
+    if (m_orbit)
+        m_orbit->setBodyPosition(m_motion.orbitalPosition(), time);
+    if (!m_root && SmallBodies)
+        SmallBodies->setTime(time);
+    // Recorded even when hidden, they are complete when shown
+    if (Trails && (m_trail >= 0))
+        Trails->append(m_trail, time, center());
 
     foreach (Body* satellite, m_satellites) {
-        satellite->setReferenceFrame(m_laplaceFrame);
         satellite->setTime(time);
     }
 }
 
-void Body::render(const Eigen::Affine3d &view, const Eigen::Affine3d &projection, RenderMode::Mode mode)
+void Body::initializeIntegrator(double time)
+{
+    foreach (Body* satellite, m_satellites) {
+        int index = satellite->m_integratorIndex;
+        if (Integrator && (index >= 0)) {
+            Eigen::Vector2d position, velocity;
+            Orbit::state(satellite->m_orbit->elements(), time, Integrator->jacobiGM(index), position, velocity);
+            Eigen::Matrix3d plane = satellite->m_motion.orbitFrame().linear();
+            Integrator->setJacobiState(index, plane*Eigen::Vector3d(position.x(), position.y(), 0.0),
+                                              plane*Eigen::Vector3d(velocity.x(), velocity.y(), 0.0));
+        }
+        satellite->initializeIntegrator(time);
+    }
+}
+
+void Body::render(RenderQueue &queue, RenderMode::Mode mode)
 {
     if ( (m_onScreenDistanceToParent >= 0)
        &&(m_onScreenDistanceToParent < PointSizeThreshold*2) ) {
@@ -151,79 +201,117 @@ void Body::render(const Eigen::Affine3d &view, const Eigen::Affine3d &projection
     }
     if ( mode == RenderMode::Opaque ) {
         if ( ShowAxis ) {
-            m_axis->render(m_laplaceFrame, view, projection);
+            queue.add(m_axis, m_motion.laplaceFrame());
         }
         if (m_onScreenRadius > PointSizeThreshold) {
-            if (m_nightTexture) {
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, m_nightTexture);
-                glActiveTexture(GL_TEXTURE0);
+            if (!m_isLightSource) {
+                m_sphere->setOccluders(occluders());
             }
-            glBindTexture(GL_TEXTURE_2D, m_texture);
-            m_sphere->render(m_referenceFrame, view, projection);
+            // Night side and ring shadow lookups on units 1 and 2
+            queue.add(m_sphere, m_motion.referenceFrame(), m_texture, m_nightTexture, m_ringTexture);
         }
         return;
     }
 
     if ( mode == RenderMode::Translucent ) {
+        // The trails stand for the orbits
+        if ( SmallBodies && (m_smallBodies >= 0) ) {
+            SmallBodies->add(m_smallBodies, m_motion.laplaceFrame(), ShowOrbit);
+        }
         if (m_onScreenRadius > PointSizeThreshold) {
-            if ( ShowOrbit && m_orbit ) {
-                m_orbit->render(m_orbitFrame, view, projection);
+            if ( ShowOrbit && m_orbit && Orbits ) {
+                Orbits->add(m_orbitLine, m_motion.orbitFrame(), *m_orbit);
+            }
+            if ( ShowTrail && Trails && (m_trail >= 0) ) {
+                Trails->add(m_trail);
+            }
+            if (m_atmosphere) {
+                queue.add(m_atmosphere, m_motion.referenceFrame());
             }
             if (m_ring) {
-                    glBindTexture(GL_TEXTURE_2D, m_ringTexture);
-                    m_ring->render(m_referenceFrame, view, projection);
+                queue.add(m_ring, m_motion.referenceFrame(), m_ringTexture);
             }
         } else {
             float alpha = ((float)m_onScreenDistanceToParent / (PointSizeThreshold*2.0)) - 1.0;
             if ( (alpha > 1.0) || (m_onScreenDistanceToParent < 0) ) alpha = 1.0;
-            m_pointObject->setAlpha(alpha);
-            m_pointObject->render(m_referenceFrame, view, projection);
-            if ( ShowOrbit && m_orbit ) {
-                m_orbit->setAlpha(alpha);
-                m_orbit->render(m_orbitFrame, view, projection);
+            if (Points)
+                Points->add(m_point, center(), alpha);
+            if ( ShowOrbit && m_orbit && Orbits ) {
+                Orbits->add(m_orbitLine, m_motion.orbitFrame(), *m_orbit, alpha);
             }
-            m_text->setAlpha(alpha);
-            m_text->render(m_referenceFrame, view, projection);
+            if ( ShowTrail && Trails && (m_trail >= 0) ) {
+                Trails->add(m_trail, alpha);
+            }
+            if (Labels)
+                Labels->add(m_label, center(), alpha, m_radius);
         }
         return;
     }
 
     if ( mode == (RenderMode::Picking) ) {
         if (m_onScreenRadius > PointSizeThreshold) {
-            m_sphere->setColor(m_objectId);
-            m_sphere->renderSolidColor(m_referenceFrame, view, projection);
-            m_sphere->setColor(m_isLightSource ? QVector3D(1.0, 1.0, 1.0) : QVector3D(0.0, 0.0, 0.0));
+            queue.addSolidColor(m_sphere, m_motion.referenceFrame(), Pickable::idColor(m_objectId));
         } else {
-            m_pointObject->renderSolidColor(m_referenceFrame, view, projection);
-            m_text->renderSolidColor(m_referenceFrame, view, projection);
+            if (Points)
+                Points->add(m_point, center());
+            if (Labels)
+                Labels->add(m_label, center(), 1.0, m_radius);
         }
         return;
     }
 
     if ( mode == (RenderMode::LightSource) ) {
+        // Everything but the light sources is black
         if (m_isLightSource) {
-            glBindTexture(GL_TEXTURE_2D, m_texture);
-            m_sphere->render(m_referenceFrame, view, projection);
+            queue.add(m_sphere, m_motion.referenceFrame(), m_texture);
         } else {
             if (m_onScreenRadius > 0) {
-                m_sphere->renderSolidColor(m_referenceFrame, view, projection);
+                queue.addSolidColor(m_sphere, m_motion.referenceFrame(), QVector3D(0.0, 0.0, 0.0));
             }
         }
         if (m_ring)
-            m_ring->renderSolidColor(m_referenceFrame, view, projection);
+            queue.addSolidColor(m_ring, m_motion.referenceFrame(), QVector3D(0.0, 0.0, 0.0));
         return;
     }
 }
 
-GLuint Body::loadTexture(const QString &image)
+QVector<Occluder> Body::occluders() const
 {
-    QImage img(image);
-    if (img.isNull()) {
-        qWarning()<<image<<"Unable to load file, unsupported file format";
-        return GLuint();
+    // Only the parent and the satellites are close enough to cast a visible shadow.
+    // The light source is at the origin.
+    QList<Body*> candidates = m_satellites;
+    if (m_root && !m_root->m_isLightSource)
+        candidates.prepend(m_root);
+
+    const Eigen::Vector3d center = this->center();
+    const double lightDistance = center.norm();
+    const Eigen::Vector3d toLight = -center/lightDistance;
+
+    QMultiMap<double, Occluder> sorted;
+    foreach (const Body* body, candidates) {
+        Eigen::Vector3d v = body->center()-center;
+        double along = v.dot(toLight);
+        if ((along <= 0.0) || (along >= lightDistance))
+            continue;
+        // Is this body inside the penumbra cone?
+        double penumbra = m_lightRadius*along/(lightDistance-along);
+        double offAxis = (v-along*toLight).norm();
+        if (offAxis > body->radius()+m_radius+penumbra)
+            continue;
+        Occluder occluder;
+        occluder.center = body->center();
+        occluder.radius = body->radius();
+        sorted.insert(offAxis-body->radius(), occluder);
     }
-    QImage glImg = img.mirrored().convertToFormat(QImage::Format_RGBA8888);
+    QVector<Occluder> result = sorted.values().toVector();
+    result.resize(qMin(result.size(), (int)Sphere::MaxOccluders));
+    return result;
+}
+
+GLuint Body::loadTexture(const QImage &glImg)
+{
+    if (glImg.isNull())
+        return GLuint();
 
     GLuint textureId;
     glGenTextures(1, &textureId);
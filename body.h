@@ -4,43 +4,55 @@
 #include "renderable/sphere.h"
 #include "renderable/ring.h"
 #include "renderable/orbit.h"
+#include "renderable/orbitbatch.h"
+#include "renderable/keplerbatch.h"
+#include "renderable/trailbatch.h"
 #include "renderable/axis.h"
-#include "renderable/pointobject.h"
-#include "renderable/textbillboard.h"
+#include "renderable/pointbatch.h"
+#include "renderable/labelbatch.h"
 #include "renderable/flare.h"
+#include "renderable/atmosphere.h"
+#include "renderable/renderqueue.h"
+#include "catalog.h"
+#include "bodymotion.h"
+#include "ephemeris/nbodyintegrator.h"
 
 #include <QString>
 #include <QList>
+#include <QImage>
 
 namespace RenderMode {
     enum Mode { Opaque, Translucent, Picking, LightSource };
 }
 
-struct Rotation {
-    double period;
-    double axialTilt;
-//    double meridianAngle;
-};
+class SceneLoader;
+struct BodyResources;
 
 class Body: public QObject, protected QOpenGLFunctions
 {
 
 public:
-    Body(const QString &name, QObject *parent = 0);
+    // Only uploads to GL, the resources come from SceneLoader
+    Body(const BodyDescriptor &descriptor, const SceneLoader &scene, QObject *parent = 0);
     ~Body();
     void setTime(double time/*seconds past epoch*/);
-    Eigen::Affine3d referenceFrame() const {return m_referenceFrame;}
-    void setReferenceFrame(const Eigen::Affine3d &frame) {m_referenceFrame = frame;}
+    // Starting state of the satellites from their elements, in the frames of the last setTime
+    void initializeIntegrator(double time);
+    Eigen::Affine3d referenceFrame() const {return m_motion.referenceFrame();}
+    const BodyMotion &motion() const {return m_motion;}
 
-    void render(const Eigen::Affine3d &view, const Eigen::Affine3d &projection, RenderMode::Mode mode);
+    // Queues the draws of the pass, the batches are filled directly
+    void render(RenderQueue &queue, RenderMode::Mode mode);
 
     int objectId() const {return m_objectId;}
+    int label() const {return m_label;}
     QString name() const {return m_name;}
     float radius() const {return m_radius;}
     float boundingRadius() const {return m_boundingRadius;}
+    bool isLightSource() const {return m_isLightSource;}
     Body* root() const {return m_root;}
     QList<Body*> satellites() const {return m_satellites;}
-    Eigen::Vector3d center() const {return m_referenceFrame*Eigen::Vector3d::Zero();}
+    Eigen::Vector3d center() const {return m_motion.center();}
 
     void setOnScreenRadius(int radius) {m_onScreenRadius = radius;}
     void setOnScreenDistanceToParent(int distance) {m_onScreenDistanceToParent = distance;}
@@ -48,45 +60,64 @@ public:
     static void setShowAxis(bool showAxis) {ShowAxis = showAxis;}
     static bool showOrbit() {return ShowOrbit;}
     static void setShowOrbit(bool showOrbit) {ShowOrbit = showOrbit;}
+    static bool showTrail() {return ShowTrail;}
+    static void setShowTrail(bool showTrail) {ShowTrail = showTrail;}
+    // Shared by all the bodies, must be set before creating them
+    static void setLabels(LabelBatch *labels) {Labels = labels;}
+    static void setPoints(PointBatch *points) {Points = points;}
+    static void setOrbits(OrbitBatch *orbits) {Orbits = orbits;}
+    static void setSmallBodies(KeplerBatch *smallBodies) {SmallBodies = smallBodies;}
+    static void setTrails(TrailBatch *trails) {Trails = trails;}
+    // While it runs, it replaces the orbits and the ephemerides
+    static void setIntegrator(NBodyIntegrator *integrator) {Integrator = integrator;}
     static void setPointSizeThreshold(float pointSizeThreshold) {
         PointSizeThreshold = pointSizeThreshold;
-        PointObject::setPointSize(PointSizeThreshold);
+        PointBatch::setPointSize(PointSizeThreshold);
     }
 
 protected:
-    GLuint loadTexture(const QString &image);
+    GLuint loadTexture(const QImage &image);
+    QVector<Occluder> occluders() const;
 
     static int ObjectID;
     static bool ShowAxis;
     static bool ShowOrbit;
+    static bool ShowTrail;
     static float PointSizeThreshold;
+    static LabelBatch *Labels;
+    static PointBatch *Points;
+    static OrbitBatch *Orbits;
+    static KeplerBatch *SmallBodies;
+    static TrailBatch *Trails;
+    static NBodyIntegrator *Integrator;
 
     QString m_name;
     int m_objectId;
     float m_radius;
     float m_boundingRadius;
     bool m_isLightSource;
+    float m_lightRadius;
     Sphere *m_sphere;
     Ring *m_ring;
+    Atmosphere *m_atmosphere;
     Orbit *m_orbit;
+    int m_orbitLine;
+    int m_smallBodies; // Group in SmallBodies
+    int m_trail;
+    int m_integratorIndex;
     Axis *m_axis;
-    PointObject *m_pointObject;
     int m_onScreenRadius;
     int m_onScreenDistanceToParent;
-    TextBillboard *m_text;
+    int m_label;
+    int m_point;
     Flare *m_flare;
 
-    Rotation m_rotation;
-
     Body *m_root;
+    BodyMotion m_motion;
     QList<Body*> m_satellites;
     GLuint m_texture;
     GLuint m_nightTexture;
     GLuint m_ringTexture;
-
-    Eigen::Affine3d m_referenceFrame;
-    Eigen::Affine3d m_orbitFrame;
-    Eigen::Affine3d m_laplaceFrame;
 };
 
 #endif // BODY_H
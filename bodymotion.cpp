@@ -0,0 +1,84 @@
+#include "bodymotion.h"
+#include "renderable/orbit.h"
+
+#include <cmath>
+
+// The precessions move the body by less than that before the orbit frame
+// is rebuilt
+static const double OrientationError = 0.0005; // 10e3m
+
+BodyMotion::BodyMotion(const BodyDescriptor &descriptor, bool hasOrbit, const QSharedPointer<Ephemeris> &ephemeris)
+    : m_hasOrbit(hasOrbit)
+    , m_elements(descriptor.orbit)
+    , m_orientation(Orbit::orientation(descriptor.orbit))
+    , m_ephemeris(ephemeris)
+    , m_rotationPeriod(descriptor.rotationPeriod)
+    , m_axialTilt(descriptor.axialTilt)
+    , m_referenceFrame(Eigen::Affine3d::Identity())
+    , m_orbitFrame(Eigen::Affine3d::Identity())
+    , m_laplaceFrame(Eigen::Affine3d::Identity())
+    , m_ecliptic(Eigen::Matrix3d::Identity())
+    , m_orbitalPosition(Eigen::Vector2d::Zero())
+{
+    m_orientationTolerance = OrientationError/qMax(std::abs(m_elements.semiMajorAxis), 1.0);
+    m_orientationAngles[0] = m_elements.longitudeOfAscendingNode;
+    m_orientationAngles[1] = m_elements.inclination;
+    m_orientationAngles[2] = m_elements.argumentOfPeriapsis;
+}
+
+void BodyMotion::updateOrientation(double time)
+{
+    if (!Orbit::hasRates(m_elements))
+        return;
+    OrbitalElements current = Orbit::at(m_elements, time);
+    if ( (std::abs(current.longitudeOfAscendingNode-m_orientationAngles[0]) < m_orientationTolerance)
+       &&(std::abs(current.inclination-m_orientationAngles[1]) < m_orientationTolerance)
+       &&(std::abs(current.argumentOfPeriapsis-m_orientationAngles[2]) < m_orientationTolerance) ) {
+        return;
+    }
+    m_orientation = Orbit::orientation(current);
+    m_orientationAngles[0] = current.longitudeOfAscendingNode;
+    m_orientationAngles[1] = current.inclination;
+    m_orientationAngles[2] = current.argumentOfPeriapsis;
+}
+
+void BodyMotion::setTime(double time, const BodyMotion *parent, const Eigen::Vector3d *position)
+{
+    double longitudeOfPeriapsis = 0;
+    double rot0 = 0;
+    m_referenceFrame = parent ? parent->m_laplaceFrame : Eigen::Affine3d::Identity();
+    m_ecliptic = parent ? parent->m_ecliptic : Eigen::Matrix3d::Identity();
+    if (m_hasOrbit) {
+        updateOrientation(time);
+        // Like the ephemerides, the elements are then relative to the ecliptic
+        if (m_ephemeris)
+            m_referenceFrame.linear() = m_ecliptic;
+        // Orbital orientation
+        m_referenceFrame = m_referenceFrame*m_orientation;
+        m_orbitFrame = m_referenceFrame;
+        // Orbital position
+        Eigen::Vector3d inOrbit;
+        if (position) {
+            inOrbit = m_referenceFrame.linear().transpose()*(*position);
+        } else if (m_ephemeris && m_ephemeris->position(time, inOrbit)) {
+            inOrbit = m_orientation.linear().transpose()*inOrbit;
+        } else {
+            Eigen::Vector2d inPlane = Orbit::position(m_elements, time);
+            inOrbit = Eigen::Vector3d(inPlane.x(), inPlane.y(), 0.0);
+        }
+        m_orbitalPosition = Eigen::Vector2d(inOrbit.x(), inOrbit.y());
+        m_referenceFrame.translate(inOrbit);
+        longitudeOfPeriapsis = m_elements.argumentOfPeriapsis + m_elements.longitudeOfAscendingNode;
+        rot0 = m_elements.meanAnomalyAtEpoch;// FIXME: only works for moon and earth by definition
+    }
+    m_referenceFrame.rotate(Eigen::AngleAxisd(M_PI/2.0-longitudeOfPeriapsis, Eigen::Vector3d::UnitZ()));
+    m_referenceFrame.rotate(Eigen::AngleAxisd(m_axialTilt, Eigen::Vector3d::UnitY()));
+    // Draw all satellites in the equatorial plane for the sake of simplicity.
+    // TODO: In reality they should be in the Laplace plane, which can be closer to the body's orbital plane.
+    m_laplaceFrame = m_referenceFrame;
+    // The elements of the planets are relative to this frame of the root, it stands for the ecliptic
+    if (!parent)
+        m_ecliptic = m_laplaceFrame.linear();
+    m_referenceFrame.rotate(Eigen::AngleAxisd(-M_PI/2.0+longitudeOfPeriapsis, Eigen::Vector3d::UnitZ()));
+    m_referenceFrame.rotate(Eigen::AngleAxisd(rot0 + fmod(2.0*M_PI/m_rotationPeriod*time, 2.0*M_PI), Eigen::Vector3d::UnitZ()));
+}
@@ -0,0 +1,56 @@
+#ifndef BODYMOTION_H
+#define BODYMOTION_H
+
+#include "catalog.h"
+#include "ephemeris/ephemeris.h"
+
+#include "Eigen/Geometry"
+
+// The frames of a body at a given time: position on the orbit, orbital
+// plane, equator and spin. No GL, Body draws with them and the batch
+// queries only read the positions.
+class BodyMotion
+{
+public:
+    // The ephemeris is used on the thread that calls setTime only
+    BodyMotion(const BodyDescriptor &descriptor, bool hasOrbit, const QSharedPointer<Ephemeris> &ephemeris);
+
+    // The parent is set first, null for the root. The position relative
+    // to the parent in the world axes, if any, replaces the orbit.
+    void setTime(double time/*seconds past epoch*/, const BodyMotion *parent, const Eigen::Vector3d *position = 0);
+
+    bool hasOrbit() const {return m_hasOrbit;}
+    const OrbitalElements &elements() const {return m_elements;}
+    bool hasEphemeris() const {return !m_ephemeris.isNull();}
+
+    const Eigen::Affine3d &referenceFrame() const {return m_referenceFrame;}
+    const Eigen::Affine3d &orbitFrame() const {return m_orbitFrame;}
+    const Eigen::Affine3d &laplaceFrame() const {return m_laplaceFrame;}
+    // Orientation of the J2000 ecliptic, the frame of the ephemerides
+    const Eigen::Matrix3d &ecliptic() const {return m_ecliptic;}
+    Eigen::Vector3d center() const {return m_referenceFrame.translation();}
+    // In the orbital plane, off the mean ellipse the orbit line snaps to it
+    Eigen::Vector2d orbitalPosition() const {return m_orbitalPosition;}
+
+private:
+    void updateOrientation(double time);
+
+    bool m_hasOrbit;
+    OrbitalElements m_elements;
+    // Of the precessed angles it was built with: node, inclination and
+    // argument of periapsis. Rebuilt when they drift beyond a tolerance.
+    Eigen::Affine3d m_orientation;
+    double m_orientationAngles[3]; // rad
+    double m_orientationTolerance; // rad
+    QSharedPointer<Ephemeris> m_ephemeris;
+    double m_rotationPeriod; // s
+    double m_axialTilt; // rad
+
+    Eigen::Affine3d m_referenceFrame;
+    Eigen::Affine3d m_orbitFrame;
+    Eigen::Affine3d m_laplaceFrame;
+    Eigen::Matrix3d m_ecliptic;
+    Eigen::Vector2d m_orbitalPosition;
+};
+
+#endif // BODYMOTION_H
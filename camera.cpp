@@ -24,6 +24,7 @@ Camera::Camera(QObject *parent)
     , m_zFar(1.0e5)
     , m_zNearCoefficient(1.0e-8)
     , m_zClippingCoefficient(1.0e6)
+    , m_jitter(0.0, 0.0)
 {
     qRegisterAnimationInterpolator<Eigen::Vector3d>(Vector3dInterpolator);
     qRegisterAnimationInterpolator<Eigen::Quaterniond>(QuaterniondInterpolator);
@@ -148,6 +149,12 @@ void Camera::setSceneRadius(double sceneRadius)
     updateProjection();
 }
 
+void Camera::setJitter(const Eigen::Vector2d &jitter)
+{
+    m_jitter = jitter;
+    updateProjection();
+}
+
 void Camera::updateModelView()
 {
     m_orientation.normalize();
@@ -159,8 +166,9 @@ void Camera::updateProjection()
 {
     double f = 1.0d / tan(qDegreesToRadians(m_fov)/2.0d);
     Eigen::Matrix4d mat;
-    mat <<  f / m_aspectRatio, 0.0, 0.0,                               0.0,
-            0.0,               f,   0.0,                               0.0,
+    // The jitter translates the image after the perspective divide
+    mat <<  f / m_aspectRatio, 0.0, -m_jitter.x(),                     0.0,
+            0.0,               f,   -m_jitter.y(),                     0.0,
             0.0,               0.0, (m_zFar+m_zNear)/(m_zNear-m_zFar), (2.0*m_zFar*m_zNear)/(m_zNear-m_zFar),
             0.0,               0.0, -1.0,                              0.0;
     m_projection = Eigen::Affine3d(mat);
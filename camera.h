@@ -38,12 +38,14 @@ public:
     Eigen::Affine3d modelView() const {return m_modelView;}
     Eigen::Affine3d projection() const {return m_projection;}
 
-    float fov() {return m_fov;}
+    float fov() const {return m_fov;}
+    float aspectRatio() const {return m_aspectRatio;}
     void setFov(float fov);
     void setAspectRatio(float aspectRatio);
     void setZNear(double zNear);
     void setZFar(double zFar);
     void setSceneRadius(double sceneRadius);
+    void setJitter(const Eigen::Vector2d &jitter);
 
     void goToCenter();
     void moveTo(const Eigen::Vector3d &position);
@@ -70,6 +72,7 @@ private:
     double m_sceneRadius;
     double m_zNearCoefficient;
     double m_zClippingCoefficient;
+    Eigen::Vector2d m_jitter; // Subpixel offset of the projection, NDC
 
     QSequentialAnimationGroup *m_goToAnimation;
     QPropertyAnimation *m_orientationAnimation;
@@ -0,0 +1,356 @@
+#include "catalog.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QtMath>
+
+// Bump when BodyDescriptor or its serialization changes
+static const quint32 CatalogMagic = 0x53534354; // "SSCT"
+static const quint32 CatalogVersion = 5;
+
+static QVector3D toVector3D(const QString &value, const QString &key, const QVector3D &defaultValue)
+{
+    QStringList list = value.split(',');
+    if (list.size() != 3) {
+        qWarning()<<list<<key<<"size is not 3";
+        return defaultValue;
+    }
+    return QVector3D(list.at(0).toFloat(), list.at(1).toFloat(), list.at(2).toFloat());
+}
+
+QDataStream &operator<<(QDataStream &stream, const BodyDescriptor &d)
+{
+    stream << d.name << d.texture << d.nightTexture << d.shader << d.isLightSource
+           << d.radius << d.flattening << d.color
+           << d.hasRing << d.ringTexture << d.ringInnerRadius << d.ringOuterRadius
+           << d.hasAtmosphere << d.atmosphere.height
+           << d.atmosphere.rayleigh.x() << d.atmosphere.rayleigh.y() << d.atmosphere.rayleigh.z()
+           << d.atmosphere.rayleighScaleHeight << d.atmosphere.mie << d.atmosphere.mieScaleHeight << d.atmosphere.mieG
+           << d.orbit.eccentricity << d.orbit.semiMajorAxis << d.orbit.inclination
+           << d.orbit.longitudeOfAscendingNode << d.orbit.argumentOfPeriapsis
+           << d.orbit.meanAnomalyAtEpoch << d.orbit.revolutionPeriod << d.orbit.epoch
+           << d.orbit.eccentricityRate << d.orbit.semiMajorAxisRate << d.orbit.inclinationRate
+           << d.orbit.longitudeOfAscendingNodeRate << d.orbit.argumentOfPeriapsisRate << d.ephemeris << d.gm
+           << d.rotationPeriod << d.axialTilt << d.satellites << d.smallBodies;
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, BodyDescriptor &d)
+{
+    double x, y, z;
+    stream >> d.name >> d.texture >> d.nightTexture >> d.shader >> d.isLightSource
+           >> d.radius >> d.flattening >> d.color
+           >> d.hasRing >> d.ringTexture >> d.ringInnerRadius >> d.ringOuterRadius
+           >> d.hasAtmosphere >> d.atmosphere.height
+           >> x >> y >> z
+           >> d.atmosphere.rayleighScaleHeight >> d.atmosphere.mie >> d.atmosphere.mieScaleHeight >> d.atmosphere.mieG
+           >> d.orbit.eccentricity >> d.orbit.semiMajorAxis >> d.orbit.inclination
+           >> d.orbit.longitudeOfAscendingNode >> d.orbit.argumentOfPeriapsis
+           >> d.orbit.meanAnomalyAtEpoch >> d.orbit.revolutionPeriod >> d.orbit.epoch
+           >> d.orbit.eccentricityRate >> d.orbit.semiMajorAxisRate >> d.orbit.inclinationRate
+           >> d.orbit.longitudeOfAscendingNodeRate >> d.orbit.argumentOfPeriapsisRate >> d.ephemeris >> d.gm
+           >> d.rotationPeriod >> d.axialTilt >> d.satellites >> d.smallBodies;
+    d.atmosphere.rayleigh = Eigen::Vector3d(x, y, z);
+    return stream;
+}
+
+BodyDescriptor::BodyDescriptor()
+    : isLightSource(false)
+    , radius(0.0)
+    , flattening(0.0)
+    , color(0.5, 0.5, 0.5)
+    , hasRing(false)
+    , ringInnerRadius(0.0)
+    , ringOuterRadius(0.0)
+    , hasAtmosphere(false)
+    , gm(0.0)
+    , rotationPeriod(0.0)
+    , axialTilt(0.0)
+{
+    atmosphere.height = 0.0;
+    atmosphere.rayleigh = Eigen::Vector3d::Zero();
+    atmosphere.rayleighScaleHeight = 1.0;
+    atmosphere.mie = 0.0;
+    atmosphere.mieScaleHeight = 1.0;
+    atmosphere.mieG = 0.76;
+    orbit.eccentricity = 0.0;
+    orbit.semiMajorAxis = 0.0;
+    orbit.inclination = 0.0;
+    orbit.longitudeOfAscendingNode = 0.0;
+    orbit.argumentOfPeriapsis = 0.0;
+    orbit.meanAnomalyAtEpoch = 0.0;
+    orbit.revolutionPeriod = 0.0;
+    orbit.epoch = 0.0;
+    orbit.eccentricityRate = 0.0;
+    orbit.semiMajorAxisRate = 0.0;
+    orbit.inclinationRate = 0.0;
+    orbit.longitudeOfAscendingNodeRate = 0.0;
+    orbit.argumentOfPeriapsisRate = 0.0;
+}
+
+Catalog::Catalog()
+{
+}
+
+const BodyDescriptor *Catalog::body(const QString &name) const
+{
+    QHash<QString, int>::const_iterator it = m_index.constFind(name);
+    if (it == m_index.constEnd())
+        return 0;
+    return &m_bodies.at(it.value());
+}
+
+bool Catalog::load(const QString &fileName)
+{
+    clear();
+    QFileInfo info(fileName);
+    if (info.suffix() == "bin")
+        return loadBinary(fileName);
+
+    // Compiled cache of the text catalog, invalidated when the source changes
+    QByteArray stamp = QCryptographicHash::hash(info.absoluteFilePath().toUtf8()
+                                                +QByteArray::number(info.size())
+                                                +QByteArray::number(info.lastModified().toMSecsSinceEpoch()),
+                                                QCryptographicHash::Sha1);
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QString cacheFile = cacheDir+"/catalog-"+QCryptographicHash::hash(info.absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex()+".bin";
+    if (loadBinary(cacheFile, stamp))
+        return true;
+    clear();
+
+    bool ok = (info.suffix() == "json") ? loadJson(fileName) : loadIni(fileName);
+    if (ok) {
+        QDir().mkpath(cacheDir);
+        save(cacheFile, stamp);
+    }
+    return ok;
+}
+
+bool Catalog::save(const QString &fileName) const
+{
+    return save(fileName, QByteArray());
+}
+
+bool Catalog::save(const QString &fileName, const QByteArray &sourceStamp) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning()<<fileName<<"Unable to write catalog";
+        return false;
+    }
+    QDataStream stream(&file);
+    stream << CatalogMagic << CatalogVersion << sourceStamp << m_bodies;
+    return stream.status() == QDataStream::Ok;
+}
+
+bool Catalog::loadBinary(const QString &fileName, const QByteArray &sourceStamp)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream stream(&file);
+    quint32 magic, version;
+    QByteArray stamp;
+    stream >> magic >> version >> stamp;
+    if ( (magic != CatalogMagic) || (version != CatalogVersion)
+       ||(!sourceStamp.isEmpty() && (stamp != sourceStamp)) ) {
+        return false;
+    }
+    stream >> m_bodies;
+    if (stream.status() != QDataStream::Ok) {
+        qWarning()<<fileName<<"Corrupted catalog";
+        clear();
+        return false;
+    }
+    m_index.reserve(m_bodies.size());
+    for (int i = 0; i < m_bodies.size(); ++i) {
+        m_index.insert(m_bodies.at(i).name, i);
+    }
+    return true;
+}
+
+bool Catalog::loadIni(const QString &fileName)
+{
+    // Same syntax as QSettings::IniFormat for what data.txt uses,
+    // without QSettings' per instance parsing and QVariant conversions.
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning()<<"Error loading file "<<file.fileName();
+        return false;
+    }
+    QTextStream data(&file);
+    QString group;
+    Values values;
+    while (!data.atEnd()) {
+        QString line = data.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#') || line.startsWith(';'))
+            continue;
+        if (line.startsWith('[') && line.endsWith(']')) {
+            if (!group.isEmpty())
+                add(group, values);
+            group = line.mid(1, line.size()-2).trimmed();
+            values.clear();
+            continue;
+        }
+        int equal = line.indexOf('=');
+        if (equal < 0) {
+            qWarning()<<fileName<<"Malformed line"<<line;
+            continue;
+        }
+        values.insert(line.left(equal).trimmed(), line.mid(equal+1).trimmed());
+    }
+    if (!group.isEmpty())
+        add(group, values);
+    completeOrbits();
+    return true;
+}
+
+bool Catalog::loadJson(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning()<<"Error loading file "<<file.fileName();
+        return false;
+    }
+    // Tolerate whole line // comments, which data.json uses but JSON does not allow
+    QByteArray json;
+    while (!file.atEnd()) {
+        QByteArray line = file.readLine();
+        if (!line.trimmed().startsWith("//"))
+            json += line;
+    }
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(json, &error);
+    if (error.error != QJsonParseError::NoError) {
+        qWarning()<<fileName<<error.errorString()<<"at"<<error.offset;
+        return false;
+    }
+    QJsonObject root = document.object();
+    for (QJsonObject::const_iterator body = root.constBegin(); body != root.constEnd(); ++body) {
+        Values values;
+        QJsonObject object = body.value().toObject();
+        for (QJsonObject::const_iterator it = object.constBegin(); it != object.constEnd(); ++it) {
+            values.insert(it.key(), it.value().toVariant().toString());
+        }
+        add(body.key(), values);
+    }
+    completeOrbits();
+    return true;
+}
+
+void Catalog::add(const QString &name, const Values &values)
+{
+    BodyDescriptor d;
+    d.name = name;
+    d.texture = values.value("texture");
+    d.nightTexture = values.value("nightTexture");
+    d.shader = values.value("shader");
+    d.isLightSource = (values.value("lightsource").trimmed() == "true");
+    d.radius = values.value("radius").toFloat();
+    d.flattening = values.value("flattening").toFloat();
+    if (values.contains("color"))
+        d.color = toVector3D(values.value("color"), "color", d.color);
+
+    d.hasRing = values.contains("ringTexture");
+    if (d.hasRing) {
+        d.ringTexture = values.value("ringTexture");
+        d.ringInnerRadius = values.value("innerRadius").toFloat();
+        d.ringOuterRadius = values.value("outerRadius").toFloat();
+    }
+
+    d.hasAtmosphere = values.contains("atmosphereHeight");
+    if (d.hasAtmosphere) {
+        d.atmosphere.height = values.value("atmosphereHeight").toDouble();
+        QVector3D rayleigh = toVector3D(values.value("rayleigh"), "rayleigh", QVector3D());
+        d.atmosphere.rayleigh = Eigen::Vector3d(rayleigh.x(), rayleigh.y(), rayleigh.z());
+        d.atmosphere.rayleighScaleHeight = values.value("rayleighScaleHeight").toDouble();
+        d.atmosphere.mie = values.value("mie").toDouble();
+        d.atmosphere.mieScaleHeight = values.value("mieScaleHeight").toDouble();
+        if (values.contains("mieG"))
+            d.atmosphere.mieG = values.value("mieG").toDouble();
+    }
+
+    d.orbit.eccentricity = values.value("eccentricity").toDouble();
+    d.orbit.semiMajorAxis = values.value("semimajoraxis").toDouble();
+    d.orbit.inclination = qDegreesToRadians(values.value("inclination").toDouble());
+    d.orbit.longitudeOfAscendingNode = qDegreesToRadians(values.value("ascendingnode").toDouble());
+    d.orbit.argumentOfPeriapsis = qDegreesToRadians(values.value("argumentperiapsis").toDouble());
+    d.orbit.meanAnomalyAtEpoch = qDegreesToRadians(values.value("meanAnomaly").toDouble());
+    d.orbit.revolutionPeriod = values.value("siderealrev").toDouble()*86400.0;
+    d.orbit.epoch = values.value("epoch").toDouble()*86400.0;
+    // Secular rates per Julian century, like JPL's approximate elements
+    const double century = 36525.0*86400.0;
+    d.orbit.eccentricityRate = values.value("eccentricityrate").toDouble()/century;
+    d.orbit.semiMajorAxisRate = values.value("semimajoraxisrate").toDouble()/century;
+    d.orbit.inclinationRate = qDegreesToRadians(values.value("inclinationrate").toDouble())/century;
+    d.orbit.longitudeOfAscendingNodeRate = qDegreesToRadians(values.value("ascendingnoderate").toDouble())/century;
+    d.orbit.argumentOfPeriapsisRate = qDegreesToRadians(values.value("argumentperiapsisrate").toDouble())/century;
+    // Comets and other open orbits: distance and time of periapsis
+    if (values.contains("periapsis")) {
+        double q = values.value("periapsis").toDouble();
+        double e = d.orbit.eccentricity;
+        d.orbit.semiMajorAxis = (e == 1.0) ? q : q/(1.0-e);
+    }
+    if (values.contains("periapsistime"))
+        m_periapsisTimes.insert(name, values.value("periapsistime").toDouble()*86400.0);
+    d.ephemeris = values.value("ephemeris").trimmed();
+    d.gm = values.value("gm").toDouble();
+
+    d.rotationPeriod = values.value("siderealrot").toDouble()*86400.0;
+    d.axialTilt = qDegreesToRadians(values.value("axialtilt").toDouble());
+
+    foreach (const QString &satellite, values.value("satellites").split(':')) {
+        if (!satellite.trimmed().isEmpty())
+            d.satellites.append(satellite.trimmed());
+    }
+    foreach (const QString &smallBody, values.value("smallbodies").split(':')) {
+        if (!smallBody.trimmed().isEmpty())
+            d.smallBodies.append(smallBody.trimmed());
+    }
+
+    if (m_index.contains(name)) {
+        qWarning()<<name<<"defined twice, the last definition is kept";
+        m_bodies[m_index.value(name)] = d;
+        return;
+    }
+    m_index.insert(name, m_bodies.size());
+    m_bodies.append(d);
+}
+
+void Catalog::completeOrbits()
+{
+    for (int i = 0; i < m_bodies.size(); ++i) {
+        double gm = m_bodies.at(i).gm*1e-9;
+        foreach (const QString &name, m_bodies.at(i).satellites+m_bodies.at(i).smallBodies) {
+            int index = indexOf(name);
+            if (index < 0)
+                continue;
+            OrbitalElements &orbit = m_bodies[index].orbit;
+            double a = qAbs(orbit.semiMajorAxis);
+            if ((orbit.revolutionPeriod == 0.0) && (gm > 0.0) && (a > 0.0)) {
+                // Barker's equation has its own mean motion
+                double n = (orbit.eccentricity == 1.0) ? qSqrt(gm/(2.0*a*a*a)) : qSqrt(gm/(a*a*a));
+                orbit.revolutionPeriod = 2.0*M_PI/n;
+            }
+            if (m_periapsisTimes.contains(name) && (orbit.revolutionPeriod != 0.0))
+                orbit.meanAnomalyAtEpoch = 2.0*M_PI/orbit.revolutionPeriod*(orbit.epoch-m_periapsisTimes.value(name));
+        }
+    }
+    m_periapsisTimes.clear();
+}
+
+void Catalog::clear()
+{
+    m_bodies.clear();
+    m_index.clear();
+    m_periapsisTimes.clear();
+}
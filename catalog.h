@@ -0,0 +1,76 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include "renderable/orbit.h"
+#include "renderable/atmosphere.h"
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QVector3D>
+
+struct BodyDescriptor {
+    BodyDescriptor();
+
+    QString name;
+    QString texture;
+    QString nightTexture;
+    QString shader;
+    bool isLightSource;
+    float radius; // 10e3m
+    float flattening;
+    QVector3D color;
+
+    bool hasRing;
+    QString ringTexture;
+    float ringInnerRadius; // 10e3m
+    float ringOuterRadius; // 10e3m
+
+    bool hasAtmosphere;
+    AtmosphereParameters atmosphere;
+
+    OrbitalElements orbit; // Unused for the root
+    QString ephemeris; // Accurate positions if available, see Ephemeris::create
+    double gm; // km^3/s^2, for the N-body mode
+    double rotationPeriod; // s
+    double axialTilt; // rad
+
+    QStringList satellites;
+    // Only drawn as points by KeplerBatch, from their elements
+    QStringList smallBodies;
+};
+
+class Catalog
+{
+public:
+    Catalog();
+    // Parses an ini (data.txt) or json catalog, or reads a binary one (.bin).
+    // Text catalogs are compiled to a binary cache the first time they are read.
+    bool load(const QString &fileName);
+    bool save(const QString &fileName) const;
+
+    int size() const {return m_bodies.size();}
+    const BodyDescriptor &at(int i) const {return m_bodies.at(i);}
+    const BodyDescriptor *body(const QString &name) const;
+    int indexOf(const QString &name) const {return m_index.value(name, -1);}
+
+private:
+    typedef QHash<QString, QString> Values;
+
+    bool loadIni(const QString &fileName);
+    bool loadJson(const QString &fileName);
+    bool loadBinary(const QString &fileName, const QByteArray &sourceStamp = QByteArray());
+    bool save(const QString &fileName, const QByteArray &sourceStamp) const;
+    void add(const QString &name, const Values &values);
+    // Periods and mean anomalies of the satellites and small bodies that give
+    // their periapsis instead, from the gm of their parent
+    void completeOrbits();
+    void clear();
+
+    QVector<BodyDescriptor> m_bodies;
+    QHash<QString, int> m_index;
+    QHash<QString, double> m_periapsisTimes; // s past J2000, while parsing
+};
+
+#endif // CATALOG_H
@@ -0,0 +1,76 @@
+#include "chebyshevcache.h"
+
+#include <cmath>
+#include <limits>
+
+ChebyshevCache::ChebyshevCache(Ephemeris *source, double segmentLength)
+    : m_source(source)
+    , m_segmentLength(segmentLength)
+    , m_segmentCount(0)
+    , m_nextSegment(0)
+    , m_lastMiss(std::numeric_limits<qint64>::min())
+{
+}
+
+bool ChebyshevCache::position(double time, Eigen::Vector3d &position)
+{
+    qint64 index = (qint64)std::floor(time/m_segmentLength);
+    const Segment *segment = 0;
+    for (int i = 0; i < m_segmentCount; ++i) {
+        if (m_segments[i].index == index) {
+            segment = &m_segments[i];
+            break;
+        }
+    }
+    if (!segment) {
+        if (index != m_lastMiss) {
+            m_lastMiss = index;
+            return m_source->position(time, position);
+        }
+        Segment &slot = m_segments[m_nextSegment];
+        if (!fit(index, slot))
+            return m_source->position(time, position);
+        m_nextSegment = (m_nextSegment+1)%MaxSegments;
+        m_segmentCount = qMin(m_segmentCount+1, (int)MaxSegments);
+        segment = &slot;
+    }
+
+    // Clenshaw recurrence on [-1, 1]
+    double x = 2.0*(time/m_segmentLength-index)-1.0;
+    for (int c = 0; c < 3; ++c) {
+        const double *coefficients = segment->coefficients[c];
+        double b1 = 0.0;
+        double b2 = 0.0;
+        for (int j = Degree; j > 0; --j) {
+            double b = 2.0*x*b1-b2+coefficients[j];
+            b2 = b1;
+            b1 = b;
+        }
+        position[c] = x*b1-b2+coefficients[0];
+    }
+    return true;
+}
+
+bool ChebyshevCache::fit(qint64 index, Segment &segment)
+{
+    // Interpolation at the Chebyshev nodes
+    const int n = Degree+1;
+    Eigen::Vector3d samples[n];
+    for (int k = 0; k < n; ++k) {
+        double x = std::cos(M_PI*(k+0.5)/n);
+        if (!m_source->position((index+0.5*(x+1.0))*m_segmentLength, samples[k]))
+            return false;
+    }
+    for (int j = 0; j < n; ++j) {
+        Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+        for (int k = 0; k < n; ++k) {
+            sum += samples[k]*std::cos(M_PI*j*(k+0.5)/n);
+        }
+        sum *= (j == 0) ? 1.0/n : 2.0/n;
+        for (int c = 0; c < 3; ++c) {
+            segment.coefficients[c][j] = sum[c];
+        }
+    }
+    segment.index = index;
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef CHEBYSHEVCACHE_H
+#define CHEBYSHEVCACHE_H
+
+#include "ephemeris.h"
+
+#include <QScopedPointer>
+
+// Approximates a slow source by Chebyshev polynomials on fixed time segments.
+// A segment is fitted the second time it is hit in a row, so that scrubbing
+// and fast time-lapse, which rarely stay in a segment, only pay for direct
+// evaluations. Within a fitted segment a position costs a few multiply-adds.
+class ChebyshevCache : public Ephemeris
+{
+public:
+    // Takes ownership of the source
+    ChebyshevCache(Ephemeris *source, double segmentLength);
+    bool position(double time, Eigen::Vector3d &position);
+
+private:
+    static const int Degree = 12;
+    static const int MaxSegments = 8;
+    struct Segment {
+        qint64 index;
+        double coefficients[3][Degree+1];
+    };
+
+    bool fit(qint64 index, Segment &segment);
+
+    QScopedPointer<Ephemeris> m_source;
+    double m_segmentLength;
+    Segment m_segments[MaxSegments];
+    int m_segmentCount;
+    int m_nextSegment; // Oldest one, replaced first
+    qint64 m_lastMiss;
+};
+
+#endif // CHEBYSHEVCACHE_H
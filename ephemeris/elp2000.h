@@ -0,0 +1,15 @@
+#ifndef ELP2000_H
+#define ELP2000_H
+
+#include "ephemeris.h"
+
+// Geocentric position of the Moon from the main problem of the ELP2000-82
+// lunar theory, truncated to its largest terms as in J. Meeus, Astronomical
+// Algorithms, chapter 47. About 10" in longitude and 4" in latitude.
+class Elp2000 : public Ephemeris
+{
+public:
+    bool position(double time, Eigen::Vector3d &position);
+};
+
+#endif // ELP2000_H
@@ -0,0 +1,66 @@
+#include "ephemeris.h"
+#include "chebyshevcache.h"
+#include "elp2000.h"
+#include "vsop87.h"
+#include "jplephemeris.h"
+#include "path.h"
+
+#include <QFile>
+#include <QStringList>
+#include <QDebug>
+
+QSharedPointer<Ephemeris> Ephemeris::create(const QString &sources, double revolutionPeriod)
+{
+    // The first source available is used
+    foreach (const QString &source, sources.split(',')) {
+        QSharedPointer<Ephemeris> ephemeris = createSource(source.trimmed(), revolutionPeriod);
+        if (ephemeris)
+            return ephemeris;
+    }
+    return QSharedPointer<Ephemeris>();
+}
+
+QSharedPointer<Ephemeris> Ephemeris::createSource(const QString &source, double revolutionPeriod)
+{
+    // The data files are not shipped, the next source is used without them
+    QStringList fields = source.split(':');
+    QString fileName = resPath()+"data/ephemeris/"+fields.first();
+    if (fields.first().endsWith(".bsp")) {
+        // JPL kernel, file:target:center
+        bool targetOk = false;
+        bool centerOk = false;
+        int target = fields.value(1).toInt(&targetOk);
+        int center = fields.value(2).toInt(&centerOk);
+        if (!targetOk || !centerOk) {
+            qWarning()<<source<<"Expected kernel:target:center";
+            return QSharedPointer<Ephemeris>();
+        }
+        if (!QFile::exists(fileName))
+            return QSharedPointer<Ephemeris>();
+        QSharedPointer<SpkKernel> kernel = SpkKernel::open(fileName);
+        if (!kernel)
+            return QSharedPointer<Ephemeris>();
+        return QSharedPointer<Ephemeris>(new JplEphemeris(kernel, target, center));
+    }
+
+    Ephemeris *ephemeris = 0;
+    if (source == "ELP2000-82") {
+        ephemeris = new Elp2000;
+    } else if (source.startsWith("VSOP87A.")) {
+        if (QFile::exists(fileName)) {
+            Vsop87 *vsop87 = new Vsop87(fileName);
+            if (vsop87->isValid())
+                ephemeris = vsop87;
+            else
+                delete vsop87;
+        }
+    } else if (!source.isEmpty()) {
+        qWarning()<<source<<"Unknown ephemeris";
+    }
+    if (!ephemeris)
+        return QSharedPointer<Ephemeris>();
+
+    // Short enough for a low degree fit of the main periodic terms
+    double segmentLength = qBound(0.25*86400.0, revolutionPeriod/64.0, 64.0*86400.0);
+    return QSharedPointer<Ephemeris>(new ChebyshevCache(ephemeris, segmentLength));
+}
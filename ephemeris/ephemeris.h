@@ -0,0 +1,29 @@
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+#include <QSharedPointer>
+#include <QString>
+
+#include "Eigen/Geometry"
+
+// Source of the position of a body relative to its parent, in the J2000
+// ecliptic frame and in 10e3m. Time is in seconds past J2000, the few leap
+// seconds since 2000 are ignored.
+class Ephemeris
+{
+public:
+    virtual ~Ephemeris() {}
+    // False outside of the time span covered by the source
+    virtual bool position(double time, Eigen::Vector3d &position) = 0;
+
+    // Builds the first available source of the comma separated list named in
+    // the catalog: a JPL kernel (de440.bsp:target:center), a VSOP87A file or
+    // ELP2000-82. The series are wrapped in a Chebyshev cache. Returns a null
+    // pointer when none is available. CPU only, can run on any thread.
+    static QSharedPointer<Ephemeris> create(const QString &sources, double revolutionPeriod);
+
+private:
+    static QSharedPointer<Ephemeris> createSource(const QString &source, double revolutionPeriod);
+};
+
+#endif // EPHEMERIS_H
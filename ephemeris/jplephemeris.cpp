@@ -0,0 +1,27 @@
+#include "jplephemeris.h"
+
+#include <cmath>
+
+// Timeline counts UTC seconds from 2000-01-01 11:58:55 without the leap
+// seconds. That origin is 0.816 s before J2000 (11:58:55.816 UTC), which
+// TDB gets back, then TDB is ahead by the 5 leap seconds inserted since 2000
+// (up to 2017): TDB = t - 0.816 + 5.
+static const double TdbMinusTime = 4.184;
+static const double Obliquity = 84381.448/3600.0*M_PI/180.0;
+
+JplEphemeris::JplEphemeris(const QSharedPointer<SpkKernel> &kernel, int target, int center)
+    : m_kernel(kernel)
+    , m_target(target)
+    , m_center(center)
+{
+}
+
+bool JplEphemeris::position(double time, Eigen::Vector3d &position)
+{
+    Eigen::Vector3d equatorial;
+    if (!m_kernel->position(m_target, m_center, time+TdbMinusTime, equatorial))
+        return false;
+    // km to 10e3m, in the ecliptic frame
+    position = Eigen::AngleAxisd(-Obliquity, Eigen::Vector3d::UnitX())*equatorial*1e-3;
+    return true;
+}
@@ -0,0 +1,22 @@
+#ifndef JPLEPHEMERIS_H
+#define JPLEPHEMERIS_H
+
+#include "ephemeris.h"
+#include "spkkernel.h"
+
+// Position of a body from a JPL planetary ephemeris (DE4xx) in SPK format.
+// Already Chebyshev series, it is evaluated directly without a cache.
+class JplEphemeris : public Ephemeris
+{
+public:
+    // target and center are NAIF ids, e.g. 399 and 10 for the Earth around the Sun
+    JplEphemeris(const QSharedPointer<SpkKernel> &kernel, int target, int center);
+    bool position(double time, Eigen::Vector3d &position);
+
+private:
+    QSharedPointer<SpkKernel> m_kernel;
+    int m_target;
+    int m_center;
+};
+
+#endif // JPLEPHEMERIS_H
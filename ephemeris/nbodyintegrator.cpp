@@ -0,0 +1,343 @@
+#include "nbodyintegrator.h"
+
+#include <QRunnable>
+
+#include <cmath>
+
+namespace {
+
+// Direct sum on the rows [begin, end), all the columns at once so that Eigen
+// vectorizes the pairs. Exact forces, the mapping is only as good as they are.
+void directSum(const Eigen::ArrayXd *x, const Eigen::ArrayXd &gm, int begin, int end,
+              Eigen::ArrayXd *a, Eigen::ArrayXd &distance2, Eigen::ArrayXd &scale)
+{
+    for (int i = begin; i < end; ++i) {
+        distance2 = (x[0]-x[0](i)).square() + (x[1]-x[1](i)).square() + (x[2]-x[2](i)).square();
+        distance2(i) = 1.0;
+        scale = gm/(distance2*distance2.sqrt());
+        scale(i) = 0.0;
+        for (int c = 0; c < 3; ++c) {
+            a[c](i) = (scale*(x[c]-x[c](i))).sum();
+        }
+    }
+}
+
+class ForceJob : public QRunnable
+{
+public:
+    ForceJob(const Eigen::ArrayXd *x, const Eigen::ArrayXd &gm, int begin, int end, Eigen::ArrayXd *a)
+        : m_x(x), m_gm(gm), m_begin(begin), m_end(end), m_a(a) {}
+
+    void run()
+    {
+        Eigen::ArrayXd distance2(m_gm.size());
+        Eigen::ArrayXd scale(m_gm.size());
+        directSum(m_x, m_gm, m_begin, m_end, m_a, distance2, scale);
+    }
+
+private:
+    const Eigen::ArrayXd *m_x;
+    const Eigen::ArrayXd &m_gm;
+    int m_begin;
+    int m_end;
+    Eigen::ArrayXd *m_a;
+};
+
+double cubeRoot(double x)
+{
+    return (x < 0.0) ? -std::pow(-x, 1.0/3.0) : std::pow(x, 1.0/3.0);
+}
+
+// Stumpff functions c2 and c3, from their series near the parabola
+void stumpff(double psi, double &c2, double &c3)
+{
+    if (psi > 0.1) {
+        double s = std::sqrt(psi);
+        c2 = (1.0-std::cos(s))/psi;
+        c3 = (s-std::sin(s))/(psi*s);
+    } else if (psi < -0.1) {
+        double s = std::sqrt(-psi);
+        c2 = (std::cosh(s)-1.0)/(-psi);
+        c3 = (std::sinh(s)-s)/(-psi*s);
+    } else {
+        c2 = 1.0/2.0-psi*(1.0/24.0-psi*(1.0/720.0-psi*(1.0/40320.0-psi*(1.0/3628800.0-psi/479001600.0))));
+        c3 = 1.0/6.0-psi*(1.0/120.0-psi*(1.0/5040.0-psi*(1.0/362880.0-psi*(1.0/39916800.0-psi/6227020800.0))));
+    }
+}
+
+// Moves along the Keplerian orbit of any eccentricity with the f and g
+// functions of the universal variable (Danby, Fundamentals of Celestial
+// Mechanics, 6.9), in at most 16 iterations.
+void keplerDrift(double gm, double dt, Eigen::Vector3d &position, Eigen::Vector3d &velocity)
+{
+    double r0 = position.norm();
+    double sqrtGM = std::sqrt(gm);
+    double sigma0 = position.dot(velocity)/sqrtGM;
+    double alpha = 2.0/r0-velocity.squaredNorm()/gm;
+
+    // Laguerre-Conway on the universal Kepler equation. The starter is the
+    // chord, or the mean motion of ellipses when smaller. For open orbits,
+    // the exact solution of the parabola is above the one of the hyperbola,
+    // and far along it the asymptote gets closer (Vallado, Algorithm 8).
+    double sign = (dt < 0.0) ? -1.0 : 1.0;
+    double x = std::abs(sqrtGM*dt/r0);
+    if (alpha > 0.0) {
+        x = qMin(x, std::abs(sqrtGM*dt*alpha));
+    } else {
+        double p = 2.0*r0-sigma0*sigma0;
+        if (p > 0.0) {
+            double q = 3.0*sqrtGM*dt+3.0*r0*sigma0-sigma0*sigma0*sigma0;
+            double s = std::sqrt(q*q+p*p*p);
+            x = qMin(x, std::abs(cubeRoot(q+s)+cubeRoot(q-s)-sigma0));
+        }
+        if (alpha < 0.0) {
+            double a = 1.0/alpha;
+            double ratio = -2.0*gm*alpha*dt/(position.dot(velocity)+sign*std::sqrt(-gm*a)*(1.0-r0*alpha));
+            if (ratio > 1.0)
+                x = qMin(x, std::sqrt(-a)*std::log(ratio));
+        }
+    }
+    x *= sign;
+    double c2 = 0.5;
+    double c3 = 1.0/6.0;
+    double r = r0;
+    for (int i = 0; i < 16; ++i) {
+        double x2 = x*x;
+        double psi = alpha*x2;
+        stumpff(psi, c2, c3);
+        double f = sigma0*x2*c2+(1.0-alpha*r0)*x2*x*c3+r0*x-sqrtGM*dt;
+        r = x2*c2+sigma0*x*(1.0-psi*c3)+r0*(1.0-psi*c2);
+        double r2 = sigma0*(1.0-psi*c2)+(1.0-alpha*r0)*x*(1.0-psi*c3);
+        double root = std::sqrt(std::abs(16.0*r*r-20.0*f*r2));
+        double delta = 5.0*f/(r+((r > 0.0) ? root : -root));
+        x -= delta;
+        if (std::abs(delta) < 1e-12*qMax(1.0, std::abs(x)))
+            break;
+    }
+    double x2 = x*x;
+    double psi = alpha*x2;
+    stumpff(psi, c2, c3);
+    r = x2*c2+sigma0*x*(1.0-psi*c3)+r0*(1.0-psi*c2);
+
+    double f = 1.0-x2*c2/r0;
+    double g = dt-x2*x*c3/sqrtGM;
+    double fdot = sqrtGM/(r*r0)*x*(psi*c3-1.0);
+    double gdot = 1.0-x2*c2/r;
+    Eigen::Vector3d p = f*position+g*velocity;
+    velocity = fdot*position+gdot*velocity;
+    position = p;
+}
+
+}
+
+NBodyIntegrator::NBodyIntegrator()
+    : m_running(false)
+    , m_startTime(0.0)
+    , m_step(0.0)
+    , m_stepIndex(0)
+{
+}
+
+int NBodyIntegrator::addBody(int parent, double gm)
+{
+    int index = m_parent.size();
+    m_parent.append(parent);
+    m_children.append(QVector<int>());
+    m_gm.conservativeResize(index+1);
+    m_subsystemGM.conservativeResize(index+1);
+    m_innerGM.conservativeResize(index+1);
+    m_gm(index) = gm;
+    m_subsystemGM(index) = gm;
+    m_innerGM(index) = 0.0;
+    if (parent >= 0) {
+        // Depth first, the subsystems of the inner satellites are complete
+        m_innerGM(index) = m_gm(parent);
+        foreach (int sibling, m_children.at(parent)) {
+            m_innerGM(index) += m_subsystemGM(sibling);
+        }
+        m_children[parent].append(index);
+        for (int p = parent; p >= 0; p = m_parent.at(p)) {
+            m_subsystemGM(p) += gm;
+        }
+    }
+    for (int c = 0; c < 3; ++c) {
+        m_q[c] = Eigen::ArrayXd::Zero(index+1);
+        m_v[c] = Eigen::ArrayXd::Zero(index+1);
+    }
+    m_running = false;
+    return index;
+}
+
+void NBodyIntegrator::setJacobiState(int body, const Eigen::Vector3d &position, const Eigen::Vector3d &velocity)
+{
+    for (int c = 0; c < 3; ++c) {
+        m_q[c](body) = position[c];
+        m_v[c](body) = velocity[c];
+    }
+}
+
+void NBodyIntegrator::start(double time)
+{
+    int n = size();
+    if (n == 0)
+        return;
+    // Barycentric frame, the drift of the whole system is of no interest
+    for (int c = 0; c < 3; ++c) {
+        m_q[c](0) = 0.0;
+        m_v[c](0) = 0.0;
+        m_x[c].resize(n);
+        m_a[c].resize(n);
+        m_jacobiA[c].resize(n);
+        m_output[c].resize(n);
+    }
+
+    double shortestPeriod = 0.0;
+    for (int i = 1; i < n; ++i) {
+        Eigen::Vector3d q(m_q[0](i), m_q[1](i), m_q[2](i));
+        Eigen::Vector3d v(m_v[0](i), m_v[1](i), m_v[2](i));
+        double gm = jacobiGM(i);
+        double a = 1.0/(2.0/q.norm()-v.squaredNorm()/gm);
+        if (a <= 0.0)
+            continue;
+        double period = 2.0*M_PI*std::sqrt(a*a*a/gm);
+        if ((shortestPeriod == 0.0) || (period < shortestPeriod))
+            shortestPeriod = period;
+    }
+    m_step = (shortestPeriod > 0.0) ? shortestPeriod/StepsPerRevolution : 86400.0;
+    m_startTime = time;
+    m_stepIndex = 0;
+    fromJacobi(m_q, m_output);
+    m_running = true;
+}
+
+bool NBodyIntegrator::integrate(double time)
+{
+    if (!m_running)
+        return false;
+    double span = time-(m_startTime+m_stepIndex*m_step);
+    double steps = std::floor(std::abs(span)/m_step);
+    if (steps > MaxSteps)
+        return false;
+    int direction = (span < 0.0) ? -1 : 1;
+    for (int i = 0; i < (int)steps; ++i) {
+        step(direction*m_step);
+        m_stepIndex += direction;
+    }
+
+    // The state stays on the grid of steps, the output is a shorter step away
+    Eigen::ArrayXd q[3];
+    Eigen::ArrayXd v[3];
+    for (int c = 0; c < 3; ++c) {
+        q[c] = m_q[c];
+        v[c] = m_v[c];
+    }
+    step(time-(m_startTime+m_stepIndex*m_step));
+    fromJacobi(m_q, m_output);
+    for (int c = 0; c < 3; ++c) {
+        m_q[c].swap(q[c]);
+        m_v[c].swap(v[c]);
+    }
+    return true;
+}
+
+Eigen::Vector3d NBodyIntegrator::position(int body) const
+{
+    return Eigen::Vector3d(m_output[0](body), m_output[1](body), m_output[2](body));
+}
+
+void NBodyIntegrator::step(double dt)
+{
+    drift(0.5*dt);
+    kick(dt);
+    drift(0.5*dt);
+}
+
+void NBodyIntegrator::drift(double dt)
+{
+    for (int i = 1; i < size(); ++i) {
+        Eigen::Vector3d q(m_q[0](i), m_q[1](i), m_q[2](i));
+        Eigen::Vector3d v(m_v[0](i), m_v[1](i), m_v[2](i));
+        keplerDrift(jacobiGM(i), dt, q, v);
+        for (int c = 0; c < 3; ++c) {
+            m_q[c](i) = q[c];
+            m_v[c](i) = v[c];
+        }
+    }
+}
+
+void NBodyIntegrator::kick(double dt)
+{
+    fromJacobi(m_q, m_x);
+    accelerations();
+    toJacobi(m_a, m_jacobiA);
+
+    // Minus the Keplerian part, already in the drifts
+    Eigen::ArrayXd distance2 = m_q[0].square()+m_q[1].square()+m_q[2].square();
+    distance2(0) = 1.0;
+    Eigen::ArrayXd scale = (m_innerGM+m_subsystemGM)/(distance2*distance2.sqrt());
+    scale(0) = 0.0;
+    for (int c = 0; c < 3; ++c) {
+        m_v[c] += dt*(m_jacobiA[c]+scale*m_q[c]);
+        m_v[c](0) = 0.0;
+    }
+}
+
+void NBodyIntegrator::accelerations()
+{
+    int n = size();
+    if (n < ParallelThreshold) {
+        Eigen::ArrayXd distance2(n);
+        Eigen::ArrayXd scale(n);
+        directSum(m_x, m_gm, 0, n, m_a, distance2, scale);
+        return;
+    }
+    int jobs = qMax(1, m_pool.maxThreadCount());
+    for (int j = 0; j < jobs; ++j) {
+        m_pool.start(new ForceJob(m_x, m_gm, n*j/jobs, n*(j+1)/jobs, m_a));
+    }
+    m_pool.waitForDone();
+}
+
+void NBodyIntegrator::toJacobi(const Eigen::ArrayXd *cartesian, Eigen::ArrayXd *jacobi) const
+{
+    int n = size();
+    for (int c = 0; c < 3; ++c) {
+        // Barycenters of the subsystems, the satellites come after their parent
+        Eigen::ArrayXd barycenter = m_gm*cartesian[c];
+        for (int i = n-1; i > 0; --i) {
+            barycenter(m_parent.at(i)) += barycenter(i);
+        }
+        // Massless bodies are their own barycenter
+        barycenter = (m_subsystemGM > 0.0).select(barycenter/m_subsystemGM, cartesian[c]);
+        // Weighted sum of the parent and of the satellites done so far
+        Eigen::ArrayXd inner = m_gm*cartesian[c];
+        jacobi[c].resize(n);
+        jacobi[c](0) = barycenter(0);
+        for (int i = 1; i < n; ++i) {
+            int parent = m_parent.at(i);
+            jacobi[c](i) = barycenter(i)-inner(parent)/m_innerGM(i);
+            inner(parent) += m_subsystemGM(i)*barycenter(i);
+        }
+    }
+}
+
+void NBodyIntegrator::fromJacobi(const Eigen::ArrayXd *jacobi, Eigen::ArrayXd *cartesian) const
+{
+    int n = size();
+    for (int c = 0; c < 3; ++c) {
+        Eigen::ArrayXd barycenter(n);
+        barycenter(0) = jacobi[c](0);
+        cartesian[c].resize(n);
+        // Peels the outer satellites off the barycenter of each subsystem
+        for (int p = 0; p < n; ++p) {
+            double inner = barycenter(p);
+            const QVector<int> &children = m_children.at(p);
+            for (int k = children.size()-1; k >= 0; --k) {
+                int i = children.at(k);
+                inner -= m_subsystemGM(i)/jacobiGM(i)*jacobi[c](i);
+                barycenter(i) = inner+jacobi[c](i);
+            }
+            cartesian[c](p) = inner;
+        }
+    }
+}
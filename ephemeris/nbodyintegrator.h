@@ -0,0 +1,85 @@
+#ifndef NBODYINTEGRATOR_H
+#define NBODYINTEGRATOR_H
+
+#include <QThreadPool>
+#include <QVector>
+
+#include "Eigen/Core"
+#include "Eigen/Geometry"
+
+// Mutual gravitation of the bodies, for the long time-lapses where the
+// Keplerian orbits drift apart. Wisdom-Holman mapping in hierarchical Jacobi
+// coordinates: a satellite orbits the barycenter of its parent and of the
+// inner satellites of the parent, so that the moons drift on Keplerian orbits
+// around their planet and the step is only bounded by the perturbations.
+// Positions in 10e3m, gravitational parameters in 10e9m^3/s^2, time in seconds
+// past J2000. The state is kept as arrays of components for the kernels.
+class NBodyIntegrator
+{
+public:
+    // Step as a fraction of the shortest period, the error is in step^2
+    static const int StepsPerRevolution = 32;
+    // Farther than that, integrate() gives up and the caller starts again
+    // from the elements. It runs once per frame under the lock of the view,
+    // this bounds its work to a few milliseconds. With Mimas setting the
+    // step, it still follows time-lapses of 200 days per second at 60 fps.
+    static const int MaxSteps = 128;
+    // Below that many bodies, the pool costs more than the forces
+    static const int ParallelThreshold = 256;
+
+    NBodyIntegrator();
+
+    // Depth first from the root, the satellites of a body in increasing
+    // distance: the order in which Body creates them. Returns the index.
+    int addBody(int parent, double gm);
+    int size() const {return m_parent.size();}
+    // Of the Keplerian part of the motion of the body, valid once all are added
+    double jacobiGM(int body) const {return m_innerGM(body)+m_subsystemGM(body);}
+
+    // Position and velocity of the satellite relative to the barycenter of
+    // its parent and of the inner satellites, the osculating elements of the
+    // catalog stand for that orbit.
+    void setJacobiState(int body, const Eigen::Vector3d &position, const Eigen::Vector3d &velocity);
+    void start(double time);
+    void stop() {m_running = false;}
+    bool isRunning() const {return m_running;}
+
+    // False when time is more than MaxSteps away from the state
+    bool integrate(double time);
+    // At the time of the last integrate() or start(), barycentric
+    Eigen::Vector3d position(int body) const;
+
+private:
+    void step(double dt);
+    void drift(double dt);
+    void kick(double dt);
+    void accelerations();
+    // Same linear map for positions, velocities and accelerations
+    void toJacobi(const Eigen::ArrayXd *cartesian, Eigen::ArrayXd *jacobi) const;
+    void fromJacobi(const Eigen::ArrayXd *jacobi, Eigen::ArrayXd *cartesian) const;
+
+    QVector<int> m_parent;
+    QVector<QVector<int> > m_children;
+    Eigen::ArrayXd m_gm;
+    // Of the body and all its satellites
+    Eigen::ArrayXd m_subsystemGM;
+    // Of the parent and the satellites of the parent inside the orbit
+    Eigen::ArrayXd m_innerGM;
+
+    // Jacobi state, index 0 is the barycenter of the system
+    Eigen::ArrayXd m_q[3];
+    Eigen::ArrayXd m_v[3];
+    // Scratch: barycentric positions, accelerations and output
+    Eigen::ArrayXd m_x[3];
+    Eigen::ArrayXd m_a[3];
+    Eigen::ArrayXd m_jacobiA[3];
+    Eigen::ArrayXd m_output[3];
+
+    bool m_running;
+    double m_startTime;
+    double m_step;
+    qint64 m_stepIndex;
+    QThreadPool m_pool;
+};
+
+#endif // NBODYINTEGRATOR_H
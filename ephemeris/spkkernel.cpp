@@ -0,0 +1,181 @@
+#include "spkkernel.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWeakPointer>
+#include <QDebug>
+#include <cmath>
+#include <cstring>
+
+static const int RecordLength = 1024;
+// Longest chain, e.g. the Moon, the Earth-Moon barycenter then the solar system barycenter
+static const int MaxChainLength = 4;
+static const int FrameJ2000 = 1;
+static const int FrameEclipticJ2000 = 17;
+// Obliquity of the ecliptic at J2000 used by SPICE for ECLIPJ2000
+static const double Obliquity = 84381.448/3600.0*M_PI/180.0;
+
+static qint32 readInt(const uchar *data)
+{
+    qint32 value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+SpkKernel::SpkKernel(const QString &fileName)
+    : m_file(fileName)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning()<<"Error loading file "<<m_file.fileName();
+        return;
+    }
+    const uchar *data = m_file.map(0, m_file.size());
+    if (!data || (m_file.size() < RecordLength)) {
+        qWarning()<<fileName<<"Unable to map the kernel";
+        return;
+    }
+    // File record
+    if (strncmp((const char*)data, "DAF/SPK ", 8) != 0) {
+        qWarning()<<fileName<<"Not a SPK kernel";
+        return;
+    }
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    const char *nativeFormat = "LTL-IEEE";
+#else
+    const char *nativeFormat = "BIG-IEEE";
+#endif
+    if (strncmp((const char*)data+88, nativeFormat, 8) != 0) {
+        qWarning()<<fileName<<"Byte order of the kernel not supported, use a"<<nativeFormat<<"kernel";
+        return;
+    }
+    int nd = readInt(data+8);
+    int ni = readInt(data+12);
+    int summaryRecord = readInt(data+76);
+    int summarySize = nd+(ni+1)/2; // doubles
+    if ((nd != 2) || (ni != 6)) {
+        qWarning()<<fileName<<"Unexpected summary format";
+        return;
+    }
+    const double *words = (const double*)data;
+    const qint64 wordCount = m_file.size()/sizeof(double);
+
+    // Summary records are chained, each one holds up to 25 segment summaries
+    while ( (summaryRecord > 0) && ((qint64)summaryRecord*RecordLength <= m_file.size()) ) {
+        const double *record = words+(qint64)(summaryRecord-1)*RecordLength/sizeof(double);
+        int next = (int)record[0];
+        int count = (int)record[2];
+        for (int i = 0; i < count; ++i) {
+            const double *summary = record+3+i*summarySize;
+            const uchar *integers = (const uchar*)(summary+nd);
+            int type = readInt(integers+12);
+            int frame = readInt(integers+8);
+            qint64 begin = readInt(integers+16);
+            qint64 end = readInt(integers+20);
+            if ( ((type != 2) && (type != 3))
+               ||((frame != FrameJ2000) && (frame != FrameEclipticJ2000))
+               ||(begin < 1) || (end > wordCount) || (end-begin < 4) ) {
+                continue;
+            }
+            Segment segment;
+            segment.target = readInt(integers);
+            segment.center = readInt(integers+4);
+            segment.ecliptic = (frame == FrameEclipticJ2000);
+            segment.components = (type == 2) ? 3 : 6;
+            segment.start = summary[0];
+            segment.end = summary[1];
+            // Directory at the end of the segment: INIT, INTLEN, RSIZE, N
+            const double *directory = words+end-4;
+            segment.initialEpoch = directory[0];
+            segment.intervalLength = directory[1];
+            segment.recordSize = (int)directory[2];
+            segment.recordCount = (int)directory[3];
+            segment.records = words+begin-1;
+            if ( (segment.intervalLength <= 0.0) || (segment.recordCount < 1)
+               ||(segment.recordSize < 2+segment.components)
+               ||((qint64)segment.recordSize*segment.recordCount > end-begin-3) ) {
+                continue;
+            }
+            m_segments.append(segment);
+        }
+        summaryRecord = next;
+    }
+    if (m_segments.isEmpty())
+        qWarning()<<fileName<<"No usable segment (only the Chebyshev types 2 and 3 are read)";
+}
+
+QSharedPointer<SpkKernel> SpkKernel::open(const QString &fileName)
+{
+    static QMutex mutex;
+    static QHash<QString, QWeakPointer<SpkKernel> > kernels;
+    QMutexLocker locker(&mutex);
+    QSharedPointer<SpkKernel> kernel = kernels.value(fileName).toStrongRef();
+    if (!kernel) {
+        kernel = QSharedPointer<SpkKernel>(new SpkKernel(fileName));
+        if (!kernel->isValid())
+            return QSharedPointer<SpkKernel>();
+        kernels.insert(fileName, kernel);
+    }
+    return kernel;
+}
+
+bool SpkKernel::position(int target, int center, double et, Eigen::Vector3d &position) const
+{
+    Eigen::Vector3d targetPosition;
+    Eigen::Vector3d centerPosition;
+    if (!fromBarycenter(target, et, targetPosition) || !fromBarycenter(center, et, centerPosition))
+        return false;
+    position = targetPosition-centerPosition;
+    return true;
+}
+
+const SpkKernel::Segment *SpkKernel::segment(int body, double et) const
+{
+    // A few segments per body at most, the last loaded one has the priority
+    for (int i = m_segments.size()-1; i >= 0; --i) {
+        const Segment &segment = m_segments.at(i);
+        if ( (segment.target == body) && (et >= segment.start) && (et <= segment.end) )
+            return &segment;
+    }
+    return 0;
+}
+
+bool SpkKernel::fromBarycenter(int body, double et, Eigen::Vector3d &position) const
+{
+    position = Eigen::Vector3d::Zero();
+    for (int i = 0; body != 0; ++i) {
+        const Segment *segment = this->segment(body, et);
+        if (!segment || (i == MaxChainLength))
+            return false;
+        position += evaluate(*segment, et);
+        body = segment->center;
+    }
+    return true;
+}
+
+Eigen::Vector3d SpkKernel::evaluate(const Segment &segment, double et)
+{
+    int index = (int)std::floor((et-segment.initialEpoch)/segment.intervalLength);
+    index = qBound(0, index, segment.recordCount-1);
+    const double *record = segment.records+(qint64)index*segment.recordSize;
+    // Record: midpoint, radius, then the coefficients of each component
+    double x = (et-record[0])/record[1];
+    int n = (segment.recordSize-2)/segment.components;
+    Eigen::Vector3d position;
+    for (int c = 0; c < 3; ++c) {
+        const double *coefficients = record+2+c*n;
+        double b1 = 0.0;
+        double b2 = 0.0;
+        for (int j = n-1; j > 0; --j) {
+            double b = 2.0*x*b1-b2+coefficients[j];
+            b2 = b1;
+            b1 = b;
+        }
+        position[c] = x*b1-b2+coefficients[0];
+    }
+    if (segment.ecliptic) {
+        // Back to equatorial
+        position = Eigen::AngleAxisd(Obliquity, Eigen::Vector3d::UnitX())*position;
+    }
+    return position;
+}
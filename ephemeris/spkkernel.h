@@ -0,0 +1,49 @@
+#ifndef SPKKERNEL_H
+#define SPKKERNEL_H
+
+#include <QFile>
+#include <QSharedPointer>
+#include <QVector>
+
+#include "Eigen/Geometry"
+
+// A JPL SPK kernel (DAF file, e.g. de440.bsp) mapped in memory. Opening it
+// only reads the segment summaries, the Chebyshev records of the type 2 and 3
+// segments are evaluated in place. A position costs a direct record lookup
+// whatever the time, the pages are brought in by the first access.
+class SpkKernel
+{
+public:
+    explicit SpkKernel(const QString &fileName);
+    bool isValid() const {return !m_segments.isEmpty();}
+    // Position of target relative to center in km, in the J2000 equatorial frame,
+    // the bodies are NAIF ids and et is in TDB seconds past J2000
+    bool position(int target, int center, double et, Eigen::Vector3d &position) const;
+
+    // Kernels used by several bodies are mapped once. Thread safe.
+    static QSharedPointer<SpkKernel> open(const QString &fileName);
+
+private:
+    struct Segment {
+        int target;
+        int center;
+        bool ecliptic; // ECLIPJ2000 instead of J2000
+        int components; // 3 for type 2, 6 for type 3 (velocities ignored)
+        double start;
+        double end;
+        double initialEpoch;
+        double intervalLength;
+        int recordSize; // doubles
+        int recordCount;
+        const double *records; // In the mapping
+    };
+
+    const Segment *segment(int body, double et) const;
+    bool fromBarycenter(int body, double et, Eigen::Vector3d &position) const;
+    static Eigen::Vector3d evaluate(const Segment &segment, double et);
+
+    QFile m_file;
+    QVector<Segment> m_segments;
+};
+
+#endif // SPKKERNEL_H
@@ -0,0 +1,76 @@
+#include "vsop87.h"
+
+#include <QFile>
+#include <QStringList>
+#include <QTextStream>
+#include <QDebug>
+#include <cmath>
+
+// The series are fitted over 4000 years around J2000
+static const double ValidMillennia = 2.0;
+static const double AstronomicalUnit = 149597.8707; // 10e3m
+
+Vsop87::Vsop87(const QString &fileName)
+    : m_valid(false)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning()<<"Error loading file "<<file.fileName();
+        return;
+    }
+    QTextStream data(&file);
+    QVector<Term> *terms = 0;
+    while (!data.atEnd()) {
+        QString line = data.readLine();
+        QStringList fields = line.simplified().split(' ');
+        if (line.contains("VSOP87")) {
+            // Header of a series, e.g.
+            // VSOP87 VERSION A1 EARTH VARIABLE 1 (XYZ) *T**0 1007 TERMS HELIOCENTRIC DYNAMICAL ECLIPTIC AND EQUINOX J2000
+            if (!fields.value(fields.indexOf("VERSION")+1).startsWith('A')) {
+                qWarning()<<fileName<<"Only the version A of VSOP87 is supported";
+                return;
+            }
+            int variable = fields.value(fields.indexOf("VARIABLE")+1).toInt()-1;
+            int power = line.mid(line.indexOf("*T**")+4, 1).toInt();
+            terms = ( (variable >= 0) && (variable < 3) && (power >= 0) && (power < Powers) )
+                    ? &m_terms[variable][power] : 0;
+            continue;
+        }
+        // The last three columns are the ones used by the rectangular series: A*cos(B+C*t)
+        if (!terms || (fields.size() < 3))
+            continue;
+        Term term;
+        term.amplitude = fields.at(fields.size()-3).toDouble();
+        term.phase = fields.at(fields.size()-2).toDouble();
+        term.frequency = fields.at(fields.size()-1).toDouble();
+        terms->append(term);
+    }
+    m_valid = !m_terms[0][0].isEmpty() && !m_terms[1][0].isEmpty() && !m_terms[2][0].isEmpty();
+    if (!m_valid)
+        qWarning()<<fileName<<"No VSOP87 series found";
+}
+
+bool Vsop87::position(double time, Eigen::Vector3d &position)
+{
+    // Julian millennia
+    double t = time/(86400.0*365250.0);
+    if (!m_valid || (std::abs(t) > ValidMillennia))
+        return false;
+
+    for (int c = 0; c < 3; ++c) {
+        double sum = 0.0;
+        double tPower = 1.0;
+        for (int power = 0; power < Powers; ++power) {
+            const QVector<Term> &terms = m_terms[c][power];
+            double series = 0.0;
+            for (int i = 0; i < terms.size(); ++i) {
+                const Term &term = terms.at(i);
+                series += term.amplitude*std::cos(term.phase+term.frequency*t);
+            }
+            sum += series*tPower;
+            tPower *= t;
+        }
+        position[c] = sum*AstronomicalUnit;
+    }
+    return true;
+}
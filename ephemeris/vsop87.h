@@ -0,0 +1,32 @@
+#ifndef VSOP87_H
+#define VSOP87_H
+
+#include "ephemeris.h"
+
+#include <QVector>
+
+// Heliocentric position of a planet from the VSOP87 theory, version A
+// (rectangular coordinates, ecliptic and equinox J2000). The series are read
+// from the files of the original distribution, e.g. VSOP87A.ear, the whole
+// series being kept, and evaluated only when the position is asked for.
+class Vsop87 : public Ephemeris
+{
+public:
+    explicit Vsop87(const QString &fileName);
+    bool isValid() const {return m_valid;}
+    bool position(double time, Eigen::Vector3d &position);
+
+private:
+    struct Term {
+        double amplitude; // AU
+        double phase; // rad
+        double frequency; // rad per Julian millennium
+    };
+    // Series are polynomials of degree 5 in time
+    static const int Powers = 6;
+
+    QVector<Term> m_terms[3][Powers];
+    bool m_valid;
+};
+
+#endif // VSOP87_H
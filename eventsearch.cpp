@@ -0,0 +1,385 @@
+#include "eventsearch.h"
+
+#include <QDebug>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// The greatest eclipse is within hours of the alignment in longitude
+static const double EclipseWindow = 6.0*3600.0; // s
+static const double TimeTolerance = 1.0; // s
+static const double AstronomicalUnit = 149597870.7; // km
+
+namespace {
+
+// Brent's root finding, f(a) and f(b) of opposite signs
+template <class Function>
+double findRoot(Function &f, double a, double b, double fa, double fb, double tolerance)
+{
+    double c = b;
+    double fc = fb;
+    double d = b-a;
+    double e = d;
+    for (int i = 0; i < 100; ++i) {
+        if ((fb > 0.0) == (fc > 0.0)) {
+            c = a;
+            fc = fa;
+            d = e = b-a;
+        }
+        if (std::abs(fc) < std::abs(fb)) {
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+        double tol = 2.0*std::numeric_limits<double>::epsilon()*std::abs(b)+0.5*tolerance;
+        double m = 0.5*(c-b);
+        if ((std::abs(m) <= tol) || (fb == 0.0))
+            return b;
+        if ((std::abs(e) >= tol) && (std::abs(fa) > std::abs(fb))) {
+            // Secant or inverse quadratic interpolation
+            double s = fb/fa;
+            double p, q;
+            if (a == c) {
+                p = 2.0*m*s;
+                q = 1.0-s;
+            } else {
+                double r = fb/fc;
+                q = fa/fc;
+                p = s*(2.0*m*q*(q-r)-(b-a)*(r-1.0));
+                q = (q-1.0)*(r-1.0)*(s-1.0);
+            }
+            if (p > 0.0)
+                q = -q;
+            else
+                p = -p;
+            if (2.0*p < qMin(3.0*m*q-std::abs(tol*q), std::abs(e*q))) {
+                e = d;
+                d = p/q;
+            } else {
+                d = e = m;
+            }
+        } else {
+            d = e = m;
+        }
+        a = b;
+        fa = fb;
+        b += (std::abs(d) > tol) ? d : ((m > 0.0) ? tol : -tol);
+        fb = f(b);
+    }
+    return b;
+}
+
+// Brent's minimization on [a, b], golden section and parabolic steps
+template <class Function>
+double findMinimum(Function &f, double a, double b, double tolerance)
+{
+    const double golden = 0.381966011250105;
+    double x = a+golden*(b-a);
+    double w = x;
+    double v = x;
+    double fx = f(x);
+    double fw = fx;
+    double fv = fx;
+    double d = 0.0;
+    double e = 0.0;
+    for (int i = 0; i < 100; ++i) {
+        double m = 0.5*(a+b);
+        if (std::abs(x-m) <= 2.0*tolerance-0.5*(b-a))
+            break;
+        bool parabolic = false;
+        if (std::abs(e) > tolerance) {
+            double r = (x-w)*(fx-fv);
+            double q = (x-v)*(fx-fw);
+            double p = (x-v)*q-(x-w)*r;
+            q = 2.0*(q-r);
+            if (q > 0.0)
+                p = -p;
+            else
+                q = -q;
+            if ((std::abs(p) < std::abs(0.5*q*e)) && (p > q*(a-x)) && (p < q*(b-x))) {
+                e = d;
+                d = p/q;
+                double u = x+d;
+                if ((u-a < 2.0*tolerance) || (b-u < 2.0*tolerance))
+                    d = (m > x) ? tolerance : -tolerance;
+                parabolic = true;
+            }
+        }
+        if (!parabolic) {
+            e = (x >= m) ? a-x : b-x;
+            d = golden*e;
+        }
+        double u = (std::abs(d) >= tolerance) ? x+d : x+((d > 0.0) ? tolerance : -tolerance);
+        double fu = f(u);
+        if (fu <= fx) {
+            if (u >= x)
+                a = x;
+            else
+                b = x;
+            v = w; fv = fw;
+            w = x; fw = fx;
+            x = u; fx = fu;
+        } else {
+            if (u < x)
+                a = u;
+            else
+                b = u;
+            if ((fu <= fw) || (w == x)) {
+                v = w; fv = fw;
+                w = u; fw = fu;
+            } else if ((fu <= fv) || (v == x) || (v == w)) {
+                v = u; fv = fu;
+            }
+        }
+    }
+    return x;
+}
+
+// Sine of the difference of ecliptic longitude between the target and the
+// sun seen from the observer: zero at conjunctions and oppositions
+double sunAngle(const PositionQuery::Evaluator &evaluator, int target)
+{
+    Eigen::Vector3d observer = evaluator.position(1);
+    Eigen::Vector3d toTarget = evaluator.position(target)-observer;
+    Eigen::Vector3d toSun = evaluator.position(0)-observer;
+    return toTarget.cross(toSun).z()/(toTarget.norm()*toSun.norm());
+}
+
+bool isConjunction(const PositionQuery::Evaluator &evaluator, int target)
+{
+    Eigen::Vector3d observer = evaluator.position(1);
+    return (evaluator.position(target)-observer).dot(evaluator.position(0)-observer) > 0.0;
+}
+
+// Position of the shadowed body along and off the axis of the shadow of the occulter
+void shadowAxis(const PositionQuery::Evaluator &evaluator, int occulter, int shadowed, double &along, double &offAxis)
+{
+    Eigen::Vector3d axis = (evaluator.position(occulter)-evaluator.position(0)).normalized();
+    Eigen::Vector3d v = evaluator.position(shadowed)-evaluator.position(occulter);
+    along = v.dot(axis);
+    offAxis = (v-along*axis).norm();
+}
+
+struct SunAngle {
+    SunAngle(PositionQuery::Evaluator &evaluator, int target) : evaluator(evaluator), target(target) {}
+    double operator()(double time)
+    {
+        evaluator.setTime(time);
+        return sunAngle(evaluator, target);
+    }
+    PositionQuery::Evaluator &evaluator;
+    int target;
+};
+
+struct Distance {
+    Distance(PositionQuery::Evaluator &evaluator, int target) : evaluator(evaluator), target(target) {}
+    double operator()(double time)
+    {
+        evaluator.setTime(time);
+        return (evaluator.position(target)-evaluator.position(1)).norm();
+    }
+    PositionQuery::Evaluator &evaluator;
+    int target;
+};
+
+struct OffAxis {
+    OffAxis(PositionQuery::Evaluator &evaluator, int occulter, int shadowed)
+        : evaluator(evaluator), occulter(occulter), shadowed(shadowed) {}
+    double operator()(double time)
+    {
+        evaluator.setTime(time);
+        double along, offAxis;
+        shadowAxis(evaluator, occulter, shadowed, along, offAxis);
+        return offAxis;
+    }
+    PositionQuery::Evaluator &evaluator;
+    int occulter;
+    int shadowed;
+};
+
+QString capitalized(const QString &name)
+{
+    return name.left(1).toUpper()+name.mid(1);
+}
+
+bool earlier(const Event &a, const Event &b)
+{
+    return a.time < b.time;
+}
+
+class SearchJob : public QRunnable
+{
+public:
+    SearchJob(const EventSearch &search, double begin, double end, QVector<Event> *events)
+        : m_search(search), m_begin(begin), m_end(end), m_events(events) {}
+
+    void run() {m_search.search(m_begin, m_end, *m_events);}
+
+private:
+    const EventSearch &m_search;
+    double m_begin;
+    double m_end;
+    QVector<Event> *m_events;
+};
+
+}
+
+EventSearch::EventSearch(const Catalog &catalog, const QString &observer)
+    : m_query(catalog)
+    , m_satelliteCount(0)
+{
+    const BodyDescriptor *root = catalog.body("sun");
+    const BodyDescriptor *observerDescriptor = catalog.body(observer);
+    if (!root || !observerDescriptor) {
+        qWarning()<<observer<<"not found in the catalog";
+        return;
+    }
+    QStringList names;
+    names << root->name << observer;
+    foreach (const QString &satellite, observerDescriptor->satellites) {
+        if (catalog.body(satellite)) {
+            names << satellite;
+            ++m_satelliteCount;
+        }
+    }
+    foreach (const QString &planet, root->satellites) {
+        if ((planet != observer) && catalog.body(planet))
+            names << planet;
+    }
+    if (!m_query.select(names))
+        return;
+    m_names = names;
+    foreach (const QString &name, m_names) {
+        m_radii.append(catalog.body(name)->radius*1000.0);
+    }
+}
+
+QVector<Event> EventSearch::search(double start, double end) const
+{
+    QVector<Event> events;
+    if (end <= start)
+        return events;
+    QThreadPool pool;
+    qint64 steps = (qint64)std::ceil((end-start)/ScanStep);
+    int jobs = qBound(1, (int)((end-start)/MinWindow), pool.maxThreadCount());
+    QVector<QVector<Event> > results(jobs);
+    for (int j = 0; j < jobs; ++j) {
+        // On the grid of the scan, so that the windows share no bracket
+        double begin = start+(steps*j/jobs)*(double)ScanStep;
+        double windowEnd = (j == jobs-1) ? end : start+(steps*(j+1)/jobs)*(double)ScanStep;
+        pool.start(new SearchJob(*this, begin, windowEnd, &results[j]));
+    }
+    pool.waitForDone();
+
+    foreach (const QVector<Event> &result, results) {
+        foreach (const Event &event, result) {
+            if ((event.time >= start) && (event.time < end))
+                events.append(event);
+        }
+    }
+    std::sort(events.begin(), events.end(), earlier);
+    return events;
+}
+
+void EventSearch::search(double begin, double end, QVector<Event> &events) const
+{
+    if (m_names.isEmpty() || (end <= begin))
+        return;
+    PositionQuery::Evaluator evaluator(m_query);
+    int targets = m_names.size()-2;
+    int count = (int)std::ceil((end-begin)/ScanStep);
+
+    // Samples -1 to count, the minima need both neighbours
+    QVector<double> angles((count+2)*targets);
+    QVector<double> distances((count+2)*targets);
+    for (int k = -1; k <= count; ++k) {
+        evaluator.setTime(begin+k*(double)ScanStep);
+        for (int j = 0; j < targets; ++j) {
+            angles[(k+1)*targets+j] = sunAngle(evaluator, j+2);
+            distances[(k+1)*targets+j] = (evaluator.position(j+2)-evaluator.position(1)).norm();
+        }
+    }
+
+    for (int k = 0; k < count; ++k) {
+        double time = begin+k*(double)ScanStep;
+        for (int j = 0; j < targets; ++j) {
+            int target = j+2;
+            const double *angle = angles.constData()+(k+1)*targets+j;
+            if ((angle[0] < 0.0) != (angle[targets] < 0.0)) {
+                SunAngle f(evaluator, target);
+                double alignment = findRoot(f, time, time+ScanStep, angle[0], angle[targets], TimeTolerance);
+                if (j < m_satelliteCount) {
+                    addSyzygy(evaluator, target, alignment, events);
+                } else {
+                    evaluator.setTime(alignment);
+                    Event event;
+                    event.type = isConjunction(evaluator, target) ? Event::Conjunction : Event::Opposition;
+                    event.time = alignment;
+                    event.body = m_names.at(target);
+                    event.description = capitalized(event.body)
+                                      + ((event.type == Event::Conjunction) ? " conjunction" : " opposition");
+                    events.append(event);
+                }
+            }
+
+            const double *distance = distances.constData()+(k+1)*targets+j;
+            if ((j >= m_satelliteCount) && (distance[-targets] > distance[0]) && (distance[0] <= distance[targets])) {
+                Distance f(evaluator, target);
+                Event event;
+                event.type = Event::ClosestApproach;
+                event.time = findMinimum(f, time-ScanStep, time+ScanStep, TimeTolerance);
+                event.body = m_names.at(target);
+                event.description = QString("%1 closest approach, %2 AU").arg(capitalized(event.body))
+                                    .arg(f(event.time)/AstronomicalUnit, 0, 'f', 3);
+                events.append(event);
+            }
+        }
+    }
+}
+
+void EventSearch::addSyzygy(PositionQuery::Evaluator &evaluator, int satellite, double time, QVector<Event> &events) const
+{
+    // At new moon the satellite shadows the observer, at full moon the other way around
+    evaluator.setTime(time);
+    bool solar = isConjunction(evaluator, satellite);
+    int occulter = solar ? satellite : 1;
+    int shadowed = solar ? 1 : satellite;
+    OffAxis f(evaluator, occulter, shadowed);
+    double greatest = findMinimum(f, time-EclipseWindow, time+EclipseWindow, TimeTolerance);
+
+    evaluator.setTime(greatest);
+    double along, offAxis;
+    shadowAxis(evaluator, occulter, shadowed, along, offAxis);
+    double sunDistance = (evaluator.position(occulter)-evaluator.position(0)).norm();
+    double sunRadius = m_radii.at(0);
+    double occulterRadius = m_radii.at(occulter);
+    double shadowedRadius = m_radii.at(shadowed);
+    double penumbra = occulterRadius+along*(sunRadius+occulterRadius)/sunDistance;
+    // Negative past the tip of the umbra
+    double umbra = occulterRadius-along*(sunRadius-occulterRadius)/sunDistance;
+    if (offAxis > penumbra+shadowedRadius)
+        return;
+
+    Event event;
+    event.time = greatest;
+    if (solar) {
+        event.type = Event::SolarEclipse;
+        event.body = m_names.at(1);
+        QString kind = "Partial";
+        if (offAxis < shadowedRadius)
+            kind = (umbra > 0.0) ? "Total" : "Annular";
+        event.description = kind+" solar eclipse";
+    } else {
+        event.type = Event::LunarEclipse;
+        event.body = m_names.at(satellite);
+        QString kind = "Penumbral";
+        if (offAxis+shadowedRadius < umbra)
+            kind = "Total";
+        else if (offAxis-shadowedRadius < umbra)
+            kind = "Partial";
+        event.description = kind+" lunar eclipse";
+    }
+    events.append(event);
+}
@@ -0,0 +1,57 @@
+#ifndef EVENTSEARCH_H
+#define EVENTSEARCH_H
+
+#include "positionquery.h"
+
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+struct Event {
+    enum Type {
+        SolarEclipse,
+        LunarEclipse,
+        Conjunction,
+        Opposition,
+        ClosestApproach
+    };
+    Type type;
+    double time; // Seconds past J2000, greatest eclipse or exact alignment
+    QString body; // The one to look at
+    QString description;
+};
+Q_DECLARE_METATYPE(Event)
+
+// Events seen from a body, the earth by default: eclipses with its
+// satellites, conjunctions, oppositions and closest approaches of the other
+// satellites of its parent. The span is scanned at a coarse step to bracket
+// the sign changes and the minima of geometric functions of the positions,
+// then Brent's methods refine them. Windows of the span run on a thread pool.
+class EventSearch
+{
+public:
+    // Shorter than a quarter of the shortest synodic period
+    static const int ScanStep = 86400; // s
+    // Each window builds its own evaluator, ephemerides with a cold cache,
+    // and scans a day past both of its edges: a year of daily samples makes
+    // that overhead negligible
+    static const int MinWindow = 365*86400; // s
+
+    explicit EventSearch(const Catalog &catalog, const QString &observer = "earth");
+
+    // Sorted by time
+    QVector<Event> search(double start, double end) const;
+    // Events in [begin, end) on the calling thread, begin on the scan grid
+    void search(double begin, double end, QVector<Event> &events) const;
+
+private:
+    void addSyzygy(PositionQuery::Evaluator &evaluator, int satellite, double time, QVector<Event> &events) const;
+
+    PositionQuery m_query;
+    // In the selection: the root, the observer, its satellites then the planets
+    int m_satelliteCount;
+    QStringList m_names;
+    QVector<double> m_radii; // km
+};
+
+#endif // EVENTSEARCH_H
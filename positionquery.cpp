@@ -0,0 +1,219 @@
+#include "positionquery.h"
+#include "bodymotion.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QRunnable>
+#include <QTextStream>
+#include <QThreadPool>
+
+static const quint32 PositionsMagic = 0x53535051; // "SSPQ"
+static const quint32 PositionsVersion = 1;
+
+namespace {
+
+class SampleJob : public QRunnable
+{
+public:
+    SampleJob(const PositionQuery &query, double start, double step, int begin, int end, double *output)
+        : m_query(query), m_start(start), m_step(step), m_begin(begin), m_end(end), m_output(output) {}
+
+    void run() {m_query.evaluate(m_start, m_step, m_begin, m_end, m_output);}
+
+private:
+    const PositionQuery &m_query;
+    double m_start;
+    double m_step;
+    int m_begin;
+    int m_end;
+    double *m_output;
+};
+
+}
+
+PositionQuery::PositionQuery(const Catalog &catalog, const QString &root)
+    : m_catalog(catalog)
+{
+    const BodyDescriptor *descriptor = catalog.body(root);
+    if (!descriptor) {
+        qWarning()<<root<<"not found in the catalog";
+        return;
+    }
+    add(*descriptor, -1);
+    select(QStringList());
+}
+
+void PositionQuery::add(const BodyDescriptor &descriptor, int parent)
+{
+    // Depth first, like Body
+    int index = m_bodies.size();
+    m_bodies.append(&descriptor);
+    m_parents.append(parent);
+    foreach (const QString &satellite, descriptor.satellites) {
+        const BodyDescriptor *satelliteDescriptor = m_catalog.body(satellite);
+        if (!satelliteDescriptor) {
+            qWarning()<<satellite<<"not found in the catalog";
+            continue;
+        }
+        add(*satelliteDescriptor, index);
+    }
+}
+
+bool PositionQuery::select(const QStringList &names)
+{
+    QVector<int> selection;
+    if (names.isEmpty()) {
+        for (int i = 0; i < m_bodies.size(); ++i) {
+            selection.append(i);
+        }
+    }
+    foreach (const QString &name, names) {
+        int index = -1;
+        for (int i = 0; i < m_bodies.size(); ++i) {
+            if (m_bodies.at(i)->name == name) {
+                index = i;
+                break;
+            }
+        }
+        if (index < 0) {
+            qWarning()<<name<<"not found in the catalog";
+            return false;
+        }
+        selection.append(index);
+    }
+    m_selection = selection;
+    m_needed.fill(false, m_bodies.size());
+    foreach (int index, m_selection) {
+        for (int i = index; i >= 0; i = m_parents.at(i)) {
+            m_needed[i] = true;
+        }
+    }
+    return true;
+}
+
+QStringList PositionQuery::selection() const
+{
+    QStringList names;
+    foreach (int index, m_selection) {
+        names.append(m_bodies.at(index)->name);
+    }
+    return names;
+}
+
+QVector<double> PositionQuery::evaluate(double start, double step, int samples) const
+{
+    QVector<double> positions(samples*m_selection.size()*3);
+    QThreadPool pool;
+    int jobs = qBound(1, samples/MinSamplesPerJob, pool.maxThreadCount());
+    for (int j = 0; j < jobs; ++j) {
+        int begin = (qint64)samples*j/jobs;
+        int end = (qint64)samples*(j+1)/jobs;
+        pool.start(new SampleJob(*this, start, step, begin, end, positions.data()+begin*m_selection.size()*3));
+    }
+    pool.waitForDone();
+    return positions;
+}
+
+void PositionQuery::evaluate(double start, double step, int begin, int end, double *output) const
+{
+    Evaluator evaluator(*this);
+    for (int sample = begin; sample < end; ++sample) {
+        evaluator.setTime(start+sample*step);
+        for (int i = 0; i < m_selection.size(); ++i) {
+            Eigen::Vector3d position = evaluator.position(i);
+            *output++ = position.x();
+            *output++ = position.y();
+            *output++ = position.z();
+        }
+    }
+}
+
+bool PositionQuery::writeHeader(QIODevice *device, Format format, double start, double step, int samples) const
+{
+    if (format == Csv) {
+        QTextStream stream(device);
+        stream << "time";
+        foreach (const QString &name, selection()) {
+            stream << ',' << name << ".x," << name << ".y," << name << ".z";
+        }
+        stream << '\n';
+        stream.flush();
+        return stream.status() == QTextStream::Ok;
+    }
+    // The encoding of the QStringList depends on the stream version
+    QDataStream stream(device);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream << PositionsMagic << PositionsVersion << selection() << start << step << (qint32)samples;
+    return stream.status() == QDataStream::Ok;
+}
+
+bool PositionQuery::writeSamples(QIODevice *device, Format format, double start, double step, const QVector<double> &positions) const
+{
+    if (format == Binary) {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        // Already in the byte order of the file
+        qint64 size = positions.size()*sizeof(double);
+        return device->write(reinterpret_cast<const char*>(positions.constData()), size) == size;
+#else
+        QDataStream stream(device);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream.setByteOrder(QDataStream::LittleEndian);
+        foreach (double position, positions)
+            stream << position;
+        return stream.status() == QDataStream::Ok;
+#endif
+    }
+    QTextStream stream(device);
+    stream.setRealNumberNotation(QTextStream::SmartNotation);
+    stream.setRealNumberPrecision(15);
+    int stride = m_selection.size()*3;
+    for (int sample = 0; stride*sample < positions.size(); ++sample) {
+        stream << start+sample*step;
+        for (int i = 0; i < stride; ++i) {
+            stream << ',' << positions.at(sample*stride+i);
+        }
+        stream << '\n';
+    }
+    stream.flush();
+    return stream.status() == QTextStream::Ok;
+}
+
+PositionQuery::Evaluator::Evaluator(const PositionQuery &query)
+    : m_query(query)
+    , m_motions(query.m_bodies.size(), 0)
+{
+    // The ephemerides keep a cache, each evaluator has its own
+    for (int i = 0; i < m_motions.size(); ++i) {
+        if (!query.m_needed.at(i))
+            continue;
+        const BodyDescriptor *descriptor = query.m_bodies.at(i);
+        bool hasOrbit = (query.m_parents.at(i) >= 0);
+        QSharedPointer<Ephemeris> ephemeris;
+        if (hasOrbit)
+            ephemeris = Ephemeris::create(descriptor->ephemeris, descriptor->orbit.revolutionPeriod);
+        m_motions[i] = new BodyMotion(*descriptor, hasOrbit, ephemeris);
+    }
+}
+
+PositionQuery::Evaluator::~Evaluator()
+{
+    qDeleteAll(m_motions);
+}
+
+void PositionQuery::Evaluator::setTime(double time)
+{
+    for (int i = 0; i < m_motions.size(); ++i) {
+        if (m_motions.at(i)) {
+            int parent = m_query.m_parents.at(i);
+            m_motions[i]->setTime(time, (parent >= 0) ? m_motions.at(parent) : 0);
+        }
+    }
+}
+
+Eigen::Vector3d PositionQuery::Evaluator::position(int i) const
+{
+    const BodyMotion *root = m_motions.first();
+    const BodyMotion *body = m_motions.at(m_query.m_selection.at(i));
+    return root->ecliptic().transpose()*(body->center()-root->center())*1000.0;
+}
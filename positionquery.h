@@ -0,0 +1,74 @@
+#ifndef POSITIONQUERY_H
+#define POSITIONQUERY_H
+
+#include "catalog.h"
+
+#include "Eigen/Geometry"
+
+#include <QIODevice>
+#include <QStringList>
+#include <QVector>
+
+// Positions of the bodies of a catalog over a span of time, without GL nor
+// window. The frames are those of Body, through BodyMotion; the N-body mode
+// is not used. The samples are split in contiguous blocks among threads,
+// each with its own copy of the bodies and of their ephemerides.
+class BodyMotion;
+
+class PositionQuery
+{
+public:
+    // The selection moved on the calling thread, with its own ephemerides
+    class Evaluator
+    {
+    public:
+        explicit Evaluator(const PositionQuery &query);
+        ~Evaluator();
+        void setTime(double time);
+        // Of the i-th body of the selection, like evaluate()
+        Eigen::Vector3d position(int i) const;
+
+    private:
+        Q_DISABLE_COPY(Evaluator)
+        const PositionQuery &m_query;
+        QVector<BodyMotion*> m_motions; // Null when not needed
+    };
+
+    enum Format {Csv, Binary};
+    // Below that, a thread is not worth its ephemerides
+    static const int MinSamplesPerJob = 1024;
+
+    // The root is "sun", like in the viewer
+    explicit PositionQuery(const Catalog &catalog, const QString &root = "sun");
+
+    // Empty for all the bodies, depth first. False when one is unknown.
+    bool select(const QStringList &names);
+    QStringList selection() const;
+
+    // Heliocentric positions in the J2000 ecliptic, in km: x, y, z of each
+    // body of the selection, one sample after the other. The samples are at
+    // start, start+step... seconds past J2000.
+    QVector<double> evaluate(double start, double step, int samples) const;
+    // The samples [begin, end) on the calling thread, output holds the
+    // positions of sample begin first.
+    void evaluate(double start, double step, int begin, int end, double *output) const;
+
+    // Csv: a line of names then the time and the positions of each sample.
+    // Binary: a little endian QDataStream of version Qt_5_0, see writeHeader,
+    // then the doubles of evaluate(), little endian on any host.
+    bool writeHeader(QIODevice *device, Format format, double start, double step, int samples) const;
+    bool writeSamples(QIODevice *device, Format format, double start, double step, const QVector<double> &positions) const;
+
+private:
+    void add(const BodyDescriptor &descriptor, int parent);
+
+    const Catalog &m_catalog;
+    // The tree depth first, the parent comes before its satellites
+    QVector<const BodyDescriptor*> m_bodies;
+    QVector<int> m_parents;
+    QVector<int> m_selection;
+    // The selection and their parents, the ones a job has to move
+    QVector<bool> m_needed;
+};
+
+#endif // POSITIONQUERY_H
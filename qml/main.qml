@@ -199,6 +199,57 @@ Item {
         }
     }
 
+    Image {
+        id: eventsIcon
+        anchors.bottom: configIcon.top
+        anchors.right: renderer.right
+        anchors.margins: 20
+        width: Style.iconSize
+        height: width
+        source: "../icons/info_icon.png"
+        MouseArea {
+            anchors.fill: parent
+            onClicked: {
+                mainItem.state = (mainItem.state == "events") ? "clean" : "events";
+                // Searched again only if the time moved since the last search
+                if (mainItem.state == "events")
+                    renderer.searchEvents();
+            }
+        }
+    }
+
+    Rectangle {
+        id: eventList
+        anchors.bottom: renderer.bottom
+        anchors.right: eventsIcon.left
+        anchors.rightMargin: 20
+        width: 280*Style.sizeScale
+        height: 200*Style.sizeScale
+        clip: true
+        radius: 5
+        color: Style.panelColor
+        border.color: Style.panelBorderColor
+        border.width: 2
+        ListView {
+            anchors.fill: parent
+            anchors.topMargin: 2
+            anchors.bottomMargin: anchors.topMargin
+            anchors.leftMargin: 5
+            anchors.rightMargin: anchors.leftMargin
+            boundsBehavior: Flickable.StopAtBounds
+            model: renderer.events
+            delegate: CustomText {
+                text: modelData
+                MouseArea {
+                    anchors.fill: parent
+                    onClicked: {
+                        renderer.goToEvent(index)
+                    }
+                }
+            }
+        }
+    }
+
     Rectangle {
         id: configPanel
         anchors.bottom: renderer.bottom
@@ -244,6 +295,16 @@ Item {
                     checked: renderer.showOrbits
                     onClicked: renderer.showOrbits = !renderer.showOrbits
                 }
+                CustomCheckBox {
+                    text: qsTr("Trails")
+                    checked: renderer.showTrails
+                    onClicked: renderer.showTrails = !renderer.showTrails
+                }
+                CustomCheckBox {
+                    text: qsTr("N-body")
+                    checked: renderer.nBody
+                    onClicked: renderer.nBody = !renderer.nBody
+                }
             }
         }
 
@@ -329,6 +390,13 @@ Item {
                     checked: renderer.antiAliasingType === Renderer.FXAA
                     onClicked: renderer.antiAliasingType = Renderer.FXAA
                 }
+                CustomRadioButton {
+                    id: taaButton
+                    text: qsTr("Temporal")
+                    exclusiveGroup: aagroup
+                    checked: renderer.antiAliasingType === Renderer.TAA
+                    onClicked: renderer.antiAliasingType = Renderer.TAA
+                }
             }
         }
     }
@@ -347,6 +415,11 @@ Item {
                 anchors.top: renderer.bottom
                 anchors.bottom: undefined
             }
+            AnchorChanges {
+                target: eventList
+                anchors.top: renderer.bottom
+                anchors.bottom: undefined
+            }
             AnchorChanges {
                 target: timeLineRow
                 anchors.top: renderer.bottom
@@ -365,6 +438,11 @@ Item {
                 anchors.top: renderer.bottom
                 anchors.bottom: undefined
             }
+            AnchorChanges {
+                target: eventList
+                anchors.top: renderer.bottom
+                anchors.bottom: undefined
+            }
             AnchorChanges {
                 target: timeLineRow
                 anchors.top: undefined
@@ -383,6 +461,11 @@ Item {
                 anchors.top: undefined
                 anchors.bottom: renderer.bottom
             }
+            AnchorChanges {
+                target: eventList
+                anchors.top: renderer.bottom
+                anchors.bottom: undefined
+            }
             AnchorChanges {
                 target: timeLineRow
                 anchors.top: renderer.bottom
@@ -401,6 +484,34 @@ Item {
                 anchors.top: renderer.bottom
                 anchors.bottom: undefined
             }
+            AnchorChanges {
+                target: eventList
+                anchors.top: renderer.bottom
+                anchors.bottom: undefined
+            }
+            AnchorChanges {
+                target: timeLineRow
+                anchors.top: renderer.bottom
+                anchors.bottom: undefined
+            }
+        },
+        State {
+            name: "events"
+            AnchorChanges {
+                target: configPanel
+                anchors.top: renderer.bottom
+                anchors.bottom: undefined
+            }
+            AnchorChanges {
+                target: bodyList
+                anchors.top: renderer.bottom
+                anchors.bottom: undefined
+            }
+            AnchorChanges {
+                target: eventList
+                anchors.top: undefined
+                anchors.bottom: renderer.bottom
+            }
             AnchorChanges {
                 target: timeLineRow
                 anchors.top: renderer.bottom
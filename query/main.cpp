@@ -0,0 +1,100 @@
+#include "positionquery.h"
+#include "timeline.h"
+#include "path.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+
+// Samples per block written, bounds the memory for long spans
+static const int BlockSamples = 65536;
+
+// ISO 8601 (UTC when no offset is given) or seconds past J2000
+static bool parseTime(const QString &value, double &time)
+{
+    QDateTime dateTime = QDateTime::fromString(value, Qt::ISODate);
+    if (dateTime.isValid()) {
+        if (dateTime.timeSpec() == Qt::LocalTime)
+            dateTime.setTimeSpec(Qt::UTC);
+        time = Timeline::toTime(dateTime);
+        return true;
+    }
+    bool ok;
+    time = value.toDouble(&ok);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("solarsystem-query");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Heliocentric positions of the bodies in the J2000 ecliptic, in km.");
+    parser.addHelpOption();
+    QCommandLineOption catalogOption(QStringList() << "c" << "catalog", "Catalog of the bodies.", "file", resPath()+"data/data.txt");
+    QCommandLineOption bodiesOption(QStringList() << "b" << "bodies", "Comma separated names, all the bodies if omitted.", "names");
+    QCommandLineOption startOption(QStringList() << "s" << "start", "First sample, ISO 8601 or seconds past J2000.", "time");
+    QCommandLineOption endOption(QStringList() << "e" << "end", "Last sample, included.", "time");
+    QCommandLineOption stepOption("step", "Seconds between the samples.", "seconds", "60");
+    QCommandLineOption formatOption(QStringList() << "f" << "format", "csv or binary.", "format", "csv");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Output file, standard output if omitted.", "file");
+    parser.addOption(catalogOption);
+    parser.addOption(bodiesOption);
+    parser.addOption(startOption);
+    parser.addOption(endOption);
+    parser.addOption(stepOption);
+    parser.addOption(formatOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    double start, end;
+    if (!parseTime(parser.value(startOption), start) || !parseTime(parser.value(endOption), end)) {
+        err << "Invalid or missing --start or --end\n";
+        return 1;
+    }
+    double step = parser.value(stepOption).toDouble();
+    if ((step <= 0.0) || (end < start)) {
+        err << "The step must be positive and the end after the start\n";
+        return 1;
+    }
+    qint64 samples = (qint64)((end-start)/step)+1;
+    if (samples > 0x7fffffff) {
+        err << "Too many samples\n";
+        return 1;
+    }
+    PositionQuery::Format format = (parser.value(formatOption) == "binary") ? PositionQuery::Binary : PositionQuery::Csv;
+
+    Catalog catalog;
+    if (!catalog.load(parser.value(catalogOption)))
+        return 1;
+    PositionQuery query(catalog);
+    if (parser.isSet(bodiesOption) && !query.select(parser.value(bodiesOption).split(',', QString::SkipEmptyParts)))
+        return 1;
+
+    QFile output;
+    bool opened;
+    if (parser.isSet(outputOption)) {
+        output.setFileName(parser.value(outputOption));
+        opened = output.open(QIODevice::WriteOnly);
+    } else {
+        opened = output.open(stdout, QIODevice::WriteOnly);
+    }
+    if (!opened) {
+        err << "Unable to write " << parser.value(outputOption) << '\n';
+        return 1;
+    }
+
+    if (!query.writeHeader(&output, format, start, step, samples))
+        return 1;
+    for (qint64 first = 0; first < samples; first += BlockSamples) {
+        int count = qMin((qint64)BlockSamples, samples-first);
+        double blockStart = start+first*step;
+        if (!query.writeSamples(&output, format, blockStart, step, query.evaluate(blockStart, step, count)))
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+TEMPLATE = app
+TARGET   = solarsystem-query
+
+# No window nor GL, QtGui only for the vector types of the catalog
+QT += gui
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+HEADERS +=  \
+    ../catalog.h \
+    ../bodymotion.h \
+    ../positionquery.h \
+    ../timeline.h \
+    ../path.h \
+    ../renderable/orbit.h \
+    ../ephemeris/ephemeris.h \
+    ../ephemeris/chebyshevcache.h \
+    ../ephemeris/elp2000.h \
+    ../ephemeris/vsop87.h \
+    ../ephemeris/spkkernel.h \
+    ../ephemeris/jplephemeris.h
+
+SOURCES +=  \
+    main.cpp \
+    ../catalog.cpp \
+    ../bodymotion.cpp \
+    ../positionquery.cpp \
+    ../timeline.cpp \
+    ../renderable/orbit.cpp \
+    ../ephemeris/ephemeris.cpp \
+    ../ephemeris/chebyshevcache.cpp \
+    ../ephemeris/elp2000.cpp \
+    ../ephemeris/vsop87.cpp \
+    ../ephemeris/spkkernel.cpp \
+    ../ephemeris/jplephemeris.cpp
@@ -0,0 +1,361 @@
+#include "atmosphere.h"
+#include "renderstate.h"
+
+#include <cmath>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+// Bump when the lookup tables layout or computation changes
+static const quint32 CacheVersion = 1;
+static const int TransmittanceWidth = 64; // Altitude
+static const int TransmittanceHeight = 32; // Cosine of the zenith angle
+static const int InscatterWidth = 64; // Ground hitting rays, then impact parameter
+static const int InscatterHeight = 64; // Cosine of the sun zenith angle
+static const int IntegrationSteps = 32;
+// Rays through the limb are long compared to the scale heights
+static const int InscatterSteps = 128;
+
+namespace {
+
+// Single scattering integration, independent of any GL state
+class Scattering
+{
+public:
+    Scattering(float radius, const AtmosphereParameters &parameters)
+        : m_radius(radius), m_parameters(parameters) {}
+    Atmosphere::Tables precompute() const;
+
+private:
+    void quantize(const QVector<double> &values, int width, int height, Atmosphere::LookupTable &table) const;
+    double opticalDepth(double r, double mu, double length, double scaleHeight) const;
+    Eigen::Vector3d transmittance(double r, double mu) const;
+
+    double m_radius;
+    AtmosphereParameters m_parameters;
+};
+
+}
+
+Atmosphere::Atmosphere(float radius, const AtmosphereParameters &parameters, QObject *parent)
+    : Renderable(parent)
+    , m_radius(radius)
+    , m_parameters(parameters)
+    , m_transmittanceTexture(0)
+    , m_inscatterTexture(0)
+    , m_indexBuffer(QOpenGLBuffer::IndexBuffer)
+    , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
+{
+    init(createTables(radius, parameters));
+}
+
+Atmosphere::Atmosphere(float radius, const AtmosphereParameters &parameters, const Tables &tables, QObject *parent)
+    : Renderable(parent)
+    , m_radius(radius)
+    , m_parameters(parameters)
+    , m_transmittanceTexture(0)
+    , m_inscatterTexture(0)
+    , m_indexBuffer(QOpenGLBuffer::IndexBuffer)
+    , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
+{
+    init(tables);
+}
+
+Atmosphere::Tables Atmosphere::createTables(float radius, const AtmosphereParameters &parameters)
+{
+    // Scattering is far too expensive to integrate per pixel, so it is done once
+    // and stored in two small lookup textures. They only depend on the parameters.
+    Tables tables;
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    QString cacheFile = cacheDir+"/atmosphere-"+cacheKey(radius, parameters).toHex()+".lut";
+    if (!loadCache(cacheFile, tables)) {
+        tables = Scattering(radius, parameters).precompute();
+        QDir().mkpath(cacheDir);
+        saveCache(cacheFile, tables);
+    }
+    return tables;
+}
+
+void Atmosphere::init(const Tables &tables)
+{
+    setShaders(m_program, "atmosphere");
+    checkProgram(m_program);
+
+    m_transmittanceTexture = createTexture(tables.transmittance);
+    m_inscatterTexture = createTexture(tables.inscatter);
+
+    // The shell geometry, the shader does the rest
+    const float outerRadius = m_radius+m_parameters.height;
+    const int nSub = 64;
+    for( int i = 0; i <= nSub; ++i ) {
+        float theta = (float)i/(float)nSub*2.0*M_PI;
+        for( int j = 0; j <= nSub; ++j ) {
+            float phi = (float)j/(float)nSub*M_PI;
+            m_vertices.append(outerRadius*QVector3D(cos(theta)*sin(phi),
+                                                    sin(theta)*sin(phi),
+                                                    cos(phi)));
+        }
+    }
+    for( int i = 0; i < nSub; ++i ) {
+        for( int j = 0; j <= nSub; ++j ) {
+            m_indices.append((i+1)*(nSub+1)+j);
+            m_indices.append(i*(nSub+1)+j);
+        }
+    }
+
+    m_program.bind();
+    m_program.setUniformValue("texture0", 0);
+    m_program.setUniformValue("texture1", 1);
+    m_program.setUniformValue("radii", QVector2D(m_radius, outerRadius));
+    m_program.setUniformValue("mieG", (GLfloat)m_parameters.mieG);
+    m_program.setUniformValue("transmittanceScale", tables.transmittance.scale);
+    m_program.setUniformValue("inscatterScale", tables.inscatter.scale);
+    m_program.release();
+
+    m_dataSize = m_indices.size();
+    // Atmosphere indices buffer init
+    m_indexBuffer.create();
+    m_indexBuffer.bind();
+    m_indexBuffer.allocate(m_indices.constData(), m_indices.size() * sizeof(int));
+    m_indexBuffer.release();
+    m_indices.clear();
+    // Atmosphere vertex buffer init
+    m_vertexBuffer.create();
+    m_vertexBuffer.bind();
+    m_vertexBuffer.allocate(m_vertices.constData(), m_vertices.size() * sizeof(QVector3D));
+    m_vertexBuffer.release();
+    m_vertices.clear();
+
+    createVAO();
+}
+
+Atmosphere::~Atmosphere()
+{
+    m_indexBuffer.destroy();
+    m_vertexBuffer.destroy();
+    glDeleteTextures(1, &m_transmittanceTexture);
+    glDeleteTextures(1, &m_inscatterTexture);
+}
+
+void Atmosphere::createVAO()
+{
+    m_vao.create();
+    m_vao.bind();
+
+    m_program.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+
+    m_vertexBuffer.bind();
+    m_program.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3);
+    m_vertexBuffer.release();
+
+    m_indexBuffer.bind();
+
+    m_vao.release();
+
+    m_indexBuffer.release();
+
+    m_program.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+}
+
+void Atmosphere::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+{
+    RenderState *state = RenderState::instance();
+    state->useProgram(m_program);
+
+    Eigen::Affine3d modelView = view*model;
+    setUniformMatrix(m_program.uniformLocation("modelViewMatrix"), modelView);
+    setUniformMatrix(m_program.uniformLocation("projectionMatrix"), projection);
+    setUniformVector(m_program.uniformLocation("planetCenter"), Eigen::Vector3d(modelView.translation()));
+    setUniformVector(m_program.uniformLocation("light.Position"), view*Eigen::Vector4d(0.0, 0.0, 0.0, 1.0));
+    m_program.setUniformValue("logZbufferC", m_logZbufferC);
+    m_program.setUniformValue("C", m_C);
+
+    state->bindTexture(1, m_inscatterTexture);
+    state->bindTexture(0, m_transmittanceTexture);
+
+    RenderState::State drawState;
+    // From the outside we see the front of the shell, including over the planet disc.
+    // From the inside only the back of the shell surrounds the camera.
+    bool inside = modelView.translation().norm() < m_radius+m_parameters.height;
+    drawState.cull = true;
+    drawState.cullFace = inside ? GL_FRONT : GL_BACK;
+    // dst = inscatter + dst*transmittance
+    drawState.blend = true;
+    drawState.blendSource = GL_ONE;
+    drawState.blendDestination = GL_SRC_ALPHA;
+    drawState.depthWrite = false;
+    state->apply(drawState);
+    m_vao.bind();
+    glDrawElements(GL_TRIANGLE_STRIP, m_dataSize, GL_UNSIGNED_INT, 0);
+    m_vao.release();
+}
+
+QByteArray Atmosphere::cacheKey(float radius, const AtmosphereParameters &parameters)
+{
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream << CacheVersion << radius << parameters.height
+           << parameters.rayleigh.x() << parameters.rayleigh.y() << parameters.rayleigh.z()
+           << parameters.rayleighScaleHeight << parameters.mie << parameters.mieScaleHeight;
+    return QCryptographicHash::hash(key, QCryptographicHash::Sha1);
+}
+
+bool Atmosphere::loadCache(const QString &fileName, Tables &tables)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream stream(&file);
+    quint32 version;
+    stream >> version;
+    if (version != CacheVersion)
+        return false;
+    stream >> tables.transmittance.width >> tables.transmittance.height >> tables.transmittance.scale >> tables.transmittance.data;
+    stream >> tables.inscatter.width >> tables.inscatter.height >> tables.inscatter.scale >> tables.inscatter.data;
+    if ( (stream.status() != QDataStream::Ok)
+       ||(tables.transmittance.data.size() != 4*tables.transmittance.width*tables.transmittance.height)
+       ||(tables.inscatter.data.size() != 4*tables.inscatter.width*tables.inscatter.height) ) {
+        qWarning()<<fileName<<"Corrupted atmosphere cache";
+        return false;
+    }
+    return true;
+}
+
+void Atmosphere::saveCache(const QString &fileName, const Tables &tables)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning()<<fileName<<"Unable to write atmosphere cache";
+        return;
+    }
+    QDataStream stream(&file);
+    stream << CacheVersion;
+    stream << tables.transmittance.width << tables.transmittance.height << tables.transmittance.scale << tables.transmittance.data;
+    stream << tables.inscatter.width << tables.inscatter.height << tables.inscatter.scale << tables.inscatter.data;
+}
+
+double Scattering::opticalDepth(double r, double mu, double length, double scaleHeight) const
+{
+    // Integral of the density exp(-h/H) along a ray of the given length, trapezoidal rule
+    double dt = length/IntegrationSteps;
+    double result = 0.0;
+    double previous = exp(-(r-m_radius)/scaleHeight);
+    for (int i = 1; i <= IntegrationSteps; ++i) {
+        double t = i*dt;
+        double ri = sqrt(r*r+t*t+2.0*r*mu*t);
+        double current = exp(-(ri-m_radius)/scaleHeight);
+        result += (previous+current)*0.5*dt;
+        previous = current;
+    }
+    return result;
+}
+
+Eigen::Vector3d Scattering::transmittance(double r, double mu) const
+{
+    // Up to the top of the atmosphere, rays hitting the ground are fully absorbed
+    const double top = m_radius+m_parameters.height;
+    if ( (mu < 0.0) && (r*r*(mu*mu-1.0)+m_radius*m_radius >= 0.0) )
+        return Eigen::Vector3d::Zero();
+    double length = -r*mu+sqrt(qMax(0.0, r*r*(mu*mu-1.0)+top*top));
+    Eigen::Vector3d tau = m_parameters.rayleigh*opticalDepth(r, mu, length, m_parameters.rayleighScaleHeight)
+                        + Eigen::Vector3d::Constant(m_parameters.mie/0.9*opticalDepth(r, mu, length, m_parameters.mieScaleHeight));
+    return Eigen::Vector3d(exp(-tau.x()), exp(-tau.y()), exp(-tau.z()));
+}
+
+Atmosphere::Tables Scattering::precompute() const
+{
+    Atmosphere::Tables tables;
+    const double top = m_radius+m_parameters.height;
+
+    // Transmittance from an altitude towards the top of the atmosphere, for upward rays.
+    QVector<double> transmittance;
+    for (int j = 0; j < TransmittanceHeight; ++j) {
+        double mu = (j+0.5)/TransmittanceHeight;
+        for (int i = 0; i < TransmittanceWidth; ++i) {
+            double r = m_radius+(i+0.5)/TransmittanceWidth*m_parameters.height;
+            Eigen::Vector3d t = this->transmittance(r, mu);
+            transmittance << t.x() << t.y() << t.z() << t.mean();
+        }
+    }
+
+    // Single scattering along representative rays, without the phase functions.
+    // The first half of the table holds rays ending on the ground, indexed by the cosine
+    // of the view zenith angle at the ground. The second half holds rays going through,
+    // indexed by their closest altitude. The sun is placed perpendicular to the ray.
+    QVector<double> inscatter;
+    for (int j = 0; j < InscatterHeight; ++j) {
+        double muS = -1.0+2.0*(j+0.5)/InscatterHeight;
+        Eigen::Vector3d sun(muS, 0.0, sqrt(1.0-muS*muS));
+        for (int i = 0; i < InscatterWidth; ++i) {
+            double u = (i+0.5)/InscatterWidth;
+            Eigen::Vector3d start; // Camera side
+            Eigen::Vector3d direction;
+            double length;
+            if (u < 0.5) {
+                double muG = qMax(2.0*u, 1e-3);
+                Eigen::Vector3d up(muG, sqrt(1.0-muG*muG), 0.0);
+                length = -m_radius*muG+sqrt(m_radius*m_radius*(muG*muG-1.0)+top*top);
+                start = Eigen::Vector3d(m_radius, 0.0, 0.0)+length*up;
+                direction = -up;
+            } else {
+                double p = m_radius+(u-0.5)*2.0*m_parameters.height;
+                double half = sqrt(qMax(0.0, top*top-p*p));
+                start = Eigen::Vector3d(p, -half, 0.0);
+                direction = Eigen::Vector3d(0.0, 1.0, 0.0);
+                length = 2.0*half;
+            }
+            Eigen::Vector3d rayleigh = Eigen::Vector3d::Zero();
+            double mie = 0.0;
+            Eigen::Vector3d depth = Eigen::Vector3d::Zero();
+            double dt = length/InscatterSteps;
+            for (int k = 0; k < InscatterSteps; ++k) {
+                Eigen::Vector3d x = start+(k+0.5)*dt*direction;
+                double r = x.norm();
+                double rhoR = exp(-(r-m_radius)/m_parameters.rayleighScaleHeight);
+                double rhoM = exp(-(r-m_radius)/m_parameters.mieScaleHeight);
+                depth += (m_parameters.rayleigh*rhoR+Eigen::Vector3d::Constant(m_parameters.mie/0.9*rhoM))*dt*0.5;
+                Eigen::Vector3d view(exp(-depth.x()), exp(-depth.y()), exp(-depth.z()));
+                Eigen::Vector3d light = view.cwiseProduct(this->transmittance(r, x.dot(sun)/r));
+                rayleigh += light.cwiseProduct(m_parameters.rayleigh)*rhoR*dt;
+                mie += light.mean()*m_parameters.mie*rhoM*dt;
+                depth += (m_parameters.rayleigh*rhoR+Eigen::Vector3d::Constant(m_parameters.mie/0.9*rhoM))*dt*0.5;
+            }
+            inscatter << rayleigh.x() << rayleigh.y() << rayleigh.z() << mie;
+        }
+    }
+
+    // Quantize to RGBA8, ES2 has no float textures
+    quantize(transmittance, TransmittanceWidth, TransmittanceHeight, tables.transmittance);
+    quantize(inscatter, InscatterWidth, InscatterHeight, tables.inscatter);
+    return tables;
+}
+
+void Scattering::quantize(const QVector<double> &values, int width, int height, Atmosphere::LookupTable &table) const
+{
+    double maximum = 1e-12;
+    foreach (double value, values)
+        maximum = qMax(maximum, value);
+    table.width = width;
+    table.height = height;
+    table.scale = maximum;
+    table.data.resize(values.size());
+    for (int i = 0; i < values.size(); ++i) {
+        table.data[i] = (uchar)qBound(0.0, values.at(i)/maximum*255.0+0.5, 255.0);
+    }
+}
+
+GLuint Atmosphere::createTexture(const LookupTable &table)
+{
+    GLuint textureId;
+    glGenTextures(1, &textureId);
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, table.width, table.height,
+                 0, GL_RGBA, GL_UNSIGNED_BYTE, table.data.constData());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    return textureId;
+}
@@ -0,0 +1,58 @@
+#ifndef ATMOSPHERE_H
+#define ATMOSPHERE_H
+
+#include "renderable.h"
+
+#include <QOpenGLBuffer>
+
+struct AtmosphereParameters {
+    double height; // 10e3m
+    Eigen::Vector3d rayleigh; // Scattering coefficients, (10e3m)^-1
+    double rayleighScaleHeight; // 10e3m
+    double mie; // Scattering coefficient, (10e3m)^-1
+    double mieScaleHeight; // 10e3m
+    double mieG; // Asymmetry factor
+};
+
+class Atmosphere : public Renderable
+{
+public:
+    struct LookupTable {
+        int width;
+        int height;
+        float scale; // Texel value = scale*byte/255
+        QByteArray data; // RGBA8
+    };
+    struct Tables {
+        LookupTable transmittance;
+        LookupTable inscatter;
+    };
+    // CPU only, can run on any thread. Reads or fills the disk cache.
+    static Tables createTables(float radius, const AtmosphereParameters &parameters);
+
+    Atmosphere(float radius, const AtmosphereParameters &parameters, QObject *parent = 0);
+    Atmosphere(float radius, const AtmosphereParameters &parameters, const Tables &tables, QObject *parent = 0);
+    ~Atmosphere();
+    void createVAO();
+    void render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+
+private:
+    static bool loadCache(const QString &fileName, Tables &tables);
+    static void saveCache(const QString &fileName, const Tables &tables);
+    static QByteArray cacheKey(float radius, const AtmosphereParameters &parameters);
+    void init(const Tables &tables);
+    GLuint createTexture(const LookupTable &table);
+
+    float m_radius;
+    AtmosphereParameters m_parameters;
+    GLuint m_transmittanceTexture;
+    GLuint m_inscatterTexture;
+
+    QVector<int> m_indices;
+    QVector<QVector3D> m_vertices;
+
+    QOpenGLBuffer m_indexBuffer;
+    QOpenGLBuffer m_vertexBuffer;
+};
+
+#endif // ATMOSPHERE_H
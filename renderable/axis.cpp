@@ -1,4 +1,5 @@
 #include "axis.h"
+#include "renderstate.h"
 
 Axis::Axis(float length, QObject *parent)
     : Renderable(parent)
@@ -23,9 +24,6 @@ Axis::Axis(float length, QObject *parent)
     m_vertices.append(length*QVector3D(0.0, 0.0, 1.0));
     m_colors.append(QVector3D(0.0, 0.0, 1.0));
 
-    m_program.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-    m_program.bindAttributeLocation("color", PROGRAM_COLOR_ATTRIBUTE);
-
     m_dataSize = m_vertices.size();
     // Axis vertex buffer init
     m_vertexBuffer.create();
@@ -73,18 +71,16 @@ void Axis::createVAO()
 
 void Axis::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
 {
-    m_program.bind();
+    RenderState *state = RenderState::instance();
+    state->useProgram(m_program);
 
     setUniformMatrix(m_program.uniformLocation("modelViewMatrix"), view*model);
     setUniformMatrix(m_program.uniformLocation("projectionMatrix"), projection);
     m_program.setUniformValue("logZbufferC", m_logZbufferC);
     m_program.setUniformValue("C", m_C);
 
+    state->apply(RenderState::State());
     m_vao.bind();
-    glDrawArrays(GL_LINES, 0, 2);
-    glDrawArrays(GL_LINES, 2, 2);
-    glDrawArrays(GL_LINES, 4, 2);
+    glDrawArrays(GL_LINES, 0, 6);
     m_vao.release();
-
-    m_program.release();
 }
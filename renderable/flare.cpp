@@ -1,4 +1,5 @@
 #include "flare.h"
+#include "renderstate.h"
 #include "path.h"
 
 Flare::Flare(QObject *parent)
@@ -29,9 +30,6 @@ Flare::Flare(QObject *parent)
     m_vertices.append(QVector3D(-1.0, -1.0, 0.0));
     m_texCoords.append(QVector2D(0.0, 0.0));
 
-    m_program.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-    m_program.bindAttributeLocation("texCoord", PROGRAM_TEXTURE_ATTRIBUTE);
-
     m_dataSize = m_vertices.size();
     // Ring vertex buffer init
     m_vertexBuffer.create();
@@ -86,8 +84,9 @@ void Flare::createVAO()
 
 void Flare::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
 {
-    glBindTexture(GL_TEXTURE_2D, m_texture->textureId());
-    m_program.bind();
+    RenderState *state = RenderState::instance();
+    state->bindTexture(0, m_texture->textureId());
+    state->useProgram(m_program);
     setUniformMatrix(m_program.uniformLocation("modelViewMatrix"), view*model);
     setUniformMatrix(m_program.uniformLocation("projectionMatrix"), projection);
     m_program.setUniformValue("logZbufferC", m_logZbufferC);
@@ -96,13 +95,12 @@ void Flare::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, co
     m_program.setUniformValue("size", QSizeF(m_texture->width()/1280.0,
                                              m_texture->height()/800.0));
 
-    glBlendFunc (GL_ONE, GL_ONE);
+    RenderState::State drawState;
+    drawState.blend = true;
+    drawState.blendSource = GL_ONE;
+    drawState.blendDestination = GL_ONE;
+    state->apply(drawState);
     m_vao.bind();
-    glEnable(GL_BLEND);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, m_dataSize);
-    glDisable(GL_BLEND);
     m_vao.release();
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    m_program.release();
 }
@@ -1,66 +1,133 @@
 #include "galaxy.h"
+#include "renderstate.h"
 #include "path.h"
 
 #include <QFile>
 #include <QTextStream>
+#include <cmath>
+
+#ifndef GL_TEXTURE_CUBE_MAP
+#define GL_TEXTURE_CUBE_MAP 0x8513
+#define GL_TEXTURE_CUBE_MAP_POSITIVE_X 0x8515
+#define GL_MAX_CUBE_MAP_TEXTURE_SIZE 0x851C
+#endif
+
+// The baked sky is magnified at most this much before drawing the stars again
+static const float MaxMagnification = 2.0;
+// Relative change of the texel to pixel ratio triggering a new bake
+static const float RebakeRatio = 1.25;
 
 Galaxy::Galaxy(QObject *parent)
     : Renderable(parent)
     , m_pointSizeCoeff(1.0)
+    , m_viewportWidth(0)
+    , m_viewportHeight(0)
     , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
     , m_colorBuffer(QOpenGLBuffer::VertexBuffer)
+    , m_quadBuffer(QOpenGLBuffer::VertexBuffer)
+    , m_cubeMap(0)
+    , m_cubeMapFbo(0)
+    , m_faceSize(0)
+    , m_maxFaceSize(0)
+    , m_bakedPixelFaceSize(0.0)
+    , m_cubeMapValid(false)
 {
-    setShaders(m_program, "galaxy");
-    checkProgram(m_program);
+    init(loadStars());
+}
+
+Galaxy::Galaxy(const Stars &stars, QObject *parent)
+    : Renderable(parent)
+    , m_pointSizeCoeff(1.0)
+    , m_viewportWidth(0)
+    , m_viewportHeight(0)
+    , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
+    , m_colorBuffer(QOpenGLBuffer::VertexBuffer)
+    , m_quadBuffer(QOpenGLBuffer::VertexBuffer)
+    , m_cubeMap(0)
+    , m_cubeMapFbo(0)
+    , m_faceSize(0)
+    , m_maxFaceSize(0)
+    , m_bakedPixelFaceSize(0.0)
+    , m_cubeMapValid(false)
+{
+    init(stars);
+}
 
+Galaxy::Stars Galaxy::loadStars()
+{
+    Stars stars;
     QFile file(resPath()+"data/hygxyz.csv");
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
         qWarning()<<"Error loading file "<<file.fileName();
-    } else {
-        QTextStream data(&file);
-        //discard header
-        data.readLine();
-        //discard Sol
-        data.readLine();
-        while (!data.atEnd()) {
-            QString line = data.readLine();
-            QStringList properties = line.split(",");
-            float magnitude = properties.at(13).toFloat();
-            // Discard stars invisible to the naked eye
-            if (magnitude > 7.0)
-                continue;
-            QVector3D position = QVector3D(properties.at(17).toFloat(),
-                                           properties.at(18).toFloat(),
-                                           properties.at(19).toFloat());
-            double parsecToKm = 3.08567758e13;
-            m_vertices.append(position*parsecToKm);
-
-            QVector3D color;
-//            QString spectrum = properties.at(15);
-//            color = spectrumToRgb(spectrum);
-            float colorIndex = properties.at(16).toFloat();
-            color = colorIndexToRgb(colorIndex);
-            color /= 255.0;
-            m_colors.append(QVector4D(color.x(), color.y(), color.z(), magnitude));
-        }
+        return stars;
     }
+    QTextStream data(&file);
+    //discard header
+    data.readLine();
+    //discard Sol
+    data.readLine();
+    while (!data.atEnd()) {
+        QString line = data.readLine();
+        QStringList properties = line.split(",");
+        float magnitude = properties.at(13).toFloat();
+        // Discard stars invisible to the naked eye
+        if (magnitude > 7.0)
+            continue;
+        QVector3D position = QVector3D(properties.at(17).toFloat(),
+                                       properties.at(18).toFloat(),
+                                       properties.at(19).toFloat());
+        double parsecToKm = 3.08567758e13;
+        stars.vertices.append(position*parsecToKm);
+
+        QVector3D color;
+//        QString spectrum = properties.at(15);
+//        color = spectrumToRgb(spectrum);
+        float colorIndex = properties.at(16).toFloat();
+        color = colorIndexToRgb(colorIndex);
+        color /= 255.0;
+        stars.colors.append(QVector4D(color.x(), color.y(), color.z(), magnitude));
+    }
+    return stars;
+}
 
-    m_program.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-    m_program.bindAttributeLocation("color", PROGRAM_COLOR_ATTRIBUTE);
+void Galaxy::init(const Stars &stars)
+{
+    setShaders(m_program, "galaxy");
+    checkProgram(m_program);
+    setShaders(m_programCubeFace, "galaxy.vert", "galaxy.frag", "#define CUBE_FACE\n");
+    checkProgram(m_programCubeFace);
+    setShaders(m_programSkyBox, "skybox");
+    checkProgram(m_programSkyBox);
+    m_programSkyBox.bind();
+    m_programSkyBox.setUniformValue("texture0", 0);
+    m_programSkyBox.release();
 
-    m_dataSize = m_vertices.size();
+    // Limit the memory taken by the six faces
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_CUBE_MAP_TEXTURE_SIZE, &maxSize);
+#ifndef Q_OS_ANDROID
+    m_maxFaceSize = qMin(maxSize, 2048);
+#else
+    m_maxFaceSize = qMin(maxSize, 1024);
+#endif
+
+    const GLfloat quad[] = {-1.0, -1.0,  1.0, -1.0,  -1.0, 1.0,  1.0, 1.0};
+    m_quadBuffer.create();
+    m_quadBuffer.bind();
+    m_quadBuffer.allocate(quad, sizeof(quad));
+    m_quadBuffer.release();
+
+    m_dataSize = stars.vertices.size();
     // Galaxy vertex buffer init
     m_vertexBuffer.create();
     m_vertexBuffer.bind();
-    m_vertexBuffer.allocate(m_vertices.constData(), m_vertices.size() * sizeof(QVector3D));
+    m_vertexBuffer.allocate(stars.vertices.constData(), stars.vertices.size() * sizeof(QVector3D));
     m_vertexBuffer.release();
-    m_vertices.clear();
     // Galaxy color buffer init
     m_colorBuffer.create();
     m_colorBuffer.bind();
-    m_colorBuffer.allocate(m_colors.constData(), m_colors.size() * sizeof(QVector4D));
+    m_colorBuffer.allocate(stars.colors.constData(), stars.colors.size() * sizeof(QVector4D));
     m_colorBuffer.release();
-    m_colors.clear();
 
     createVAO();
 }
@@ -69,6 +136,11 @@ Galaxy::~Galaxy()
 {
     m_vertexBuffer.destroy();
     m_colorBuffer.destroy();
+    m_quadBuffer.destroy();
+    if (m_cubeMap) {
+        glDeleteTextures(1, &m_cubeMap);
+        glDeleteFramebuffers(1, &m_cubeMapFbo);
+    }
 }
 
 void Galaxy::createVAO()
@@ -93,21 +165,129 @@ void Galaxy::createVAO()
     m_program.disableAttributeArray(PROGRAM_COLOR_ATTRIBUTE);
 }
 
+void Galaxy::setViewport(int width, int height)
+{
+    if ((width != m_viewportWidth) || (height != m_viewportHeight))
+        m_cubeMapValid = false;
+    m_viewportWidth = width;
+    m_viewportHeight = height;
+}
+
 void Galaxy::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
 {
-    m_program.bind();
+    // Face size giving one texel per pixel in the middle of the screen
+    float pixelFaceSize = m_viewportHeight*projection.matrix()(1,1);
+    if ( (m_maxFaceSize == 0) || (m_viewportHeight == 0) || (pixelFaceSize > MaxMagnification*m_maxFaceSize) ) {
+        // Zoomed in too much for the cube map, or no viewport yet
+        renderStars(m_program, view*model, projection.matrix(), m_pointSizeCoeff);
+        return;
+    }
+
+    float ratio = pixelFaceSize/m_bakedPixelFaceSize;
+    if ( !m_cubeMapValid || (ratio > RebakeRatio) || (ratio < 1.0/RebakeRatio) ) {
+        // Sizes rounded up to limit reallocations
+        int faceSize = qMin(((int)pixelFaceSize+63) & ~63, m_maxFaceSize);
+        // Stars keep their on-screen size when the cube map is magnified
+        bakeCubeMap(faceSize, m_pointSizeCoeff*faceSize/pixelFaceSize);
+        m_bakedPixelFaceSize = pixelFaceSize;
+        m_cubeMapValid = true;
+    }
+
+    // Direction of the corners of the screen in the frame of the stars
+    Eigen::Matrix4d rotation = Eigen::Matrix4d::Identity();
+    rotation.block<3,3>(0,0) = (view*model).linear();
+    Eigen::Matrix4d inverseViewProjection = (projection.matrix()*rotation).inverse();
+
+    RenderState *state = RenderState::instance();
+    state->useProgram(m_programSkyBox);
+    setUniformMatrix(m_programSkyBox.uniformLocation("inverseViewProjection"), inverseViewProjection);
+    // Drawn first over the cleared background, no blending needed
+    state->apply(RenderState::State());
+    glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubeMap);
+
+    m_quadBuffer.bind();
+    m_programSkyBox.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_programSkyBox.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 2);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_programSkyBox.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_quadBuffer.release();
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+void Galaxy::renderStars(QOpenGLShaderProgram &program, const Eigen::Affine3d &modelView, const Eigen::Matrix4d &projection,
+                         float pointSizeCoeff)
+{
+    RenderState *state = RenderState::instance();
+    state->useProgram(program);
 
-    setUniformMatrix(m_program.uniformLocation("modelViewMatrix"), view*model);
-    setUniformMatrix(m_program.uniformLocation("projectionMatrix"), projection);
-    m_program.setUniformValue("pointSizeCoeff", m_pointSizeCoeff);
+    setUniformMatrix(program.uniformLocation("modelViewMatrix"), modelView);
+    setUniformMatrix(program.uniformLocation("projectionMatrix"), projection);
+    program.setUniformValue("pointSizeCoeff", pointSizeCoeff);
 
+    RenderState::State drawState;
+    drawState.blend = true;
+    state->apply(drawState);
     m_vao.bind();
-    glEnable(GL_BLEND);
     glDrawArrays(GL_POINTS, 0, m_dataSize);
-    glDisable(GL_BLEND);
     m_vao.release();
+}
+
+void Galaxy::bakeCubeMap(int faceSize, float pointSizeCoeff)
+{
+    if (!m_cubeMap) {
+        glGenTextures(1, &m_cubeMap);
+        glGenFramebuffers(1, &m_cubeMapFbo);
+    }
+    if (faceSize != m_faceSize) {
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubeMap);
+        for (int face = 0; face < 6; ++face) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X+face, 0, GL_RGBA, faceSize, faceSize, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        m_faceSize = faceSize;
+    }
+
+    // Rendering into the faces happens in the middle of the scene
+    GLint previousFbo;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFbo);
+
+    // 90 degrees field of view, far plane at infinity
+    Eigen::Matrix4d projection;
+    projection << 1.0, 0.0,  0.0,  0.0,
+                  0.0, 1.0,  0.0,  0.0,
+                  0.0, 0.0, -1.0, -2.0,
+                  0.0, 0.0, -1.0,  0.0;
+    // Viewing direction and up vector of each face, in the GL order +X, -X, +Y, -Y, +Z, -Z
+    static const double faces[6][6] = {{ 1.0,  0.0,  0.0,   0.0, -1.0,  0.0},
+                                       {-1.0,  0.0,  0.0,   0.0, -1.0,  0.0},
+                                       { 0.0,  1.0,  0.0,   0.0,  0.0,  1.0},
+                                       { 0.0, -1.0,  0.0,   0.0,  0.0, -1.0},
+                                       { 0.0,  0.0,  1.0,   0.0, -1.0,  0.0},
+                                       { 0.0,  0.0, -1.0,   0.0, -1.0,  0.0}};
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_cubeMapFbo);
+    glViewport(0, 0, faceSize, faceSize);
+    for (int face = 0; face < 6; ++face) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X+face, m_cubeMap, 0);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        Eigen::Vector3d forward(faces[face][0], faces[face][1], faces[face][2]);
+        Eigen::Vector3d up(faces[face][3], faces[face][4], faces[face][5]);
+        Eigen::Vector3d side = forward.cross(up);
+        Eigen::Affine3d modelView = Eigen::Affine3d::Identity();
+        modelView.linear().row(0) = side;
+        modelView.linear().row(1) = side.cross(forward);
+        modelView.linear().row(2) = -forward;
+        renderStars(m_programCubeFace, modelView, projection, pointSizeCoeff);
+    }
 
-    m_program.release();
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFbo);
+    glViewport(0, 0, m_viewportWidth, m_viewportHeight);
 }
 
 QVector3D Galaxy::spectrumToRgb(const QString &spectrum)
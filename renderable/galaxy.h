@@ -8,23 +8,50 @@
 class Galaxy : public Renderable
 {
 public:
+    struct Stars {
+        QVector<QVector3D> vertices;
+        QVector<QVector4D> colors;
+    };
+    // CPU only, can run on any thread
+    static Stars loadStars();
+
     Galaxy(QObject *parent = 0);
+    Galaxy(const Stars &stars, QObject *parent = 0);
     ~Galaxy();
     void createVAO();
     void render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
-    void setPointSizeCoeff(float coeff) {m_pointSizeCoeff = coeff;}
+    void setPointSizeCoeff(float coeff) {m_pointSizeCoeff = coeff; m_cubeMapValid = false;}
+    // Of the render target, at (0, 0). A new size bakes the cube map again.
+    void setViewport(int width, int height);
 
 private:
-    QVector3D spectrumToRgb(const QString &spectrum);
-    QVector3D colorIndexToRgb(qreal colorIndex);
+    static QVector3D spectrumToRgb(const QString &spectrum);
+    static QVector3D colorIndexToRgb(qreal colorIndex);
+    void init(const Stars &stars);
+    void renderStars(QOpenGLShaderProgram &program, const Eigen::Affine3d &modelView, const Eigen::Matrix4d &projection,
+                     float pointSizeCoeff);
+    // Renders the stars into the six faces of the cube map
+    void bakeCubeMap(int faceSize, float pointSizeCoeff);
 
     float m_pointSizeCoeff;
-
-    QVector<QVector3D> m_vertices;
-    QVector<QVector4D> m_colors;
+    int m_viewportWidth;
+    int m_viewportHeight;
 
     QOpenGLBuffer m_vertexBuffer;
     QOpenGLBuffer m_colorBuffer;
+
+    // The stars are at infinity, as long as the size of the cube map texels
+    // stays close to the screen pixels they are drawn once then sampled.
+    QOpenGLShaderProgram m_programCubeFace;
+    QOpenGLShaderProgram m_programSkyBox;
+    QOpenGLBuffer m_quadBuffer;
+    GLuint m_cubeMap;
+    GLuint m_cubeMapFbo;
+    int m_faceSize;
+    int m_maxFaceSize;
+    // Face size matching one texel per screen pixel when the cube map was baked
+    float m_bakedPixelFaceSize;
+    bool m_cubeMapValid;
 };
 
 #endif // GALAXY_H
@@ -0,0 +1,177 @@
+#include "glyphatlas.h"
+
+#include <cmath>
+#include <QFontMetricsF>
+#include <QPainter>
+#include <QVector>
+
+static const double Infinity = 1e20;
+
+// 1D squared Euclidean distance transform, Felzenszwalb & Huttenlocher
+static void distanceTransform(const double *f, double *d, int n, int *v, double *z)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -Infinity;
+    z[1] = Infinity;
+    for (int q = 1; q < n; ++q) {
+        double s = ((f[q]+q*q)-(f[v[k]]+v[k]*v[k]))/(2*q-2*v[k]);
+        while (s <= z[k]) {
+            --k;
+            s = ((f[q]+q*q)-(f[v[k]]+v[k]*v[k]))/(2*q-2*v[k]);
+        }
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k+1] = Infinity;
+    }
+    k = 0;
+    for (int q = 0; q < n; ++q) {
+        while (z[k+1] < q)
+            ++k;
+        d[q] = (q-v[k])*(q-v[k])+f[v[k]];
+    }
+}
+
+// Squared distance of every pixel to the nearest pixel where grid is 0, in place
+static void distanceTransform(QVector<double> &grid, int width, int height)
+{
+    int n = qMax(width, height);
+    QVector<double> f(n), d(n), z(n+1);
+    QVector<int> v(n);
+    for (int x = 0; x < width; ++x) {
+        for (int y = 0; y < height; ++y)
+            f[y] = grid[y*width+x];
+        distanceTransform(f.constData(), d.data(), height, v.data(), z.data());
+        for (int y = 0; y < height; ++y)
+            grid[y*width+x] = d[y];
+    }
+    for (int y = 0; y < height; ++y) {
+        distanceTransform(grid.constData()+y*width, d.data(), width, v.data(), z.data());
+        for (int x = 0; x < width; ++x)
+            grid[y*width+x] = d[x];
+    }
+}
+
+GlyphAtlas::GlyphAtlas(const QFont &font, int pixelSize, int spread)
+    : m_pixelSize(pixelSize)
+    , m_spread(spread)
+{
+    QFont large(font);
+    large.setPixelSize(pixelSize*Supersampling);
+    QFontMetricsF metrics(large);
+    m_ascent = metrics.ascent()/Supersampling;
+    m_descent = metrics.descent()/Supersampling;
+
+    // Rasterize and transform every glyph, then pack them in rows
+    struct Entry {
+        QChar c;
+        QImage field;
+        QRectF rect;
+        qreal advance;
+    };
+    QVector<Entry> entries;
+    const int margin = spread*Supersampling;
+    for (ushort code = 32; code < 127; ++code) {
+        Entry entry;
+        entry.c = QChar(code);
+        entry.advance = metrics.width(entry.c)/Supersampling;
+        QRect bounds = metrics.boundingRect(entry.c).toAlignedRect();
+        if (bounds.isEmpty()) {
+            entry.rect = QRectF();
+            entries.append(entry);
+            continue;
+        }
+        QImage glyph(bounds.width()+2*margin, bounds.height()+2*margin, QImage::Format_ARGB32_Premultiplied);
+        glyph.fill(Qt::transparent);
+        QPainter painter(&glyph);
+        painter.setRenderHint(QPainter::TextAntialiasing);
+        painter.setFont(large);
+        painter.setPen(Qt::white);
+        painter.drawText(QPointF(margin-bounds.left(), margin-bounds.top()), QString(entry.c));
+        painter.end();
+        entry.field = distanceField(glyph);
+        entry.rect = QRectF((bounds.left()-margin)/(qreal)Supersampling,
+                            -(bounds.bottom()+1+margin)/(qreal)Supersampling,
+                            entry.field.width(), entry.field.height());
+        entries.append(entry);
+    }
+
+    const int width = 512;
+    int x = 0, y = 0, rowHeight = 0;
+    QVector<QPoint> positions;
+    foreach (const Entry &entry, entries) {
+        if (x+entry.field.width() > width) {
+            x = 0;
+            y += rowHeight+1;
+            rowHeight = 0;
+        }
+        positions.append(QPoint(x, y));
+        x += entry.field.width()+1;
+        rowHeight = qMax(rowHeight, entry.field.height());
+    }
+    int height = 1;
+    while (height < y+rowHeight)
+        height *= 2;
+
+    // White everywhere, the distance is in the alpha channel
+    m_image = QImage(width, height, QImage::Format_ARGB32);
+    m_image.fill(QColor(255, 255, 255, 0));
+    QPainter painter(&m_image);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    for (int i = 0; i < entries.size(); ++i) {
+        const Entry &entry = entries.at(i);
+        Glyph glyph;
+        glyph.rect = entry.rect;
+        glyph.advance = entry.advance;
+        if (!entry.field.isNull()) {
+            painter.drawImage(positions.at(i), entry.field);
+            // The image is uploaded mirrored, v goes up
+            glyph.uv = QRectF((qreal)positions.at(i).x()/width,
+                              1.0-(qreal)(positions.at(i).y()+entry.field.height())/height,
+                              (qreal)entry.field.width()/width,
+                              (qreal)entry.field.height()/height);
+        }
+        m_glyphs.insert(entry.c, glyph);
+    }
+    painter.end();
+}
+
+const GlyphAtlas::Glyph *GlyphAtlas::glyph(QChar c) const
+{
+    QHash<QChar, Glyph>::const_iterator it = m_glyphs.constFind(c);
+    if (it == m_glyphs.constEnd())
+        return 0;
+    return &it.value();
+}
+
+QImage GlyphAtlas::distanceField(const QImage &glyph) const
+{
+    const int width = glyph.width();
+    const int height = glyph.height();
+    QVector<double> outside(width*height), inside(width*height);
+    for (int y = 0; y < height; ++y) {
+        const QRgb *line = (const QRgb*)glyph.constScanLine(y);
+        for (int x = 0; x < width; ++x) {
+            bool in = qAlpha(line[x]) > 127;
+            outside[y*width+x] = in ? 0.0 : Infinity;
+            inside[y*width+x] = in ? Infinity : 0.0;
+        }
+    }
+    distanceTransform(outside, width, height);
+    distanceTransform(inside, width, height);
+
+    // Sample at the center of each atlas texel
+    QImage field(width/Supersampling, height/Supersampling, QImage::Format_ARGB32);
+    const double range = 2.0*m_spread*Supersampling;
+    for (int y = 0; y < field.height(); ++y) {
+        QRgb *line = (QRgb*)field.scanLine(y);
+        for (int x = 0; x < field.width(); ++x) {
+            int i = (y*Supersampling+Supersampling/2)*width+x*Supersampling+Supersampling/2;
+            double distance = sqrt(outside[i])-sqrt(inside[i]);
+            int alpha = qBound(0, (int)((0.5-distance/range)*255.0+0.5), 255);
+            line[x] = qRgba(255, 255, 255, alpha);
+        }
+    }
+    return field;
+}
@@ -0,0 +1,43 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QRectF>
+
+// Signed distance field of the printable ASCII glyphs of a font, packed in one image.
+// The distance is stored in the alpha channel, 0.5 on the outline, growing inside.
+// CPU only, the owner uploads the image.
+class GlyphAtlas
+{
+public:
+    struct Glyph {
+        QRectF rect; // Pixels at pixelSize(), relative to the pen on the baseline, y up
+        QRectF uv;
+        qreal advance;
+    };
+
+    GlyphAtlas(const QFont &font, int pixelSize = 32, int spread = 4);
+    const QImage &image() const {return m_image;}
+    int pixelSize() const {return m_pixelSize;}
+    int spread() const {return m_spread;} // Pixels covered by the distance ramp on each side
+    qreal ascent() const {return m_ascent;}
+    qreal descent() const {return m_descent;}
+    const Glyph *glyph(QChar c) const;
+
+private:
+    // Glyphs are rasterized this many times larger than the atlas before computing the distance
+    static const int Supersampling = 4;
+
+    QImage distanceField(const QImage &glyph) const;
+
+    int m_pixelSize;
+    int m_spread;
+    qreal m_ascent;
+    qreal m_descent;
+    QImage m_image;
+    QHash<QChar, Glyph> m_glyphs;
+};
+
+#endif // GLYPHATLAS_H
@@ -0,0 +1,228 @@
+#include "keplerbatch.h"
+#include "pointbatch.h"
+#include "renderstate.h"
+
+#include <cmath>
+#include <cstddef>
+#include <QDebug>
+
+KeplerBatch::KeplerBatch(QObject *parent)
+    : Renderable(parent)
+    , m_time(0.0)
+    , m_verticesChanged(false)
+    , m_trailsChanged(false)
+    , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
+    , m_trailBuffer(QOpenGLBuffer::VertexBuffer)
+{
+    setShaders(m_program, "kepler.vert", "coloredPoint.frag");
+    checkProgram(m_program);
+    // The fading color of the axis is all a trail needs
+    setShaders(m_trailProgram, "kepler.vert", "axis.frag", "#define TRAIL\n");
+    checkProgram(m_trailProgram);
+
+    m_trailProgram.bind();
+    m_trailProgram.setUniformValue("trailLength", (GLfloat)(1.0/TrailFraction));
+    m_trailProgram.release();
+
+    m_vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_vertexBuffer.create();
+    m_trailBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_trailBuffer.create();
+
+    createVAO();
+}
+
+KeplerBatch::~KeplerBatch()
+{
+    m_vertexBuffer.destroy();
+    m_trailBuffer.destroy();
+}
+
+int KeplerBatch::addGroup()
+{
+    Group group;
+    group.first = m_vertices.size();
+    group.count = 0;
+    group.alpha = 0.0;
+    group.trails = false;
+    group.rotation.setIdentity();
+    group.translation.setZero();
+    m_groups.append(group);
+    return m_groups.size()-1;
+}
+
+void KeplerBatch::addBody(const OrbitalElements &elements, const QVector3D &color)
+{
+    if (m_groups.isEmpty() || (elements.revolutionPeriod == 0.0)) {
+        qWarning()<<"KeplerBatch: no group or no mean motion, the body is not drawn";
+        return;
+    }
+    // The plane coordinates of Orbit::position() along these axes
+    double e = elements.eccentricity;
+    double a = std::abs(elements.semiMajorAxis);
+    double b = 2.0*a;
+    if (e < 1.0)
+        b = a*std::sqrt(1.0-e*e);
+    else if (e > 1.0)
+        b = a*std::sqrt(e*e-1.0);
+    const Eigen::Matrix3d plane = Orbit::orientation(elements).linear();
+    const Eigen::Vector3d majorAxis = plane.col(0)*a;
+    const Eigen::Vector3d minorAxis = plane.col(1)*b;
+
+    // In revolutions, from J2000 so that the shader only needs the time.
+    // Only the fraction of a revolution matters for the closed orbits.
+    double meanMotion = 1.0/elements.revolutionPeriod;
+    double meanAnomaly = elements.meanAnomalyAtEpoch/(2.0*M_PI)-meanMotion*elements.epoch;
+    if (!Orbit::isOpen(elements))
+        meanAnomaly -= floor(meanAnomaly);
+    QVector2D motion = Orbit::doubleToTwoFloats(meanMotion);
+
+    Vertex vertex;
+    vertex.elements[0] = e;
+    vertex.elements[1] = meanAnomaly;
+    vertex.elements[2] = motion.x();
+    vertex.elements[3] = motion.y();
+    for (int i = 0; i < 3; ++i) {
+        vertex.majorAxis[i] = majorAxis[i];
+        vertex.minorAxis[i] = minorAxis[i];
+    }
+    vertex.color[0] = color.x();
+    vertex.color[1] = color.y();
+    vertex.color[2] = color.z();
+    vertex.color[3] = 0.0;
+    m_vertices.append(vertex);
+    m_groups.last().count++;
+    m_verticesChanged = true;
+    m_trailsChanged = true;
+}
+
+void KeplerBatch::add(int group, const Eigen::Affine3d &frame, bool trails, float alpha)
+{
+    Group &g = m_groups[group];
+    g.alpha = alpha;
+    g.trails = trails;
+    g.rotation = frame.linear();
+    g.translation = frame.translation();
+}
+
+void KeplerBatch::setAttributes(QOpenGLBuffer &buffer)
+{
+    // Both programs share the attribute locations
+    m_program.enableAttributeArray(PROGRAM_KEPLER_ELEMENTS_ATTRIBUTE);
+    m_program.enableAttributeArray(PROGRAM_MAJOR_AXIS_ATTRIBUTE);
+    m_program.enableAttributeArray(PROGRAM_MINOR_AXIS_ATTRIBUTE);
+    m_program.enableAttributeArray(PROGRAM_COLOR_ATTRIBUTE);
+
+    buffer.bind();
+    m_program.setAttributeBuffer(PROGRAM_KEPLER_ELEMENTS_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, elements), 4, sizeof(Vertex));
+    m_program.setAttributeBuffer(PROGRAM_MAJOR_AXIS_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, majorAxis), 3, sizeof(Vertex));
+    m_program.setAttributeBuffer(PROGRAM_MINOR_AXIS_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, minorAxis), 3, sizeof(Vertex));
+    m_program.setAttributeBuffer(PROGRAM_COLOR_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, color), 4, sizeof(Vertex));
+    buffer.release();
+}
+
+void KeplerBatch::createVAO()
+{
+    m_vao.create();
+    m_vao.bind();
+    setAttributes(m_vertexBuffer);
+    m_vao.release();
+
+    m_trailVao.create();
+    m_trailVao.bind();
+    setAttributes(m_trailBuffer);
+    m_trailVao.release();
+
+    m_program.disableAttributeArray(PROGRAM_KEPLER_ELEMENTS_ATTRIBUTE);
+    m_program.disableAttributeArray(PROGRAM_MAJOR_AXIS_ATTRIBUTE);
+    m_program.disableAttributeArray(PROGRAM_MINOR_AXIS_ATTRIBUTE);
+    m_program.disableAttributeArray(PROGRAM_COLOR_ATTRIBUTE);
+}
+
+void KeplerBatch::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+{
+    Q_UNUSED(model)
+    bool points = false;
+    bool trails = false;
+    foreach (const Group &group, m_groups) {
+        if ((group.alpha > 0.0) && (group.count > 0)) {
+            points = true;
+            trails = trails || group.trails;
+        }
+    }
+    if (!points)
+        return;
+
+    if (m_verticesChanged) {
+        m_vertexBuffer.bind();
+        m_vertexBuffer.allocate(m_vertices.constData(), m_vertices.size() * sizeof(Vertex));
+        m_vertexBuffer.release();
+        m_verticesChanged = false;
+    }
+    if (trails && m_trailsChanged) {
+        // Line segments back from the body, the shader moves each end by its own delay
+        QVector<Vertex> vertices;
+        vertices.reserve(m_vertices.size()*2*TrailSegments);
+        foreach (Vertex vertex, m_vertices) {
+            for (int i = 0; i < TrailSegments; ++i) {
+                for (int j = i; j <= i+1; ++j) {
+                    vertex.color[3] = j/(GLfloat)TrailSegments;
+                    vertices.append(vertex);
+                }
+            }
+        }
+        m_trailBuffer.bind();
+        m_trailBuffer.allocate(vertices.constData(), vertices.size() * sizeof(Vertex));
+        m_trailBuffer.release();
+        m_trailsChanged = false;
+    }
+
+    RenderState *state = RenderState::instance();
+    RenderState::State drawState;
+    drawState.blend = true;
+    state->apply(drawState);
+    if (trails)
+        draw(m_trailProgram, true, view, projection);
+    draw(m_program, false, view, projection);
+    for (int i = 0; i < m_groups.size(); ++i) {
+        m_groups[i].alpha = 0.0;
+    }
+}
+
+void KeplerBatch::draw(QOpenGLShaderProgram &program, bool trails, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+{
+    RenderState *state = RenderState::instance();
+    state->useProgram(program);
+    setUniformMatrix(program.uniformLocation("projectionMatrix"), projection);
+    program.setUniformValue("time", Orbit::doubleToTwoFloats(m_time));
+    program.setUniformValue("pointSize", PointBatch::pointSize());
+    program.setUniformValue("logZbufferC", m_logZbufferC);
+    program.setUniformValue("C", m_C);
+    const int rotationLocation = program.uniformLocation("rotation");
+
+    QOpenGLVertexArrayObject &vao = trails ? m_trailVao : m_vao;
+    vao.bind();
+    foreach (const Group &group, m_groups) {
+        if ((group.alpha <= 0.0) || (group.count == 0) || (trails && !group.trails))
+            continue;
+        Eigen::Affine3d frame;
+        frame.linear() = group.rotation;
+        frame.translation() = group.translation;
+        // To prevent jitter, the camera is subtracted in emulated double precision, like OrbitBatch
+        const Eigen::Affine3d modelView = view*frame;
+        const Eigen::Matrix3d rotation = modelView.linear();
+        setUniformMatrix(rotationLocation, rotation);
+        Eigen::Vector3d cameraPosition = modelView.inverse().translation();
+        QVector2D doubleX = Orbit::doubleToTwoFloats(cameraPosition.x());
+        QVector2D doubleY = Orbit::doubleToTwoFloats(cameraPosition.y());
+        QVector2D doubleZ = Orbit::doubleToTwoFloats(cameraPosition.z());
+        program.setUniformValue("cameraHigh", QVector3D(doubleX.x(), doubleY.x(), doubleZ.x()));
+        program.setUniformValue("cameraLow", QVector3D(doubleX.y(), doubleY.y(), doubleZ.y()));
+        program.setUniformValue("alpha", group.alpha);
+        if (trails)
+            glDrawArrays(GL_LINES, group.first*2*TrailSegments, group.count*2*TrailSegments);
+        else
+            glDrawArrays(GL_POINTS, group.first, group.count);
+    }
+    vao.release();
+}
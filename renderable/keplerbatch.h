@@ -0,0 +1,69 @@
+#ifndef KEPLERBATCH_H
+#define KEPLERBATCH_H
+
+#include "renderable.h"
+#include "orbit.h"
+
+#include <QOpenGLBuffer>
+
+// The small bodies, as points moved by the vertex shader: their elements are
+// uploaded once in a static vertex buffer and Kepler's equation is solved for
+// the time uniform, so a frame costs the same for any number of bodies. The
+// bodies of a group share the frame of their parent. Groups are queued with
+// add() during a pass and drawn by render(), which empties the queue.
+// The secular rates are ignored, the points are neither picked nor labelled.
+class KeplerBatch : public Renderable
+{
+public:
+    // A trail has TrailSegments lines over 1/TrailFraction of a revolution
+    // of mean anomaly, the time the body took to get there
+    static const int TrailSegments = 8;
+    static const int TrailFraction = 16;
+
+    KeplerBatch(QObject *parent = 0);
+    ~KeplerBatch();
+    // Returns the group id, the bodies added next are in that group
+    int addGroup();
+    void addBody(const OrbitalElements &elements, const QVector3D &color);
+    void setTime(double time/*seconds past J2000*/) {m_time = time;}
+    // frame is that of the parent, the one of the elements
+    void add(int group, const Eigen::Affine3d &frame, bool trails, float alpha = 1.0);
+
+    void createVAO();
+    // model is ignored, frames are in world coordinates
+    void render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+
+private:
+    struct Vertex {
+        GLfloat elements[4]; // Eccentricity, mean anomaly at J2000, mean motion high and low, in revolutions
+        GLfloat majorAxis[3]; // In the frame of the parent
+        GLfloat minorAxis[3];
+        GLfloat color[4]; // w: along the trail, 0 at the body
+    };
+    struct Group {
+        int first;
+        int count;
+        float alpha; // 0 when not queued
+        bool trails;
+        Eigen::Matrix3d rotation;
+        Eigen::Vector3d translation;
+    };
+
+    void setAttributes(QOpenGLBuffer &buffer);
+    // One draw per queued group, trails or points
+    void draw(QOpenGLShaderProgram &program, bool trails, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+
+    double m_time;
+    QVector<Group> m_groups;
+    QVector<Vertex> m_vertices; // One per body
+    bool m_verticesChanged;
+    bool m_trailsChanged;
+
+    QOpenGLShaderProgram m_trailProgram;
+    QOpenGLBuffer m_vertexBuffer;
+    // 2*TrailSegments vertices per body, only uploaded once trails are drawn
+    QOpenGLBuffer m_trailBuffer;
+    QOpenGLVertexArrayObject m_trailVao;
+};
+
+#endif // KEPLERBATCH_H
@@ -0,0 +1,314 @@
+#include "labelbatch.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <QGuiApplication>
+#include <QFontInfo>
+
+QSizeF LabelBatch::Resolution(1.0, 1.0);
+
+LabelBatch::LabelBatch(QObject *parent)
+    : Pickable(parent)
+    , m_atlas(0)
+    , m_texture(0)
+    , m_scale(1.0)
+    , m_selectedLabel(-1)
+    , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
+{
+    setShaders(m_program, "label");
+    checkProgram(m_program);
+
+    setShaders(m_programColor, "labelSolidColor");
+    checkProgram(m_programColor);
+
+    QFont font(QGuiApplication::font());
+    font.setPointSize(13);
+    m_atlas = new GlyphAtlas(font);
+    m_scale = (float)QFontInfo(font).pixelSize()/m_atlas->pixelSize();
+
+    m_texture = new QOpenGLTexture(m_atlas->image().mirrored(), QOpenGLTexture::DontGenerateMipMaps);
+    m_texture->setWrapMode(QOpenGLTexture::ClampToEdge);
+    m_texture->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
+
+    m_program.bind();
+    m_program.setUniformValue("texture0", 0);
+    // Half width of the antialiased edge, in distance units
+    m_program.setUniformValue("smoothing", (GLfloat)(0.5/(m_atlas->spread()*m_scale)));
+    m_program.release();
+
+    m_vertexBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    m_vertexBuffer.create();
+
+    createVAO();
+}
+
+LabelBatch::~LabelBatch()
+{
+    m_vertexBuffer.destroy();
+    delete m_texture;
+    delete m_atlas;
+}
+
+int LabelBatch::addLabel(const QString &text, const QVector3D &color, int pickId)
+{
+    Label label;
+    label.color = color;
+    label.pickColor = idColor(pickId);
+    label.firstQuad = m_quads.size();
+
+    // Same look as the former QFont::Capitalize
+    QString capitalized = text;
+    for (int i = 0; i < capitalized.size(); ++i) {
+        if ((i == 0) || capitalized.at(i-1).isSpace())
+            capitalized[i] = capitalized.at(i).toUpper();
+    }
+
+    // Labels sit above and to the right of the anchor
+    const float margin = 0.2*m_atlas->ascent()*m_scale;
+    qreal pen = margin;
+    const qreal baseline = margin+m_atlas->descent()*m_scale;
+    foreach (const QChar &c, capitalized) {
+        const GlyphAtlas::Glyph *glyph = m_atlas->glyph(c);
+        if (!glyph)
+            glyph = m_atlas->glyph('?');
+        if (!glyph->rect.isEmpty()) {
+            Quad quad;
+            quad.rect = QRectF(pen+glyph->rect.x()*m_scale, baseline+glyph->rect.y()*m_scale,
+                               glyph->rect.width()*m_scale, glyph->rect.height()*m_scale);
+            quad.uv = glyph->uv;
+            m_quads.append(quad);
+        }
+        pen += glyph->advance*m_scale;
+    }
+    label.nQuads = m_quads.size()-label.firstQuad;
+    label.bounds = QRectF(margin, margin, pen-margin, (m_atlas->ascent()+m_atlas->descent())*m_scale);
+    m_labels.append(label);
+    return m_labels.size()-1;
+}
+
+void LabelBatch::add(int label, const Eigen::Vector3d &position, float alpha, float priority)
+{
+    Instance instance;
+    instance.label = label;
+    instance.position = position;
+    instance.alpha = alpha;
+    instance.priority = (label == m_selectedLabel) ? std::numeric_limits<float>::max() : priority;
+    m_instances.append(instance);
+}
+
+void LabelBatch::createVAO()
+{
+    m_vao.create();
+    m_vao.bind();
+
+    m_program.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_program.enableAttributeArray(PROGRAM_OFFSET_ATTRIBUTE);
+    m_program.enableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
+    m_program.enableAttributeArray(PROGRAM_COLOR_ATTRIBUTE);
+
+    m_vertexBuffer.bind();
+    m_program.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, position), 3, sizeof(Vertex));
+    m_program.setAttributeBuffer(PROGRAM_OFFSET_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, offset), 2, sizeof(Vertex));
+    m_program.setAttributeBuffer(PROGRAM_TEXTURE_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, texCoord), 2, sizeof(Vertex));
+    m_program.setAttributeBuffer(PROGRAM_COLOR_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, color), 4, sizeof(Vertex));
+    m_vertexBuffer.release();
+
+    m_vao.release();
+
+    m_program.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_program.disableAttributeArray(PROGRAM_OFFSET_ATTRIBUTE);
+    m_program.disableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
+    m_program.disableAttributeArray(PROGRAM_COLOR_ATTRIBUTE);
+}
+
+void LabelBatch::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+{
+    Q_UNUSED(model)
+    place(view, projection);
+    m_vertices.clear();
+    foreach (const Placement &placement, m_placements) {
+        const Instance &instance = m_instances.at(placement.instance);
+        const Label &label = m_labels.at(instance.label);
+        QVector4D color(label.color, instance.alpha);
+        for (int i = label.firstQuad; i < label.firstQuad+label.nQuads; ++i) {
+            appendQuad(placement.position, m_quads.at(i).rect, m_quads.at(i).uv, color);
+        }
+    }
+    m_instances.clear();
+    if (m_vertices.isEmpty())
+        return;
+
+    RenderState::instance()->bindTexture(0, m_texture->textureId());
+    RenderState::State drawState;
+    drawState.blend = true;
+    draw(m_program, drawState, projection);
+}
+
+void LabelBatch::renderSolidColor(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+{
+    Q_UNUSED(model)
+    // Only what is visible can be picked, but the whole label rectangle, not only the glyphs
+    place(view, projection);
+    m_vertices.clear();
+    foreach (const Placement &placement, m_placements) {
+        const Label &label = m_labels.at(m_instances.at(placement.instance).label);
+        appendQuad(placement.position, label.bounds, QRectF(), QVector4D(label.pickColor, 1.0));
+    }
+    m_instances.clear();
+    if (m_vertices.isEmpty())
+        return;
+
+    draw(m_programColor, RenderState::State(), projection);
+}
+
+void LabelBatch::place(const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+{
+    // Screen rectangles of the labels in front of the camera and on screen
+    const float width = Resolution.width();
+    const float height = Resolution.height();
+    m_placements.clear();
+    for (int i = 0; i < m_instances.size(); ++i) {
+        const Instance &instance = m_instances.at(i);
+        Eigen::Vector3d eye = view*instance.position;
+        if (eye.z() >= 0.0)
+            continue;
+        Eigen::Vector4d clip = projection.matrix()*Eigen::Vector4d(eye.x(), eye.y(), eye.z(), 1.0);
+        float x = (clip.x()/clip.w()*0.5+0.5)*width;
+        float y = (clip.y()/clip.w()*0.5+0.5)*height;
+        const QRectF &bounds = m_labels.at(instance.label).bounds;
+        Placement placement;
+        placement.instance = i;
+        placement.priority = instance.priority;
+        placement.position[0] = eye.x();
+        placement.position[1] = eye.y();
+        placement.position[2] = eye.z();
+        placement.rect[0] = x+bounds.left();
+        placement.rect[1] = y+bounds.top();
+        placement.rect[2] = x+bounds.right();
+        placement.rect[3] = y+bounds.bottom();
+        if ( (placement.rect[2] < 0.0) || (placement.rect[0] > width)
+           ||(placement.rect[3] < 0.0) || (placement.rect[1] > height) ) {
+            continue;
+        }
+        m_placements.append(placement);
+    }
+    sortPlacements();
+
+    // Greedy placement by priority. Kept rectangles are registered in every grid
+    // cell they cover, so a candidate is only tested against its neighbours.
+    const int columns = qMax(1, (int)ceil(width/CellSize));
+    const int rows = qMax(1, (int)ceil(height/CellSize));
+    m_cellHeads.fill(-1, columns*rows);
+    m_entryNext.clear();
+    m_entryPlacement.clear();
+    m_kept.clear();
+    for (int i = 0; i < m_order.size(); ++i) {
+        const int candidate = m_order.at(i);
+        const float *rect = m_placements.at(candidate).rect;
+        const int x0 = qBound(0, (int)(rect[0]/CellSize), columns-1);
+        const int x1 = qBound(0, (int)(rect[2]/CellSize), columns-1);
+        const int y0 = qBound(0, (int)(rect[1]/CellSize), rows-1);
+        const int y1 = qBound(0, (int)(rect[3]/CellSize), rows-1);
+        bool overlaps = false;
+        for (int y = y0; (y <= y1) && !overlaps; ++y) {
+            for (int x = x0; (x <= x1) && !overlaps; ++x) {
+                for (int entry = m_cellHeads.at(y*columns+x); entry >= 0; entry = m_entryNext.at(entry)) {
+                    const float *other = m_placements.at(m_entryPlacement.at(entry)).rect;
+                    if ( (rect[0] < other[2]) && (other[0] < rect[2])
+                       &&(rect[1] < other[3]) && (other[1] < rect[3]) ) {
+                        overlaps = true;
+                        break;
+                    }
+                }
+            }
+        }
+        if (overlaps)
+            continue;
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                m_entryNext.append(m_cellHeads.at(y*columns+x));
+                m_entryPlacement.append(candidate);
+                m_cellHeads[y*columns+x] = m_entryNext.size()-1;
+            }
+        }
+        m_kept.append(m_placements.at(candidate));
+    }
+    m_placements.swap(m_kept);
+}
+
+void LabelBatch::sortPlacements()
+{
+    // Stable LSD radix sort of the candidate indices by decreasing priority, in
+    // three passes of 11 bits. Priorities are not negative, so the complement of
+    // their IEEE bits orders them from the highest down.
+    const int n = m_placements.size();
+    m_sortKeys.resize(n);
+    m_sortKeysTemp.resize(n);
+    m_order.resize(n);
+    m_orderTemp.resize(n);
+    for (int i = 0; i < n; ++i) {
+        quint32 bits;
+        memcpy(&bits, &m_placements.at(i).priority, sizeof(bits));
+        m_sortKeys[i] = ~bits;
+        m_order[i] = i;
+    }
+    for (int shift = 0; shift < 32; shift += RadixBits) {
+        int offsets[RadixBuckets+1] = {0};
+        for (int i = 0; i < n; ++i)
+            ++offsets[((m_sortKeys.at(i) >> shift) & (RadixBuckets-1))+1];
+        for (int bucket = 0; bucket < RadixBuckets; ++bucket)
+            offsets[bucket+1] += offsets[bucket];
+        for (int i = 0; i < n; ++i) {
+            int destination = offsets[(m_sortKeys.at(i) >> shift) & (RadixBuckets-1)]++;
+            m_sortKeysTemp[destination] = m_sortKeys.at(i);
+            m_orderTemp[destination] = m_order.at(i);
+        }
+        m_sortKeys.swap(m_sortKeysTemp);
+        m_order.swap(m_orderTemp);
+    }
+}
+
+void LabelBatch::appendQuad(const float *position, const QRectF &rect, const QRectF &uv, const QVector4D &color)
+{
+    // Two triangles, ES2 has no primitive restart and the batch may exceed 16 bit indices
+    static const int corners[6] = {0, 1, 2, 2, 1, 3};
+    for (int i = 0; i < 6; ++i) {
+        bool right = corners[i] & 1;
+        bool top = corners[i] & 2;
+        Vertex vertex;
+        vertex.position[0] = position[0];
+        vertex.position[1] = position[1];
+        vertex.position[2] = position[2];
+        vertex.offset[0] = right ? rect.right() : rect.left();
+        vertex.offset[1] = top ? rect.bottom() : rect.top();
+        vertex.texCoord[0] = right ? uv.right() : uv.left();
+        vertex.texCoord[1] = top ? uv.bottom() : uv.top();
+        vertex.color[0] = color.x();
+        vertex.color[1] = color.y();
+        vertex.color[2] = color.z();
+        vertex.color[3] = color.w();
+        m_vertices.append(vertex);
+    }
+}
+
+void LabelBatch::draw(QOpenGLShaderProgram &program, const RenderState::State &drawState, const Eigen::Affine3d &projection)
+{
+    // Orphan and refill, the driver does not have to wait for the previous frame
+    m_vertexBuffer.bind();
+    m_vertexBuffer.allocate(m_vertices.constData(), m_vertices.size() * sizeof(Vertex));
+    m_vertexBuffer.release();
+
+    RenderState *state = RenderState::instance();
+    state->useProgram(program);
+    setUniformMatrix(program.uniformLocation("projectionMatrix"), projection);
+    program.setUniformValue("logZbufferC", m_logZbufferC);
+    program.setUniformValue("C", m_C);
+    program.setUniformValue("pixelSize", QVector2D(2.0/Resolution.width(), 2.0/Resolution.height()));
+
+    state->apply(drawState);
+    m_vao.bind();
+    glDrawArrays(GL_TRIANGLES, 0, m_vertices.size());
+    m_vao.release();
+}
@@ -0,0 +1,94 @@
+#ifndef LABELBATCH_H
+#define LABELBATCH_H
+
+#include "pickable.h"
+#include "glyphatlas.h"
+#include "renderstate.h"
+
+#include <QOpenGLBuffer>
+#include <QOpenGLTexture>
+
+// All the labels of the scene, drawn from one glyph atlas and one streaming
+// vertex buffer. Labels are queued with add() during a pass, then drawn in a
+// single call by render() or renderSolidColor(), which empty the queue.
+class LabelBatch : public Pickable
+{
+public:
+    LabelBatch(QObject *parent = 0);
+    ~LabelBatch();
+    // Returns the label id
+    int addLabel(const QString &text, const QVector3D &color, int pickId);
+    // Higher priorities win when labels overlap on screen
+    void add(int label, const Eigen::Vector3d &position, float alpha = 1.0, float priority = 0.0);
+    void setSelectedLabel(int label) {m_selectedLabel = label;}
+
+    void createVAO();
+    // model is ignored, positions are in world coordinates
+    void render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+    void renderSolidColor(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+    static void setResolution(const QSizeF &resolution) {Resolution = resolution;}
+
+private:
+    struct Vertex {
+        GLfloat position[3]; // Anchor, eye coordinates
+        GLfloat offset[2]; // Pixels
+        GLfloat texCoord[2];
+        GLfloat color[4];
+    };
+    struct Quad {
+        QRectF rect; // Pixels, y up
+        QRectF uv;
+    };
+    struct Label {
+        QVector3D color;
+        QVector3D pickColor;
+        QRectF bounds; // Pixels, y up
+        int firstQuad;
+        int nQuads;
+    };
+    struct Instance {
+        int label;
+        Eigen::Vector3d position;
+        float alpha;
+        float priority;
+    };
+    struct Placement {
+        int instance;
+        float priority;
+        float position[3]; // Eye coordinates
+        float rect[4]; // Screen pixels, x0 y0 x1 y1
+    };
+
+    void place(const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+    void sortPlacements();
+    void appendQuad(const float *position, const QRectF &rect, const QRectF &uv, const QVector4D &color);
+    void draw(QOpenGLShaderProgram &program, const RenderState::State &drawState, const Eigen::Affine3d &projection);
+
+    // Side of the cells of the decluttering grid, in pixels
+    static const int CellSize = 64;
+    static const int RadixBits = 11;
+    static const int RadixBuckets = 1 << RadixBits;
+    static QSizeF Resolution;
+
+    GlyphAtlas *m_atlas;
+    QOpenGLTexture *m_texture;
+    float m_scale; // Label pixel size over the atlas pixel size
+    QVector<Label> m_labels;
+    QVector<Quad> m_quads;
+    QVector<Instance> m_instances;
+    int m_selectedLabel;
+    QVector<Placement> m_placements; // Candidates, then the labels kept
+    QVector<Placement> m_kept;
+    QVector<quint32> m_sortKeys;
+    QVector<quint32> m_sortKeysTemp;
+    QVector<int> m_order; // Candidates by decreasing priority
+    QVector<int> m_orderTemp;
+    QVector<int> m_cellHeads; // First entry of each grid cell
+    QVector<int> m_entryNext; // Next entry in the same cell
+    QVector<int> m_entryPlacement;
+    QVector<Vertex> m_vertices;
+
+    QOpenGLBuffer m_vertexBuffer;
+};
+
+#endif // LABELBATCH_H
@@ -2,249 +2,277 @@
 
 #include <cmath>
 
-Orbit::Orbit(const OrbitalElements &elements, const QVector3D &color, QObject *parent)
-    : Renderable(parent)
-    , m_elements(elements)
-    , m_vertexHighBuffer(QOpenGLBuffer::VertexBuffer)
-    , m_vertexLowBuffer(QOpenGLBuffer::VertexBuffer)
-    , m_colorBuffer(QOpenGLBuffer::VertexBuffer)
-    , m_color(color)
-{
-    setShaders(m_program, "orbit");
-    checkProgram(m_program);
-
-    Eigen::Vector2d pos;
-    QVector2D xpos, ypos; // For these, .x() represents the high component of a double and .y() the low component.
-    // Set a dummy vertex at t = 0
-    m_lastIndex = 0;
-    pos = position(0);
-    xpos = doubleToTwoFloats(pos.x());
-    ypos = doubleToTwoFloats(pos.y());
-    m_verticesHigh.append(QVector3D(xpos.x(), ypos.x(), 0.0));
-    m_verticesLow.append(QVector3D(xpos.y(), ypos.y(), 0.0));
-    m_colors.append(color);
-    // We double the vertex. See why in Orbit::setBodyPosition
-    m_verticesHigh.append(QVector3D(xpos.x(), ypos.x(), 0.0));
-    m_verticesLow.append(QVector3D(xpos.y(), ypos.y(), 0.0));
-    m_colors.append(color);
-
-    double t;
-    const int steps = 360;
-    for (int theta=0; theta<steps; ++theta) {
-        t = theta/(double)steps*m_elements.revolutionPeriod;
-        m_timeTable << t;
-        pos = position(t);
-        xpos = doubleToTwoFloats(pos.x());
-        ypos = doubleToTwoFloats(pos.y());
-        m_verticesHigh.append(QVector3D(xpos.x(), ypos.x(), 0.0));
-        m_verticesLow.append(QVector3D(xpos.y(), ypos.y(), 0.0));
-        m_colors.append(color);
-//        m_colors.append((theta%2)?QVector3D(1, 0, 0):QVector3D(0, 0, 1));
+// x-sin(x) and sinh(x)-x without the cancellation of small anomalies,
+// where Kepler's equation is the most sensitive for e close to 1
+static double xMinusSin(double x)
+{
+    if (std::abs(x) > 0.5)
+        return x-std::sin(x);
+    double x2 = x*x;
+    double term = x*x2/6.0;
+    double sum = term;
+    for (int n = 5; std::abs(term) > 1e-17*std::abs(sum); n += 2) {
+        term *= -x2/((n-1)*n);
+        sum += term;
     }
-    double angle = 0.0;
-    t = (angle-m_elements.meanAnomalyAtEpoch*M_PI/180.0)/(2*M_PI/m_elements.revolutionPeriod);
-    pos = position(t);
-    xpos = doubleToTwoFloats(pos.x());
-    ypos = doubleToTwoFloats(pos.y());
-    m_verticesHigh.append(QVector3D(xpos.x(), ypos.x(), 0.0));
-    m_verticesLow.append(QVector3D(xpos.y(), ypos.y(), 0.0));
-    m_colors.append(QVector3D(1.0, 0.0, 0.0));
-    angle = M_PI;
-    t = (angle-m_elements.meanAnomalyAtEpoch*M_PI/180.0)/(2*M_PI/m_elements.revolutionPeriod);
-    pos = position(t);
-    xpos = doubleToTwoFloats(pos.x());
-    ypos = doubleToTwoFloats(pos.y());
-    m_verticesHigh.append(QVector3D(xpos.x(), ypos.x(), 0.0));
-    m_verticesLow.append(QVector3D(xpos.y(), ypos.y(), 0.0));
-    m_colors.append(QVector3D(0.0, 0.0, 1.0));
-
-    m_orientation.setIdentity();
-    m_orientation.rotate(Eigen::AngleAxisd(m_elements.longitudeOfAscendingNode, Eigen::Vector3d::UnitZ()));
-    m_orientation.rotate(Eigen::AngleAxisd(m_elements.inclination, Eigen::Vector3d::UnitX()));
-    m_orientation.rotate(Eigen::AngleAxisd(m_elements.argumentOfPeriapsis, Eigen::Vector3d::UnitZ()));
-
-    m_program.bindAttributeLocation("vertexHigh", PROGRAM_VERTEX_HIGH_ATTRIBUTE);
-    m_program.bindAttributeLocation("vertexLow", PROGRAM_VERTEX_LOW_ATTRIBUTE);
-    m_program.bindAttributeLocation("color", PROGRAM_COLOR_ATTRIBUTE);
-
-    m_dataSize = m_verticesHigh.size();
-    // Orbit vertex high buffer init
-    m_vertexHighBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
-    m_vertexHighBuffer.create();
-    m_vertexHighBuffer.bind();
-    m_vertexHighBuffer.allocate(m_verticesHigh.constData(), m_verticesHigh.size() * sizeof(QVector3D));
-    m_vertexHighBuffer.release();
-    // Orbit vertex low component buffer init
-    m_vertexLowBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
-    m_vertexLowBuffer.create();
-    m_vertexLowBuffer.bind();
-    m_vertexLowBuffer.allocate(m_verticesLow.constData(), m_verticesLow.size() * sizeof(QVector3D));
-    m_vertexLowBuffer.release();
-    // Orbit color buffer init
-    m_colorBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
-    m_colorBuffer.create();
-    m_colorBuffer.bind();
-    m_colorBuffer.allocate(m_colors.constData(), m_colors.size() * sizeof(QVector4D));
-    m_colorBuffer.release();
-
-    createVAO();
-}
-
-Orbit::~Orbit()
-{
-    m_vertexHighBuffer.destroy();
-    m_vertexLowBuffer.destroy();
-    m_colorBuffer.destroy();
+    return sum;
 }
 
-Eigen::Vector2d Orbit::position(double time/*seconds past epoch*/) const
+static double sinhMinusX(double x)
 {
-    // http://en.wikipedia.org/wiki/Mean_anomaly
-    double meanAnomaly = m_elements.meanAnomalyAtEpoch + 2.0*M_PI/m_elements.revolutionPeriod * time;
-    double E = eccentricAnomaly(m_elements.eccentricity, meanAnomaly, 0.001);
-    double x = m_elements.semiMajorAxis*(cos(E)-m_elements.eccentricity);
-    double y = m_elements.semiMajorAxis*sqrt(1.0-m_elements.eccentricity*m_elements.eccentricity)*sin(E);
-
-    return Eigen::Vector2d(x, y);
-}
-
-double Orbit::eccentricAnomaly(double ecc, double M, double epsilon) const
-{
-    // http://www.jgiesen.de/kepler/kepler.html
-    // http://www.stargazing.net/kepler/kepler.html
-    // We need to solve the Kepler's equation E = M + ecc*sin(E)
-    // Finds the eccentric anomaly with Newton-Raphson
-    double delta = 0.05;
-    // First guess
-    double E = M;
-    while ( std::abs(delta) >= epsilon ) {
-        delta = E - ecc * sin(E) - M;
-        E = E - delta / (1.0 - ecc * cos(E));
+    if (std::abs(x) > 0.5)
+        return std::sinh(x)-x;
+    double x2 = x*x;
+    double term = x*x2/6.0;
+    double sum = term;
+    for (int n = 5; std::abs(term) > 1e-17*std::abs(sum); n += 2) {
+        term *= x2/((n-1)*n);
+        sum += term;
     }
-    return E;
+    return sum;
 }
 
-QVector2D Orbit::doubleToTwoFloats(double value)
+static double cubeRoot(double x)
 {
-    float high = (float)value;
-    float low = (float)(value-high);
-    return QVector2D(high, low);
+    return (x < 0.0) ? -std::pow(-x, 1.0/3.0) : std::pow(x, 1.0/3.0);
 }
 
-void Orbit::createVAO()
+Orbit::Orbit(const OrbitalElements &elements, QObject *parent)
+    : QObject(parent)
+    , m_elements(elements)
+    , m_bodyPosition(Eigen::Vector2d::Zero())
+    , m_bodyPhase(0.0)
+    , m_pathLimit(pathLimit(elements))
 {
-    m_vao.create();
-    m_vao.bind();
-
-    m_program.enableAttributeArray(PROGRAM_VERTEX_HIGH_ATTRIBUTE);
-    m_program.enableAttributeArray(PROGRAM_VERTEX_LOW_ATTRIBUTE);
-    m_program.enableAttributeArray(PROGRAM_COLOR_ATTRIBUTE);
-
-    m_vertexHighBuffer.bind();
-    m_program.setAttributeBuffer(PROGRAM_VERTEX_HIGH_ATTRIBUTE, GL_FLOAT, 0, 3);
-    m_vertexHighBuffer.release();
-
-    m_vertexLowBuffer.bind();
-    m_program.setAttributeBuffer(PROGRAM_VERTEX_LOW_ATTRIBUTE, GL_FLOAT, 0, 3);
-    m_vertexLowBuffer.release();
+    m_orientation = orientation(m_elements);
+}
 
-    m_colorBuffer.bind();
-    m_program.setAttributeBuffer(PROGRAM_COLOR_ATTRIBUTE, GL_FLOAT, 0, 4);
-    m_colorBuffer.release();
+Eigen::Affine3d Orbit::orientation(const OrbitalElements &elements)
+{
+    Eigen::Affine3d frame = Eigen::Affine3d::Identity();
+    frame.rotate(Eigen::AngleAxisd(elements.longitudeOfAscendingNode, Eigen::Vector3d::UnitZ()));
+    frame.rotate(Eigen::AngleAxisd(elements.inclination, Eigen::Vector3d::UnitX()));
+    frame.rotate(Eigen::AngleAxisd(elements.argumentOfPeriapsis, Eigen::Vector3d::UnitZ()));
+    return frame;
+}
 
-    m_vao.release();
+Orbit::Path Orbit::createPath(const OrbitalElements &osculating)
+{
+    // The shape at the epoch, the orbit frame follows the precessions
+    const OrbitalElements elements = at(osculating, osculating.epoch);
+    Path path;
+    path.open = isOpen(elements);
+    double e = elements.eccentricity;
+    double a = std::abs(elements.semiMajorAxis);
+    double limit = pathLimit(elements);
+    for (int i = 0; i <= Steps; ++i) {
+        Eigen::Vector2d pos;
+        if (!path.open) {
+            double t = elements.epoch+(i%Steps)/(double)Steps*elements.revolutionPeriod;
+            pos = position(elements, t);
+        } else {
+            // Evenly in anomaly, the samples get sparse along the asymptotes
+            double x = (2.0*i/Steps-1.0)*limit;
+            if (e > 1.0)
+                pos = Eigen::Vector2d(a*(e-std::cosh(x)), a*std::sqrt(e*e-1.0)*std::sinh(x));
+            else
+                pos = Eigen::Vector2d(a*(1.0-x*x), 2.0*a*x);
+        }
+        // For these, .x() represents the high component of a double and .y() the low component.
+        QVector2D xpos = doubleToTwoFloats(pos.x());
+        QVector2D ypos = doubleToTwoFloats(pos.y());
+        path.verticesHigh.append(QVector3D(xpos.x(), ypos.x(), 0.0));
+        path.verticesLow.append(QVector3D(xpos.y(), ypos.y(), 0.0));
+    }
+    return path;
+}
 
-    m_program.disableAttributeArray(PROGRAM_VERTEX_HIGH_ATTRIBUTE);
-    m_program.disableAttributeArray(PROGRAM_VERTEX_LOW_ATTRIBUTE);
-    m_program.disableAttributeArray(PROGRAM_COLOR_ATTRIBUTE);
+Eigen::Vector2d Orbit::position(double time/*seconds past epoch*/) const
+{
+    return position(m_elements, time);
 }
 
-void Orbit::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+Eigen::Vector2d Orbit::position(const OrbitalElements &osculating, double time)
 {
-    updateBuffers();
+    const OrbitalElements elements = at(osculating, time);
+    double e = elements.eccentricity;
+    double a = elements.semiMajorAxis;
+    double x = anomaly(elements, time);
+    if (e < 1.0)
+        return Eigen::Vector2d(a*(std::cos(x)-e), a*std::sqrt(1.0-e*e)*std::sin(x));
+    a = std::abs(a);
+    if (e > 1.0)
+        return Eigen::Vector2d(a*(e-std::cosh(x)), a*std::sqrt(e*e-1.0)*std::sinh(x));
+    // Barker: a is the periapsis distance
+    return Eigen::Vector2d(a*(1.0-x*x), 2.0*a*x);
+}
 
-    m_program.bind();
+void Orbit::state(const OrbitalElements &osculating, double time, double gm,
+                  Eigen::Vector2d &position, Eigen::Vector2d &velocity)
+{
+    // The speed follows from gm, not from the period of the catalog
+    const OrbitalElements elements = at(osculating, time);
+    double e = elements.eccentricity;
+    double a = std::abs(elements.semiMajorAxis);
+    double x = anomaly(elements, time);
+    if (e < 1.0) {
+        double b = std::sqrt(1.0-e*e);
+        position = Eigen::Vector2d(a*(std::cos(x)-e), a*b*std::sin(x));
+        double speed = std::sqrt(gm/a)/(1.0-e*std::cos(x));
+        velocity = Eigen::Vector2d(-speed*std::sin(x), speed*b*std::cos(x));
+    } else if (e > 1.0) {
+        double b = std::sqrt(e*e-1.0);
+        position = Eigen::Vector2d(a*(e-std::cosh(x)), a*b*std::sinh(x));
+        double speed = std::sqrt(gm/a)/(e*std::cosh(x)-1.0);
+        velocity = Eigen::Vector2d(-speed*std::sinh(x), speed*b*std::cosh(x));
+    } else {
+        position = Eigen::Vector2d(a*(1.0-x*x), 2.0*a*x);
+        double speed = std::sqrt(2.0*gm/a)/(1.0+x*x);
+        velocity = Eigen::Vector2d(-speed*x, speed);
+    }
+}
 
-    // To prevent jitter, we use the GPU RTE DSFUN90 method - 3D Engine Design for Virtual Globes chap5.4
-    Eigen::Affine3d modelviewRTE = view*model;
-    modelviewRTE.translation() = Eigen::Vector3d::Zero();
-    setUniformMatrix(m_program.uniformLocation("modelViewMatrixRTE"), modelviewRTE);
-    setUniformMatrix(m_program.uniformLocation("projectionMatrix"), projection);
+OrbitalElements Orbit::at(const OrbitalElements &elements, double time)
+{
+    if (!hasRates(elements))
+        return elements;
+    double dt = time-elements.epoch;
+    OrbitalElements current = elements;
+    current.eccentricity += elements.eccentricityRate*dt;
+    current.semiMajorAxis += elements.semiMajorAxisRate*dt;
+    current.inclination += elements.inclinationRate*dt;
+    current.longitudeOfAscendingNode += elements.longitudeOfAscendingNodeRate*dt;
+    current.argumentOfPeriapsis += elements.argumentOfPeriapsisRate*dt;
+    // The period of the catalog is sidereal, the mean anomaly is counted
+    // from the moving periapsis
+    double periapsisRate = elements.longitudeOfAscendingNodeRate+elements.argumentOfPeriapsisRate;
+    current.meanAnomalyAtEpoch -= periapsisRate*dt;
+    current.eccentricityRate = 0.0;
+    current.semiMajorAxisRate = 0.0;
+    current.inclinationRate = 0.0;
+    current.longitudeOfAscendingNodeRate = 0.0;
+    current.argumentOfPeriapsisRate = 0.0;
+    return current;
+}
 
-    Eigen::Vector3d cameraPosition = (view*model).inverse().translation();
-    QVector2D doubleX = doubleToTwoFloats(cameraPosition.x());
-    QVector2D doubleY = doubleToTwoFloats(cameraPosition.y());
-    QVector2D doubleZ = doubleToTwoFloats(cameraPosition.z());
-    QVector3D cameraPosHigh(doubleX.x(), doubleY.x(), doubleZ.x());
-    QVector3D cameraPosLow(doubleX.y(), doubleY.y(), doubleZ.y());
-    m_program.setUniformValue("cameraPosHigh", cameraPosHigh);
-    m_program.setUniformValue("cameraPosLow", cameraPosLow);
+bool Orbit::hasRates(const OrbitalElements &elements)
+{
+    return (elements.eccentricityRate != 0.0) || (elements.semiMajorAxisRate != 0.0)
+         ||(elements.inclinationRate != 0.0) || (elements.longitudeOfAscendingNodeRate != 0.0)
+         ||(elements.argumentOfPeriapsisRate != 0.0);
+}
 
-    m_program.setUniformValue("logZbufferC", m_logZbufferC);
-    m_program.setUniformValue("C", m_C);
-    m_program.setUniformValue("alpha", m_alpha);
+double Orbit::anomaly(const OrbitalElements &elements, double time)
+{
+    // http://en.wikipedia.org/wiki/Mean_anomaly
+    double meanAnomaly = elements.meanAnomalyAtEpoch + 2.0*M_PI/elements.revolutionPeriod * (time-elements.epoch);
+    double e = elements.eccentricity;
+    if (e < 1.0)
+        return eccentricAnomaly(e, meanAnomaly);
+    if (e > 1.0)
+        return hyperbolicAnomaly(e, meanAnomaly);
+    // Barker's equation D+D^3/3 = M, in closed form
+    double b = 1.5*std::abs(meanAnomaly);
+    double c = cubeRoot(b+std::sqrt(1.0+b*b));
+    return (meanAnomaly < 0.0) ? 1.0/c-c : c-1.0/c;
+}
 
-    m_vao.bind();
-    glEnable(GL_BLEND);
-    glDrawArrays(GL_LINE_LOOP, 0, m_dataSize-2);
-    glDisable(GL_BLEND);
-//    glDrawArrays(GL_LINES, m_dataSize-2, 2);
-    m_vao.release();
+double Orbit::eccentricAnomaly(double e, double M)
+{
+    // Solves E-e*sin(E) = M for |M| in [0, pi] and uses the symmetry. The
+    // starter of Markley (Celestial Mechanics 63, 1995) is within 1e-4 for
+    // any e < 1, then Danby's quartic corrections converge in 3 iterations.
+    double turns = std::floor((M+M_PI)/(2.0*M_PI));
+    double m = M-2.0*M_PI*turns;
+    double sign = (m < 0.0) ? -1.0 : 1.0;
+    m = std::abs(m);
+    double alpha = (3.0*M_PI*M_PI+1.6*M_PI*(M_PI-m)/(1.0+e))/(M_PI*M_PI-6.0);
+    double d = 3.0*(1.0-e)+alpha*e;
+    double q = 2.0*alpha*d*(1.0-e)-m*m;
+    double r = 3.0*alpha*d*(d-1.0+e)*m+m*m*m;
+    double w = std::pow(std::abs(r)+std::sqrt(q*q*q+r*r), 2.0/3.0);
+    double E = (2.0*r*w/(w*w+w*q+q*q)+m)/d;
+    for (int i = 0; i < MaxIterations; ++i) {
+        double es = e*std::sin(E);
+        double ec = e*std::cos(E);
+        double f = (1.0-e)*E+e*xMinusSin(E)-m;
+        double d1 = -f/(1.0-ec);
+        double d2 = -f/(1.0-ec+0.5*d1*es);
+        double d3 = -f/(1.0-ec+0.5*d2*es+d2*d2*ec/6.0);
+        E += d3;
+        if (std::abs(d3) < 1e-15*qMax(1.0, E))
+            break;
+    }
+    return sign*E+2.0*M_PI*turns;
+}
 
-    m_program.release();
+double Orbit::hyperbolicAnomaly(double e, double M)
+{
+    // Solves e*sinh(H)-H = M for |M| and uses the symmetry. The starter is
+    // the smaller of the root of the cubic of the series, above the solution,
+    // and of the logarithm of large anomalies (Danby), then the same
+    // quartic corrections as the ellipse converge in 4 iterations.
+    double sign = (M < 0.0) ? -1.0 : 1.0;
+    double m = std::abs(M);
+    double p = 6.0*(e-1.0)/e;
+    double q = 3.0*m/e;
+    double s = std::sqrt(q*q+p*p*p/27.0);
+    double H = qMin(cubeRoot(q+s)+cubeRoot(q-s), std::log(2.0*m/e+1.8));
+    for (int i = 0; i < MaxIterations; ++i) {
+        double es = e*std::sinh(H);
+        double ec = e*std::cosh(H);
+        double f = (e-1.0)*H+e*sinhMinusX(H)-m;
+        double d1 = -f/(ec-1.0);
+        double d2 = -f/(ec-1.0+0.5*d1*es);
+        double d3 = -f/(ec-1.0+0.5*d2*es+d2*d2*ec/6.0);
+        H += d3;
+        if (std::abs(d3) < 1e-15*qMax(1.0, H))
+            break;
+    }
+    return sign*H;
 }
 
-void Orbit::updateBuffers()
+double Orbit::pathLimit(const OrbitalElements &elements)
 {
-    // Orbit vertex high buffer
-    m_vertexHighBuffer.bind();
-    m_vertexHighBuffer.write(0, m_verticesHigh.constData(), m_verticesHigh.size() * sizeof(QVector3D));
-    m_vertexHighBuffer.release();
-    // Orbit vertex low component buffer
-    m_vertexLowBuffer.bind();
-    m_vertexLowBuffer.write(0, m_verticesLow.constData(), m_verticesLow.size() * sizeof(QVector3D));
-    m_vertexLowBuffer.release();
-    // Orbit color buffer
-    m_colorBuffer.bind();
-    m_colorBuffer.write(0, m_colors.constData(), m_colors.size() * sizeof(QVector4D));
-    m_colorBuffer.release();
+    // Where the distance is OpenPathExtent times the periapsis distance
+    double e = elements.eccentricity;
+    if (e < 1.0)
+        return 0.0;
+    if (e > 1.0) {
+        double c = (OpenPathExtent*(e-1.0)+1.0)/e;
+        return std::log(c+std::sqrt(c*c-1.0));
+    }
+    return std::sqrt(OpenPathExtent-1.0);
 }
 
+QVector2D Orbit::doubleToTwoFloats(double value)
+{
+    float high = (float)value;
+    float low = (float)(value-high);
+    return QVector2D(high, low);
+}
 
 void Orbit::setBodyPosition(Eigen::Vector2d position, double time)
 {
-    // Insert a vertex defined by position based on its timestamp
-    // We don't want the transparency at both ends of the loop to be interpolated,
-    // so we actually insert (and remove) the vertex twice to prevent that.
-    // Using the flat interpolator would be better but it is unavailable in gles 2.0.
-    // Remove the old vertex
-    m_verticesHigh.removeAt(m_lastIndex);
-    m_verticesLow.removeAt(m_lastIndex);
-    m_colors.removeAt(m_lastIndex);
-    m_verticesHigh.removeAt(m_lastIndex);
-    m_verticesLow.removeAt(m_lastIndex);
-    m_colors.removeAt(m_lastIndex);
-    // Find the position in the list to insert the vertex
-    double t = fmod(time, m_elements.revolutionPeriod);
-    int index = 0;
-    while ( (index < m_timeTable.size()) && (m_timeTable.at(index) < t) ) {
-        ++index;
-    }
-    m_lastIndex = index;
-    // Insertions
-    QVector2D xpos = doubleToTwoFloats(position.x());
-    QVector2D ypos = doubleToTwoFloats(position.y());
-    m_verticesHigh.insert(index, QVector3D(xpos.x(), ypos.x(), 0.0));
-    m_verticesLow.insert(index, QVector3D(xpos.y(), ypos.y(), 0.0));
-    m_colors.insert(index, m_color);
-    m_verticesHigh.insert(index, QVector3D(xpos.x(), ypos.x(), 0.0));
-    m_verticesLow.insert(index, QVector3D(xpos.y(), ypos.y(), 0.0));
-    m_colors.insert(index, m_color);
-    // Update transparency
-    int n = m_timeTable.size()+2; // +2 because we added 2 vertices.
-    for (int i = 0; i < n; ++i) {
-        float alpha = (float)i/(float)n;
-        m_colors[(i+index+1)%n].setW(alpha);
+    m_bodyPosition = position;
+    if (isOpen(m_elements)) {
+        // From the position, which may come from an ephemeris
+        double e = m_elements.eccentricity;
+        double a = std::abs(m_elements.semiMajorAxis);
+        double x = position.y()/(2.0*a);
+        if (e > 1.0) {
+            double sinhX = std::abs(position.y())/(a*std::sqrt(e*e-1.0));
+            x = std::log(sinhX+std::sqrt(sinhX*sinhX+1.0));
+            if (position.y() < 0.0)
+                x = -x;
+        }
+        m_bodyPhase = 0.5*(x/m_pathLimit+1.0);
+        return;
     }
+    // Samples of the path at the epoch, by mean anomaly
+    double periapsisRate = m_elements.longitudeOfAscendingNodeRate+m_elements.argumentOfPeriapsisRate;
+    double meanMotion = 2.0*M_PI/m_elements.revolutionPeriod-periapsisRate;
+    m_bodyPhase = fmod(meanMotion*(time-m_elements.epoch)/(2.0*M_PI), 1.0);
+    if (m_bodyPhase < 0.0)
+        m_bodyPhase += 1.0;
 }
-
@@ -1,53 +1,88 @@
 #ifndef ORBIT_H
 #define ORBIT_H
 
-#include "renderable.h"
+#include <QObject>
+#include <QVector>
+#include <QVector2D>
+#include <QVector3D>
 
-#include <QOpenGLBuffer>
+#include "Eigen/Geometry"
 
+// Open orbits have an eccentricity of 1 or more: a parabola or a hyperbola.
 struct OrbitalElements {
     double eccentricity;
-    double semiMajorAxis; // 10e3m
+    double semiMajorAxis; // 10e3m, negative for hyperbolas, the periapsis distance for parabolas
     double inclination; // rad
     double longitudeOfAscendingNode; // rad
     double argumentOfPeriapsis; // rad
     double meanAnomalyAtEpoch; // rad
-    double revolutionPeriod; // s
+    double revolutionPeriod; // s, 2pi over the mean motion for open orbits
+    double epoch; // s past J2000, of the elements
+    // Secular rates, linear from the epoch: precessions of the node and of
+    // the periapsis, slow changes of the shape
+    double eccentricityRate; // 1/s
+    double semiMajorAxisRate; // 10e3m/s
+    double inclinationRate; // rad/s
+    double longitudeOfAscendingNodeRate; // rad/s
+    double argumentOfPeriapsisRate; // rad/s
 };
 
-class Orbit : public Renderable
+// The Keplerian motion of a body. The conic itself is drawn by OrbitBatch.
+class Orbit : public QObject
 {
 public:
-    Orbit(const OrbitalElements &elements, const QVector3D &color = QVector3D(0.5, 0.5, 0.5), QObject *parent = 0);
-    ~Orbit();
+    // Samples of the path, evenly spaced in time, or in anomaly for open orbits
+    static const int Steps = 360;
+    // Open paths go that many periapsis distances away from the focus
+    static const int OpenPathExtent = 20;
+    // Kepler's equation is solved to the double precision within these
+    static const int MaxIterations = 4;
+    struct Path {
+        // Steps+1 positions in the orbital plane, the last one closes the loop
+        // of the closed orbits
+        QVector<QVector3D> verticesHigh;
+        QVector<QVector3D> verticesLow;
+        bool open;
+    };
+    // CPU only, can run on any thread
+    static Path createPath(const OrbitalElements &elements);
+    static Eigen::Vector2d position(const OrbitalElements &elements, double time);
+    // The mean elements at the time, without rates, with the same position then
+    static OrbitalElements at(const OrbitalElements &elements, double time);
+    static bool hasRates(const OrbitalElements &elements);
+    // From the orbital plane to the frame of the elements
+    static Eigen::Affine3d orientation(const OrbitalElements &elements);
+    // Osculating state in the orbital plane, for a central body of the given gravitational parameter
+    static void state(const OrbitalElements &elements, double time, double gm,
+                      Eigen::Vector2d &position, Eigen::Vector2d &velocity);
+    static QVector2D doubleToTwoFloats(double value);
+    static bool isOpen(const OrbitalElements &elements) {return elements.eccentricity >= 1.0;}
+
+    Orbit(const OrbitalElements &elements, QObject *parent = 0);
     OrbitalElements elements() const {return m_elements;}
 
     Eigen::Affine3d orientation() const {return m_orientation;}
     Eigen::Vector2d position(double time) const;
 
-    void createVAO();
-    void render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
     void setBodyPosition(Eigen::Vector2d position, double time);
+    Eigen::Vector2d bodyPosition() const {return m_bodyPosition;}
+    // Fraction of the revolution since the first sample of the path, in [0, 1).
+    // Open orbits: fraction of the path, out of [0, 1] beyond its ends.
+    double bodyPhase() const {return m_bodyPhase;}
 
 private:
-    double eccentricAnomaly(double ecc, double M, double epsilon) const;
-    QVector2D doubleToTwoFloats(double value);
-    void updateBuffers();
+    // Eccentric, hyperbolic anomaly or tan(v/2) for parabolas, at the time
+    static double anomaly(const OrbitalElements &elements, double time);
+    static double eccentricAnomaly(double e, double M);
+    static double hyperbolicAnomaly(double e, double M);
+    // Anomaly of the ends of an open path
+    static double pathLimit(const OrbitalElements &elements);
 
     OrbitalElements m_elements;
     Eigen::Affine3d m_orientation;
-
-    QVector<QVector3D> m_verticesHigh;
-    QVector<QVector3D> m_verticesLow;
-    QVector<QVector4D> m_colors;
-
-    QOpenGLBuffer m_vertexHighBuffer;
-    QOpenGLBuffer m_vertexLowBuffer;
-    QOpenGLBuffer m_colorBuffer;
-
-    QVector4D m_color;
-    QList<double> m_timeTable;
-    int m_lastIndex;
+    Eigen::Vector2d m_bodyPosition;
+    double m_bodyPhase;
+    double m_pathLimit;
 };
 
 #endif // ORBIT_H
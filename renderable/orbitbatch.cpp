@@ -0,0 +1,190 @@
+#include "orbitbatch.h"
+#include "renderstate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <QOpenGLContext>
+
+#ifndef GL_MAX_VERTEX_UNIFORM_VECTORS
+#define GL_MAX_VERTEX_UNIFORM_VECTORS 0x8DFB
+#endif
+#ifndef GL_MAX_VERTEX_UNIFORM_COMPONENTS
+#define GL_MAX_VERTEX_UNIFORM_COMPONENTS 0x8B4A
+#endif
+
+OrbitBatch::OrbitBatch(QObject *parent)
+    : Renderable(parent)
+    , m_orbitsPerDraw(1)
+    , m_verticesChanged(false)
+    , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
+{
+    // Uniform arrays need a constant size, as large as the vertex uniforms allow.
+    // ES2 guarantees 128 vectors, about 16 orbits per draw; desktop GL fits them all.
+    GLint maxVectors = 0;
+    if (QOpenGLContext::currentContext()->isOpenGLES()) {
+        glGetIntegerv(GL_MAX_VERTEX_UNIFORM_VECTORS, &maxVectors);
+    } else {
+        glGetIntegerv(GL_MAX_VERTEX_UNIFORM_COMPONENTS, &maxVectors);
+        maxVectors /= 4;
+    }
+    // Keep a few vectors for the matrices and scalars
+    m_orbitsPerDraw = qBound(1, (int)(maxVectors-16)/VectorsPerOrbit, MaxOrbitsPerDraw);
+
+    setShaders(m_program, "orbit.vert", "orbit.frag",
+               QByteArray("#define ORBITS_PER_DRAW ")+QByteArray::number(m_orbitsPerDraw)+"\n");
+    checkProgram(m_program);
+
+    m_program.bind();
+    m_program.setUniformValue("steps", (GLfloat)Orbit::Steps);
+    m_program.release();
+
+    m_rotations.resize(9*m_orbitsPerDraw);
+    m_cameraHigh.resize(m_orbitsPerDraw);
+    m_cameraLow.resize(m_orbitsPerDraw);
+    m_bodyPositions.resize(m_orbitsPerDraw);
+    m_colors.resize(m_orbitsPerDraw);
+
+    m_vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_vertexBuffer.create();
+
+    createVAO();
+}
+
+OrbitBatch::~OrbitBatch()
+{
+    m_vertexBuffer.destroy();
+}
+
+int OrbitBatch::addOrbit(const Orbit::Path &path, const QVector3D &color)
+{
+    Q_ASSERT(path.verticesHigh.size() == Orbit::Steps+1);
+    const int orbit = m_parameters.size();
+    Parameters parameters;
+    parameters.color = color;
+    parameters.alpha = 0.0;
+    parameters.rotation.setIdentity();
+    parameters.translation.setZero();
+    parameters.bodyPosition[0] = 0.0;
+    parameters.bodyPosition[1] = 0.0;
+    parameters.bodyPhase = 0.0;
+    m_parameters.append(parameters);
+
+    for (int i = 0; i < Orbit::Steps; ++i) {
+        for (int j = i; j <= i+1; ++j) {
+            Vertex vertex;
+            vertex.high[0] = path.verticesHigh.at(j).x();
+            vertex.high[1] = path.verticesHigh.at(j).y();
+            vertex.high[2] = path.verticesHigh.at(j).z();
+            vertex.low[0] = path.verticesLow.at(j).x();
+            vertex.low[1] = path.verticesLow.at(j).y();
+            vertex.low[2] = path.verticesLow.at(j).z();
+            vertex.sample[0] = j;
+            vertex.sample[1] = orbit%m_orbitsPerDraw;
+            vertex.sample[2] = path.open ? 1.0 : 0.0;
+            m_vertices.append(vertex);
+        }
+    }
+    m_verticesChanged = true;
+    return orbit;
+}
+
+void OrbitBatch::add(int orbit, const Eigen::Affine3d &frame, const Orbit &body, float alpha)
+{
+    Parameters &parameters = m_parameters[orbit];
+    parameters.alpha = alpha;
+    parameters.rotation = frame.linear();
+    parameters.translation = frame.translation();
+    parameters.bodyPosition[0] = body.bodyPosition().x();
+    parameters.bodyPosition[1] = body.bodyPosition().y();
+    parameters.bodyPhase = body.bodyPhase();
+}
+
+void OrbitBatch::createVAO()
+{
+    m_vao.create();
+    m_vao.bind();
+
+    m_program.enableAttributeArray(PROGRAM_VERTEX_HIGH_ATTRIBUTE);
+    m_program.enableAttributeArray(PROGRAM_VERTEX_LOW_ATTRIBUTE);
+    m_program.enableAttributeArray(PROGRAM_ORBIT_SAMPLE_ATTRIBUTE);
+
+    m_vertexBuffer.bind();
+    m_program.setAttributeBuffer(PROGRAM_VERTEX_HIGH_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, high), 3, sizeof(Vertex));
+    m_program.setAttributeBuffer(PROGRAM_VERTEX_LOW_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, low), 3, sizeof(Vertex));
+    m_program.setAttributeBuffer(PROGRAM_ORBIT_SAMPLE_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, sample), 3, sizeof(Vertex));
+    m_vertexBuffer.release();
+
+    m_vao.release();
+
+    m_program.disableAttributeArray(PROGRAM_VERTEX_HIGH_ATTRIBUTE);
+    m_program.disableAttributeArray(PROGRAM_VERTEX_LOW_ATTRIBUTE);
+    m_program.disableAttributeArray(PROGRAM_ORBIT_SAMPLE_ATTRIBUTE);
+}
+
+void OrbitBatch::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+{
+    Q_UNUSED(model)
+    if (m_verticesChanged) {
+        m_vertexBuffer.bind();
+        m_vertexBuffer.allocate(m_vertices.constData(), m_vertices.size() * sizeof(Vertex));
+        m_vertexBuffer.release();
+        m_verticesChanged = false;
+    }
+
+    RenderState *state = RenderState::instance();
+    state->useProgram(m_program);
+    setUniformMatrix(m_program.uniformLocation("projectionMatrix"), projection);
+    m_program.setUniformValue("logZbufferC", m_logZbufferC);
+    m_program.setUniformValue("C", m_C);
+    const int rotationLocation = m_program.uniformLocation("rotation");
+
+    RenderState::State drawState;
+    drawState.blend = true;
+    state->apply(drawState);
+    m_vao.bind();
+    // One draw when the whole table fits in the vertex uniforms
+    for (int first = 0; first < m_parameters.size(); first += m_orbitsPerDraw) {
+        const int count = qMin(m_orbitsPerDraw, m_parameters.size()-first);
+        bool queued = false;
+        for (int i = 0; i < count; ++i) {
+            Parameters &parameters = m_parameters[first+i];
+            m_colors[i] = QVector4D(parameters.color, parameters.alpha);
+            if (parameters.alpha <= 0.0)
+                continue;
+            queued = true;
+            parameters.alpha = 0.0;
+
+            Eigen::Affine3d frame;
+            frame.linear() = parameters.rotation;
+            frame.translation() = parameters.translation;
+            // To prevent jitter, we use the GPU RTE DSFUN90 method - 3D Engine Design for Virtual Globes chap5.4
+            const Eigen::Affine3d modelView = view*frame;
+            Eigen::Matrix3f rotation = modelView.linear().cast<float>();
+            std::copy(rotation.data(), rotation.data()+9, m_rotations.begin()+9*i);
+
+            Eigen::Vector3d cameraPosition = modelView.inverse().translation();
+            QVector2D doubleX = Orbit::doubleToTwoFloats(cameraPosition.x());
+            QVector2D doubleY = Orbit::doubleToTwoFloats(cameraPosition.y());
+            QVector2D doubleZ = Orbit::doubleToTwoFloats(cameraPosition.z());
+            // The sample at the body phase, and the one moved onto the body
+            const double sample = parameters.bodyPhase*Orbit::Steps;
+            m_cameraHigh[i] = QVector4D(doubleX.x(), doubleY.x(), doubleZ.x(), sample);
+            m_cameraLow[i] = QVector4D(doubleX.y(), doubleY.y(), doubleZ.y(), floor(sample+0.5));
+
+            QVector2D bodyX = Orbit::doubleToTwoFloats(parameters.bodyPosition[0]);
+            QVector2D bodyY = Orbit::doubleToTwoFloats(parameters.bodyPosition[1]);
+            m_bodyPositions[i] = QVector4D(bodyX.x(), bodyY.x(), bodyX.y(), bodyY.y());
+        }
+        if (!queued)
+            continue;
+
+        glUniformMatrix3fv(rotationLocation, count, GL_FALSE, m_rotations.constData());
+        m_program.setUniformValueArray("cameraHigh", m_cameraHigh.constData(), count);
+        m_program.setUniformValueArray("cameraLow", m_cameraLow.constData(), count);
+        m_program.setUniformValueArray("bodyPosition", m_bodyPositions.constData(), count);
+        m_program.setUniformValueArray("orbitColor", m_colors.constData(), count);
+        glDrawArrays(GL_LINES, first*VerticesPerOrbit, count*VerticesPerOrbit);
+    }
+    m_vao.release();
+}
@@ -0,0 +1,65 @@
+#ifndef ORBITBATCH_H
+#define ORBITBATCH_H
+
+#include "renderable.h"
+#include "orbit.h"
+
+#include <QOpenGLBuffer>
+
+// All the orbit conics in one static vertex buffer, as line segments so that
+// they can be drawn by a single glDrawArrays. Each orbit has an entry in a
+// parameter table (orientation, camera position, body phase, color, alpha),
+// uploaded as uniform arrays. Orbits are queued with add() during a pass and
+// drawn by render(), which empties the queue.
+class OrbitBatch : public Renderable
+{
+public:
+    OrbitBatch(QObject *parent = 0);
+    ~OrbitBatch();
+    // Returns the orbit id
+    int addOrbit(const Orbit::Path &path, const QVector3D &color);
+    // frame is the orbital plane frame, body the position of the body in that plane
+    void add(int orbit, const Eigen::Affine3d &frame, const Orbit &body, float alpha = 1.0);
+
+    void createVAO();
+    // model is ignored, frames are in world coordinates
+    void render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+
+private:
+    struct Vertex {
+        GLfloat high[3];
+        GLfloat low[3];
+        GLfloat sample[3]; // Sample index along the orbit, orbit index in its draw, 1 if open
+    };
+    struct Parameters {
+        QVector3D color;
+        float alpha; // 0 when not queued
+        // Eigen types that need no alignment
+        Eigen::Matrix3d rotation;
+        Eigen::Vector3d translation;
+        double bodyPosition[2];
+        double bodyPhase;
+    };
+
+    // Segments per orbit, times two vertices
+    static const int VerticesPerOrbit = 2*Orbit::Steps;
+    // The table must fit in the vertex uniforms: 7 vectors per orbit
+    static const int VectorsPerOrbit = 7;
+    static const int MaxOrbitsPerDraw = 64;
+
+    int m_orbitsPerDraw;
+    QVector<Parameters> m_parameters;
+    QVector<Vertex> m_vertices;
+    bool m_verticesChanged;
+
+    // Uniform arrays of one draw
+    QVector<GLfloat> m_rotations;
+    QVector<QVector4D> m_cameraHigh;
+    QVector<QVector4D> m_cameraLow;
+    QVector<QVector4D> m_bodyPositions;
+    QVector<QVector4D> m_colors;
+
+    QOpenGLBuffer m_vertexBuffer;
+};
+
+#endif // ORBITBATCH_H
@@ -6,10 +6,15 @@ Pickable::Pickable(QObject *parent)
 
 void Pickable::setColor(int id)
 {
-    m_color = QVector3D((id >> 16) & 255, (id >> 8) & 255, id & 255)/255;
+    m_color = idColor(id);
 }
 
 void Pickable::setColor(const QVector3D &color)
 {
     m_color = color;
 }
+
+QVector3D Pickable::idColor(int id)
+{
+    return QVector3D((id >> 16) & 255, (id >> 8) & 255, id & 255)/255;
+}
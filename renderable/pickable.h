@@ -10,6 +10,9 @@ public:
     void setColor(int id);
     void setColor(const QVector3D &color);
     virtual void renderSolidColor(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection) = 0;
+    GLuint solidColorProgramId() const {return m_programColor.programId();}
+    // Color of an object id in the picking buffer
+    static QVector3D idColor(int id);
 
 protected:
     QOpenGLShaderProgram m_programColor;
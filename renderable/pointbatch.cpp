@@ -0,0 +1,126 @@
+#include "pointbatch.h"
+
+#include <cstddef>
+
+float PointBatch::PointSize(10.0);
+
+PointBatch::PointBatch(QObject *parent)
+    : Pickable(parent)
+    , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
+{
+    setShaders(m_program, "coloredPoint");
+    checkProgram(m_program);
+
+    setShaders(m_programColor, "pointSolidColor");
+    checkProgram(m_programColor);
+
+    m_vertexBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+    m_vertexBuffer.create();
+
+    createVAO();
+}
+
+PointBatch::~PointBatch()
+{
+    m_vertexBuffer.destroy();
+}
+
+int PointBatch::addPoint(const QVector3D &color, int pickId)
+{
+    Point point;
+    point.color = color;
+    point.pickColor = idColor(pickId);
+    m_points.append(point);
+    return m_points.size()-1;
+}
+
+void PointBatch::add(int point, const Eigen::Vector3d &position, float alpha)
+{
+    Instance instance;
+    instance.point = point;
+    instance.position = position;
+    instance.alpha = alpha;
+    m_instances.append(instance);
+}
+
+void PointBatch::createVAO()
+{
+    m_vao.create();
+    m_vao.bind();
+
+    // Both programs share the attribute locations
+    m_program.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_program.enableAttributeArray(PROGRAM_COLOR_ATTRIBUTE);
+
+    m_vertexBuffer.bind();
+    m_program.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, position), 3, sizeof(Vertex));
+    m_program.setAttributeBuffer(PROGRAM_COLOR_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, color), 4, sizeof(Vertex));
+    m_vertexBuffer.release();
+
+    m_vao.release();
+
+    m_program.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_program.disableAttributeArray(PROGRAM_COLOR_ATTRIBUTE);
+}
+
+void PointBatch::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+{
+    Q_UNUSED(model)
+    fill(view, false);
+    if (m_vertices.isEmpty())
+        return;
+
+    RenderState::State drawState;
+    drawState.blend = true;
+    draw(m_program, drawState, projection);
+}
+
+void PointBatch::renderSolidColor(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+{
+    Q_UNUSED(model)
+    fill(view, true);
+    if (m_vertices.isEmpty())
+        return;
+
+    draw(m_programColor, RenderState::State(), projection);
+}
+
+void PointBatch::fill(const Eigen::Affine3d &view, bool pickColors)
+{
+    m_vertices.resize(m_instances.size());
+    for (int i = 0; i < m_instances.size(); ++i) {
+        const Instance &instance = m_instances.at(i);
+        const Point &point = m_points.at(instance.point);
+        const QVector3D &color = pickColors ? point.pickColor : point.color;
+        Eigen::Vector3d eye = view*instance.position;
+        Vertex &vertex = m_vertices[i];
+        vertex.position[0] = eye.x();
+        vertex.position[1] = eye.y();
+        vertex.position[2] = eye.z();
+        vertex.color[0] = color.x();
+        vertex.color[1] = color.y();
+        vertex.color[2] = color.z();
+        vertex.color[3] = pickColors ? 1.0 : instance.alpha;
+    }
+    m_instances.clear();
+}
+
+void PointBatch::draw(QOpenGLShaderProgram &program, const RenderState::State &drawState, const Eigen::Affine3d &projection)
+{
+    // Orphan and refill, the driver does not have to wait for the previous frame
+    m_vertexBuffer.bind();
+    m_vertexBuffer.allocate(m_vertices.constData(), m_vertices.size() * sizeof(Vertex));
+    m_vertexBuffer.release();
+
+    RenderState *state = RenderState::instance();
+    state->useProgram(program);
+    setUniformMatrix(program.uniformLocation("projectionMatrix"), projection);
+    program.setUniformValue("pointSize", PointSize);
+    program.setUniformValue("logZbufferC", m_logZbufferC);
+    program.setUniformValue("C", m_C);
+
+    state->apply(drawState);
+    m_vao.bind();
+    glDrawArrays(GL_POINTS, 0, m_vertices.size());
+    m_vao.release();
+}
@@ -0,0 +1,56 @@
+#ifndef POINTBATCH_H
+#define POINTBATCH_H
+
+#include "pickable.h"
+#include "renderstate.h"
+
+#include <QOpenGLBuffer>
+
+// The bodies too small to be drawn as spheres, as point sprites from one
+// streaming vertex buffer. Points are queued with add() during a pass, then
+// drawn in a single call by render() or renderSolidColor(), which empty the queue.
+class PointBatch : public Pickable
+{
+public:
+    PointBatch(QObject *parent = 0);
+    ~PointBatch();
+    // Returns the point id
+    int addPoint(const QVector3D &color, int pickId);
+    void add(int point, const Eigen::Vector3d &position, float alpha = 1.0);
+
+    void createVAO();
+    // model is ignored, positions are in world coordinates
+    void render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+    void renderSolidColor(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+    static float pointSize() {return PointSize;}
+    static void setPointSize(float pointSize) {PointSize = pointSize;}
+
+private:
+    struct Vertex {
+        GLfloat position[3]; // Eye coordinates
+        GLfloat color[4];
+    };
+    struct Point {
+        QVector3D color;
+        QVector3D pickColor;
+    };
+    struct Instance {
+        int point;
+        Eigen::Vector3d position;
+        float alpha;
+    };
+
+    // Camera relative in double precision, then single for the upload
+    void fill(const Eigen::Affine3d &view, bool pickColors);
+    void draw(QOpenGLShaderProgram &program, const RenderState::State &drawState, const Eigen::Affine3d &projection);
+
+    static float PointSize;
+
+    QVector<Point> m_points;
+    QVector<Instance> m_instances;
+    QVector<Vertex> m_vertices;
+
+    QOpenGLBuffer m_vertexBuffer;
+};
+
+#endif // POINTBATCH_H
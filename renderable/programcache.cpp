@@ -0,0 +1,167 @@
+#include "programcache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QOpenGLContext>
+#include <QStandardPaths>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// Bump when the file layout or the attribute bindings in Renderable change
+static const quint32 CacheMagic = 0x53535047; // "SSPG"
+static const quint32 CacheVersion = 4;
+
+ProgramCache *ProgramCache::instance()
+{
+    static ProgramCache *cache = 0;
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!cache || (cache->m_context != context)) {
+        delete cache;
+        cache = new ProgramCache(context);
+    }
+    return cache;
+}
+
+ProgramCache::ProgramCache(QOpenGLContext *context)
+    : m_context(context)
+    , m_getProgramBinary(0)
+    , m_programBinary(0)
+    , m_programParameteri(0)
+    , m_supported(false)
+{
+    initializeOpenGLFunctions();
+
+    // Core in GL 4.1 and ES 3.0, extensions before that
+    if (context->format().renderableType() == QSurfaceFormat::OpenGLES) {
+        if (context->format().majorVersion() >= 3) {
+            m_getProgramBinary = (GetProgramBinary)context->getProcAddress("glGetProgramBinary");
+            m_programBinary = (ProgramBinary)context->getProcAddress("glProgramBinary");
+        } else if (context->hasExtension("GL_OES_get_program_binary")) {
+            m_getProgramBinary = (GetProgramBinary)context->getProcAddress("glGetProgramBinaryOES");
+            m_programBinary = (ProgramBinary)context->getProcAddress("glProgramBinaryOES");
+        }
+    } else if ( (context->format().version() >= qMakePair(4, 1))
+              ||(context->hasExtension("GL_ARB_get_program_binary")) ) {
+        m_getProgramBinary = (GetProgramBinary)context->getProcAddress("glGetProgramBinary");
+        m_programBinary = (ProgramBinary)context->getProcAddress("glProgramBinary");
+        m_programParameteri = (ProgramParameteri)context->getProcAddress("glProgramParameteri");
+    }
+    if (m_getProgramBinary && m_programBinary) {
+        // Some drivers expose the entry points without any binary format
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        m_supported = (formats > 0);
+    }
+
+    // A driver update invalidates the binaries
+    m_driver = QByteArray((const char*)glGetString(GL_VENDOR))
+             + QByteArray((const char*)glGetString(GL_RENDERER))
+             + QByteArray((const char*)glGetString(GL_VERSION));
+    m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)+"/shaders";
+    if (m_supported)
+        QDir().mkpath(m_cacheDir);
+}
+
+bool ProgramCache::link(QOpenGLShaderProgram &program, const QByteArray &vertexSource, const QByteArray &fragmentSource)
+{
+    QByteArray key;
+    if (m_supported) {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(m_driver);
+        hash.addData(vertexSource);
+        hash.addData("\0", 1);
+        hash.addData(fragmentSource);
+        key = hash.result();
+
+        // Most programs are shared by several renderables, the others come from the disk
+        QHash<QByteArray, Binary>::const_iterator it = m_binaries.constFind(key);
+        if (it != m_binaries.constEnd()) {
+            if (load(program, it.value()))
+                return true;
+        } else {
+            Binary binary;
+            if (readBinary(fileName(key), binary)) {
+                if (load(program, binary)) {
+                    m_binaries.insert(key, binary);
+                    return true;
+                }
+                QFile::remove(fileName(key));
+            }
+        }
+    }
+
+    program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource);
+    program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource);
+    if (m_supported && m_programParameteri)
+        m_programParameteri(program.programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    if (!program.link())
+        return false;
+    if (m_supported)
+        store(program, key);
+    return true;
+}
+
+bool ProgramCache::load(QOpenGLShaderProgram &program, const Binary &binary)
+{
+    m_programBinary(program.programId(), binary.format, binary.data.constData(), binary.data.size());
+    GLint status = 0;
+    glGetProgramiv(program.programId(), GL_LINK_STATUS, &status);
+    if (!status)
+        return false;
+    // Without shaders, QOpenGLShaderProgram only checks the link status
+    return program.link();
+}
+
+void ProgramCache::store(QOpenGLShaderProgram &program, const QByteArray &key)
+{
+    GLint length = 0;
+    glGetProgramiv(program.programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    Binary binary;
+    binary.data.resize(length);
+    m_getProgramBinary(program.programId(), length, &length, &binary.format, binary.data.data());
+    binary.data.resize(length);
+    m_binaries.insert(key, binary);
+    writeBinary(fileName(key), binary);
+}
+
+bool ProgramCache::readBinary(const QString &fileName, Binary &binary) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream stream(&file);
+    quint32 magic, version, format;
+    stream >> magic >> version >> format >> binary.data;
+    binary.format = format;
+    return (stream.status() == QDataStream::Ok)
+        && (magic == CacheMagic) && (version == CacheVersion);
+}
+
+void ProgramCache::writeBinary(const QString &fileName, const Binary &binary) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning()<<fileName<<"Unable to write program binary";
+        return;
+    }
+    QDataStream stream(&file);
+    stream << CacheMagic << CacheVersion << (quint32)binary.format << binary.data;
+}
+
+QString ProgramCache::fileName(const QByteArray &key) const
+{
+    return m_cacheDir+"/"+key.toHex()+".bin";
+}
@@ -0,0 +1,47 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QHash>
+
+// Keeps linked program binaries in memory and in the cache directory,
+// keyed by the sources and the driver. Programs are compiled from source
+// when binaries are unsupported or the stored one is rejected.
+class ProgramCache : protected QOpenGLFunctions
+{
+public:
+    // The cache of the current context
+    static ProgramCache *instance();
+
+    // Attributes must be bound before, they are part of the binary
+    bool link(QOpenGLShaderProgram &program, const QByteArray &vertexSource, const QByteArray &fragmentSource);
+
+private:
+    typedef void (QOPENGLF_APIENTRYP GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+    typedef void (QOPENGLF_APIENTRYP ProgramBinary)(GLuint program, GLenum binaryFormat, const void *binary, GLint length);
+    typedef void (QOPENGLF_APIENTRYP ProgramParameteri)(GLuint program, GLenum pname, GLint value);
+
+    struct Binary {
+        GLenum format;
+        QByteArray data;
+    };
+
+    ProgramCache(QOpenGLContext *context);
+    bool load(QOpenGLShaderProgram &program, const Binary &binary);
+    void store(QOpenGLShaderProgram &program, const QByteArray &key);
+    bool readBinary(const QString &fileName, Binary &binary) const;
+    void writeBinary(const QString &fileName, const Binary &binary) const;
+    QString fileName(const QByteArray &key) const;
+
+    QOpenGLContext *m_context;
+    GetProgramBinary m_getProgramBinary;
+    ProgramBinary m_programBinary;
+    ProgramParameteri m_programParameteri;
+    bool m_supported;
+    QByteArray m_driver;
+    QString m_cacheDir;
+    QHash<QByteArray, Binary> m_binaries;
+};
+
+#endif // PROGRAMCACHE_H
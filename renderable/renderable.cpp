@@ -1,5 +1,6 @@
 #include "renderable.h"
 #include "path.h"
+#include "programcache.h"
 
 #include <QOpenGLContext>
 #include <QFile>
@@ -39,13 +40,14 @@ Renderable::~Renderable()
 void Renderable::setCustomShader(const QString &name)
 {
     m_program.removeAllShaders();
-    setShaders(m_program, name);
+    setShaders(m_program, name+".vert", name+".frag", m_programDefines);
     checkProgram(m_program);
 
     m_program.bind();
     // Textures
     m_program.setUniformValue("texture0", 0);
     m_program.setUniformValue("texture1", 1);
+    m_program.setUniformValue("texture2", 2);
 
     // Light settings
     m_program.setUniformValue("light.Ld", QVector4D(1.0, 1.0, 1.0, 1.0));
@@ -60,26 +62,65 @@ void Renderable::cleanup()
 
 void Renderable::setShaders(QOpenGLShaderProgram &program, const QString &shaderName)
 {
-    setShader(program, QOpenGLShader::Vertex, shaderName+".vert");
-    setShader(program, QOpenGLShader::Fragment, shaderName+".frag");
-    program.link();
+    setShaders(program, shaderName+".vert", shaderName+".frag");
 }
 
-void Renderable::setShader(QOpenGLShaderProgram &program, QOpenGLShader::ShaderType type, const QString &fileName)
+void Renderable::setShaders(QOpenGLShaderProgram &program, const QString &vertexShader, const QString &fragmentShader,
+                            const QByteArray &defines)
+{
+    // Every renderable uses the same locations, binding them all before linking
+    // makes them part of the cached program binaries.
+    program.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
+    program.bindAttributeLocation("normal", PROGRAM_NORMAL_ATTRIBUTE);
+    program.bindAttributeLocation("color", PROGRAM_COLOR_ATTRIBUTE);
+    program.bindAttributeLocation("texCoord", PROGRAM_TEXTURE_ATTRIBUTE);
+    program.bindAttributeLocation("vertexHigh", PROGRAM_VERTEX_HIGH_ATTRIBUTE);
+    program.bindAttributeLocation("vertexLow", PROGRAM_VERTEX_LOW_ATTRIBUTE);
+    program.bindAttributeLocation("offset", PROGRAM_OFFSET_ATTRIBUTE);
+    program.bindAttributeLocation("orbitSample", PROGRAM_ORBIT_SAMPLE_ATTRIBUTE);
+    program.bindAttributeLocation("keplerElements", PROGRAM_KEPLER_ELEMENTS_ATTRIBUTE);
+    program.bindAttributeLocation("majorAxis", PROGRAM_MAJOR_AXIS_ATTRIBUTE);
+    program.bindAttributeLocation("minorAxis", PROGRAM_MINOR_AXIS_ATTRIBUTE);
+    program.bindAttributeLocation("trailSlot", PROGRAM_TRAIL_SLOT_ATTRIBUTE);
+    ProgramCache::instance()->link(program, shaderSource(vertexShader, defines), shaderSource(fragmentShader, defines));
+}
+
+QByteArray Renderable::shaderSource(const QString &fileName, const QByteArray &defines) const
 {
     QString fullPath = resPath()+shadersDir()+fileName;
     QFile file(fullPath);
     if (!file.open(QFile::ReadOnly)) {
         qWarning() << "Renderable: Unable to open file" << fullPath;
-        return;
+        return QByteArray();
     }
     QByteArray contents = file.readAll();
+    // GLSL has no #include, a line starting with one is replaced by the shared
+    // source, one level deep
+    const QByteArray include = "\n#include \"";
+    contents.prepend('\n');
+    int begin = contents.indexOf(include);
+    while (begin >= 0) {
+        int nameBegin = begin+include.size();
+        int end = contents.indexOf('"', nameBegin);
+        if (end < 0)
+            break;
+        QString sharedPath = resPath()+shadersDir()+contents.mid(nameBegin, end-nameBegin);
+        QFile shared(sharedPath);
+        if (!shared.open(QFile::ReadOnly)) {
+            qWarning() << "Renderable: Unable to open file" << sharedPath;
+            return QByteArray();
+        }
+        QByteArray sharedContents = shared.readAll();
+        contents.replace(begin+1, end-begin, sharedContents);
+        begin = contents.indexOf(include, begin+1+sharedContents.size());
+    }
+    contents.prepend(defines);
 #ifndef Q_OS_ANDROID
     contents.prepend("#version 120\n");
 #else
     contents.prepend("#version 100\n");
 #endif
-    program.addShaderFromSourceCode(type, contents);
+    return contents;
 }
 
 void Renderable::checkProgram(const QOpenGLShaderProgram &program) const
@@ -17,7 +17,15 @@ public:
            PROGRAM_COLOR_ATTRIBUTE,
            PROGRAM_TEXTURE_ATTRIBUTE,
            PROGRAM_VERTEX_HIGH_ATTRIBUTE,
-           PROGRAM_VERTEX_LOW_ATTRIBUTE };
+           PROGRAM_VERTEX_LOW_ATTRIBUTE,
+           PROGRAM_OFFSET_ATTRIBUTE,
+           PROGRAM_ORBIT_SAMPLE_ATTRIBUTE,
+           // ES2 only guarantees 8 attributes, KeplerBatch and TrailBatch
+           // take the locations of the ones they do not use
+           PROGRAM_KEPLER_ELEMENTS_ATTRIBUTE = PROGRAM_VERTEX_ATTRIBUTE,
+           PROGRAM_MAJOR_AXIS_ATTRIBUTE = PROGRAM_VERTEX_HIGH_ATTRIBUTE,
+           PROGRAM_MINOR_AXIS_ATTRIBUTE = PROGRAM_VERTEX_LOW_ATTRIBUTE,
+           PROGRAM_TRAIL_SLOT_ATTRIBUTE = PROGRAM_ORBIT_SAMPLE_ATTRIBUTE };
 
     Renderable(QObject *parent = 0);
     virtual ~Renderable();
@@ -27,13 +35,18 @@ public:
 //    virtual void beginRendering() = 0;
 //    virtual void endRendering() = 0;
     virtual void render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection) = 0;
+    GLuint programId() const {return m_program.programId();}
 
 protected slots:
     void cleanup();
 
 protected:
     void setShaders(QOpenGLShaderProgram &program, const QString &shaderName);
-    void setShader(QOpenGLShaderProgram &program, QOpenGLShader::ShaderType type, const QString &fileName);
+    void setShaders(QOpenGLShaderProgram &program, const QString &vertexShader, const QString &fragmentShader,
+                    const QByteArray &defines = QByteArray());
+    // defines are inserted right after the #version line. A line
+    // #include "file" is replaced by the contents of that shader file.
+    QByteArray shaderSource(const QString &fileName, const QByteArray &defines = QByteArray()) const;
     void checkProgram(const QOpenGLShaderProgram &program) const;
 
     void setUniformMatrix(int location, const Eigen::Affine3d &transformation);
@@ -47,6 +60,8 @@ protected:
     float m_alpha;
     int m_dataSize;
     QOpenGLShaderProgram m_program;
+    // Those of m_program, kept for setCustomShader()
+    QByteArray m_programDefines;
     bool m_useVao;
     QOpenGLVertexArrayObject m_vao;
 };
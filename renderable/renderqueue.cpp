@@ -0,0 +1,101 @@
+#include "renderqueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Orders the packet indices by key, packets with equal keys keep their order
+struct KeyLess {
+    KeyLess(const QVector<quint64> &keys) : keys(keys) {}
+    bool operator()(int a, int b) const {return keys.at(a) < keys.at(b);}
+    const QVector<quint64> &keys;
+};
+
+}
+
+RenderQueue::RenderQueue()
+    : m_view(Eigen::Affine3d::Identity())
+    , m_projection(Eigen::Affine3d::Identity())
+    , m_order(StateOrder)
+{
+}
+
+void RenderQueue::begin(const Eigen::Affine3d &view, const Eigen::Affine3d &projection, Order order)
+{
+    m_view = view;
+    m_projection = projection;
+    m_order = order;
+    m_packets.clear();
+}
+
+void RenderQueue::add(Renderable *renderable, const Eigen::Affine3d &model, GLuint texture0, GLuint texture1, GLuint texture2)
+{
+    Packet packet;
+    packet.renderable = renderable;
+    packet.solidColor = false;
+    packet.textures[0] = texture0;
+    packet.textures[1] = texture1;
+    packet.textures[2] = texture2;
+    add(packet, renderable->programId(), model);
+}
+
+void RenderQueue::addSolidColor(Pickable *pickable, const Eigen::Affine3d &model, const QVector3D &color)
+{
+    Packet packet;
+    packet.renderable = pickable;
+    packet.solidColor = true;
+    packet.color = color;
+    packet.textures[0] = 0;
+    packet.textures[1] = 0;
+    packet.textures[2] = 0;
+    add(packet, pickable->solidColorProgramId(), model);
+}
+
+void RenderQueue::add(Packet &packet, GLuint program, const Eigen::Affine3d &model)
+{
+    packet.linear = model.linear();
+    packet.translation = model.translation();
+
+    // Distance to the camera, positive floats order like their bits
+    float depth = (m_view*model).translation().norm();
+    quint32 depthBits;
+    memcpy(&depthBits, &depth, sizeof(depthBits));
+    const quint64 state = ((quint64)(program & 0xFFFF) << 16) | (packet.textures[0] & 0xFFFF);
+    if (m_order == StateOrder)
+        packet.key = (state << 32) | depthBits;
+    else
+        packet.key = ((quint64)~depthBits << 32) | state;
+    m_packets.append(packet);
+}
+
+void RenderQueue::submit()
+{
+    m_keys.resize(m_packets.size());
+    m_sorted.resize(m_packets.size());
+    for (int i = 0; i < m_packets.size(); ++i) {
+        m_keys[i] = m_packets.at(i).key;
+        m_sorted[i] = i;
+    }
+    std::stable_sort(m_sorted.begin(), m_sorted.end(), KeyLess(m_keys));
+
+    RenderState *state = RenderState::instance();
+    foreach (int index, m_sorted) {
+        const Packet &packet = m_packets.at(index);
+        for (int unit = 2; unit >= 0; --unit) {
+            if (packet.textures[unit])
+                state->bindTexture(unit, packet.textures[unit]);
+        }
+        Eigen::Affine3d model(Eigen::Affine3d::Identity());
+        model.linear() = packet.linear;
+        model.translation() = packet.translation;
+        if (packet.solidColor) {
+            Pickable *pickable = static_cast<Pickable*>(packet.renderable);
+            pickable->setColor(packet.color);
+            pickable->renderSolidColor(model, m_view, m_projection);
+        } else {
+            packet.renderable->render(model, m_view, m_projection);
+        }
+    }
+    m_packets.clear();
+}
@@ -0,0 +1,47 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include "pickable.h"
+#include "renderstate.h"
+
+#include <QVector>
+
+// Draw packets collected during a pass, sorted then submitted through the
+// RenderState cache. Opaque passes are sorted by program and textures, then
+// front to back. Blended passes are sorted back to front.
+class RenderQueue
+{
+public:
+    enum Order { StateOrder, BackToFront };
+
+    RenderQueue();
+    void begin(const Eigen::Affine3d &view, const Eigen::Affine3d &projection, Order order);
+    // Textures are bound to units 0, 1 and 2 when not 0
+    void add(Renderable *renderable, const Eigen::Affine3d &model,
+             GLuint texture0 = 0, GLuint texture1 = 0, GLuint texture2 = 0);
+    void addSolidColor(Pickable *pickable, const Eigen::Affine3d &model, const QVector3D &color);
+    // Draws and empties the queue
+    void submit();
+
+private:
+    struct Packet {
+        Renderable *renderable;
+        bool solidColor;
+        QVector3D color;
+        GLuint textures[3];
+        // Eigen types that need no alignment
+        Eigen::Matrix3d linear;
+        Eigen::Vector3d translation;
+        quint64 key;
+    };
+    void add(Packet &packet, GLuint program, const Eigen::Affine3d &model);
+
+    Eigen::Affine3d m_view;
+    Eigen::Affine3d m_projection;
+    Order m_order;
+    QVector<Packet> m_packets;
+    QVector<quint64> m_keys;
+    QVector<int> m_sorted;
+};
+
+#endif // RENDERQUEUE_H
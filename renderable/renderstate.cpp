@@ -0,0 +1,117 @@
+#include "renderstate.h"
+
+#include <QOpenGLContext>
+
+RenderState *RenderState::instance()
+{
+    static RenderState *state = 0;
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!state || (state->m_context != context)) {
+        delete state;
+        state = new RenderState(context);
+    }
+    return state;
+}
+
+RenderState::RenderState(QOpenGLContext *context)
+    : m_context(context)
+{
+    initializeOpenGLFunctions();
+    invalidate();
+}
+
+void RenderState::invalidate()
+{
+    m_blend = -1;
+    m_blendSource = -1;
+    m_blendDestination = -1;
+    m_cull = -1;
+    m_cullFace = -1;
+    m_depthWrite = -1;
+    m_program = -1;
+    for (int i = 0; i < TextureUnits; ++i)
+        m_textures[i] = -1;
+    m_activeUnit = -1;
+}
+
+void RenderState::reset()
+{
+    const State defaults;
+    apply(defaults);
+    // apply() only sets these along with their capability
+    if ( (m_blendSource != (int)defaults.blendSource)
+       ||(m_blendDestination != (int)defaults.blendDestination) ) {
+        glBlendFunc(defaults.blendSource, defaults.blendDestination);
+        m_blendSource = defaults.blendSource;
+        m_blendDestination = defaults.blendDestination;
+    }
+    if (m_cullFace != (int)defaults.cullFace) {
+        glCullFace(defaults.cullFace);
+        m_cullFace = defaults.cullFace;
+    }
+    if (m_program != 0) {
+        glUseProgram(0);
+        m_program = 0;
+    }
+    if (m_activeUnit != 0) {
+        glActiveTexture(GL_TEXTURE0);
+        m_activeUnit = 0;
+    }
+}
+
+void RenderState::apply(const State &state)
+{
+    setEnabled(GL_BLEND, m_blend, state.blend);
+    if (state.blend
+        && ( (m_blendSource != (int)state.blendSource)
+           ||(m_blendDestination != (int)state.blendDestination) ) ) {
+        glBlendFunc(state.blendSource, state.blendDestination);
+        m_blendSource = state.blendSource;
+        m_blendDestination = state.blendDestination;
+    }
+    setEnabled(GL_CULL_FACE, m_cull, state.cull);
+    if (state.cull && (m_cullFace != (int)state.cullFace)) {
+        glCullFace(state.cullFace);
+        m_cullFace = state.cullFace;
+    }
+    if (m_depthWrite != (int)state.depthWrite) {
+        glDepthMask(state.depthWrite ? GL_TRUE : GL_FALSE);
+        m_depthWrite = state.depthWrite;
+    }
+}
+
+void RenderState::useProgram(QOpenGLShaderProgram &program)
+{
+    if (m_program != (int)program.programId()) {
+        program.bind();
+        m_program = program.programId();
+    }
+}
+
+void RenderState::bindTexture(int unit, GLuint texture)
+{
+    Q_ASSERT((unit >= 0) && (unit < TextureUnits));
+    if (m_textures[unit] != (int)texture) {
+        if (m_activeUnit != unit) {
+            glActiveTexture(GL_TEXTURE0+unit);
+            m_activeUnit = unit;
+        }
+        glBindTexture(GL_TEXTURE_2D, texture);
+        m_textures[unit] = texture;
+    }
+    if (m_activeUnit != 0) {
+        glActiveTexture(GL_TEXTURE0);
+        m_activeUnit = 0;
+    }
+}
+
+void RenderState::setEnabled(GLenum capability, int &current, bool enabled)
+{
+    if (current == (int)enabled)
+        return;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+    current = enabled;
+}
@@ -0,0 +1,61 @@
+#ifndef RENDERSTATE_H
+#define RENDERSTATE_H
+
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+
+// Shadow copy of the GL state set by the scene passes, so that redundant
+// calls are skipped. Draw code states everything it needs and restores nothing.
+// Code that changes the state behind the cache's back must be followed by
+// invalidate(), and reset() leaves the defaults for such code.
+class RenderState : protected QOpenGLFunctions
+{
+public:
+    // Fixed function state of a draw. The defaults are the GL ones, except for
+    // the blend function: alpha blending, what the blended draws use.
+    struct State {
+        State()
+            : blend(false)
+            , blendSource(GL_SRC_ALPHA)
+            , blendDestination(GL_ONE_MINUS_SRC_ALPHA)
+            , cull(false)
+            , cullFace(GL_BACK)
+            , depthWrite(true) {}
+        bool blend;
+        GLenum blendSource;
+        GLenum blendDestination;
+        bool cull;
+        GLenum cullFace;
+        bool depthWrite;
+    };
+    static const int TextureUnits = 4;
+
+    // The cache of the current context
+    static RenderState *instance();
+
+    void invalidate();
+    void reset();
+
+    void apply(const State &state);
+    void useProgram(QOpenGLShaderProgram &program);
+    // Texture unit 0 is left active
+    void bindTexture(int unit, GLuint texture);
+
+private:
+    RenderState(QOpenGLContext *context);
+    void setEnabled(GLenum capability, int &current, bool enabled);
+
+    QOpenGLContext *m_context;
+    // -1 when unknown
+    int m_blend;
+    int m_blendSource;
+    int m_blendDestination;
+    int m_cull;
+    int m_cullFace;
+    int m_depthWrite;
+    int m_program;
+    int m_textures[TextureUnits];
+    int m_activeUnit;
+};
+
+#endif // RENDERSTATE_H
@@ -0,0 +1,68 @@
+#include "rendertargetpool.h"
+
+#include <QDebug>
+
+RenderTargetPool::RenderTargetPool()
+    : m_frame(0)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    clear();
+}
+
+QOpenGLFramebufferObject *RenderTargetPool::acquire(const QSize &size, bool depth, int samples)
+{
+    for (int i = 0; i < m_targets.size(); ++i) {
+        Target &target = m_targets[i];
+        if ( !target.inUse && (target.fbo->size() == size)
+           &&(target.depth == depth) && (target.samples == samples) ) {
+            target.inUse = true;
+            target.lastUsed = m_frame;
+            return target.fbo;
+        }
+    }
+    QOpenGLFramebufferObjectFormat format;
+    if (depth)
+        format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+    format.setSamples(samples);
+    Target target;
+    target.fbo = new QOpenGLFramebufferObject(size, format);
+    target.depth = depth;
+    target.samples = samples;
+    target.inUse = true;
+    target.lastUsed = m_frame;
+    m_targets.append(target);
+    return target.fbo;
+}
+
+void RenderTargetPool::release(QOpenGLFramebufferObject *fbo)
+{
+    for (int i = 0; i < m_targets.size(); ++i) {
+        if (m_targets.at(i).fbo == fbo) {
+            m_targets[i].inUse = false;
+            return;
+        }
+    }
+    qWarning()<<"RenderTargetPool: released a target it does not own";
+}
+
+void RenderTargetPool::endFrame()
+{
+    ++m_frame;
+    for (int i = m_targets.size()-1; i >= 0; --i) {
+        const Target &target = m_targets.at(i);
+        if (!target.inUse && (m_frame-target.lastUsed > MaxIdleFrames)) {
+            delete target.fbo;
+            m_targets.removeAt(i);
+        }
+    }
+}
+
+void RenderTargetPool::clear()
+{
+    for (int i = 0; i < m_targets.size(); ++i)
+        delete m_targets.at(i).fbo;
+    m_targets.clear();
+}
@@ -0,0 +1,36 @@
+#ifndef RENDERTARGETPOOL_H
+#define RENDERTARGETPOOL_H
+
+#include <QList>
+#include <QOpenGLFramebufferObject>
+
+// Framebuffer objects shared by the passes of a frame, allocated on demand.
+// A target released by one pass is handed to the next pass asking for the
+// same size and format, and targets left unused for a few frames are deleted,
+// so only what the current pipeline uses stays allocated.
+class RenderTargetPool
+{
+public:
+    RenderTargetPool();
+    ~RenderTargetPool();
+    QOpenGLFramebufferObject *acquire(const QSize &size, bool depth = false, int samples = 0);
+    void release(QOpenGLFramebufferObject *target);
+    // Deletes the free targets unused for MaxIdleFrames
+    void endFrame();
+    void clear();
+
+private:
+    struct Target {
+        QOpenGLFramebufferObject *fbo;
+        bool depth;
+        int samples;
+        bool inUse;
+        int lastUsed;
+    };
+    static const int MaxIdleFrames = 3;
+
+    QList<Target> m_targets;
+    int m_frame;
+};
+
+#endif // RENDERTARGETPOOL_H
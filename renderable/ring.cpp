@@ -1,9 +1,12 @@
 #include "ring.h"
+#include "renderstate.h"
 
 #include <cmath>
 
 Ring::Ring(float innerRadius, float outerRadius, QObject *parent)
     : Pickable(parent)
+    , m_lightRadius(1.0)
+    , m_planetRadius(0.0)
     , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
     , m_texcoordBuffer(QOpenGLBuffer::VertexBuffer)
 {
@@ -25,9 +28,6 @@ Ring::Ring(float innerRadius, float outerRadius, QObject *parent)
         m_texCoords.append(0.0);
         m_texCoords.append(1.0);
     }
-    m_program.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-    m_program.bindAttributeLocation("texCoord", PROGRAM_TEXTURE_ATTRIBUTE);
-    m_programColor.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
 
     m_dataSize = m_vertices.size();
     // Ring vertex buffer init
@@ -79,27 +79,32 @@ void Ring::createVAO()
 
 void Ring::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
 {
-    m_program.bind();
+    RenderState *state = RenderState::instance();
+    state->useProgram(m_program);
 
     setUniformMatrix(m_program.uniformLocation("modelViewMatrix"), view*model);
     setUniformMatrix(m_program.uniformLocation("projectionMatrix"), projection);
     setUniformVector(m_program.uniformLocation("light.Position"), view*Eigen::Vector4d(0.0, 0.0, 0.0, 1.0));
+    m_program.setUniformValue("lightRadius", m_lightRadius);
+    // The planet casts its shadow on the ring
+    Eigen::Vector3d planetCenter = (view*model).translation();
+    m_program.setUniformValue("planet", QVector4D(planetCenter.x(), planetCenter.y(), planetCenter.z(), m_planetRadius));
     m_program.setUniformValue("logZbufferC", m_logZbufferC);
     m_program.setUniformValue("C", m_C);
 
+    RenderState::State drawState;
+    drawState.blend = true;
+    state->apply(drawState);
     m_vao.bind();
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glEnable(GL_BLEND);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, m_dataSize);
-    glDisable(GL_BLEND);
     m_vao.release();
-
-    m_program.release();
 }
 
 void Ring::renderSolidColor(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
 {
-    m_programColor.bind();
+    RenderState *state = RenderState::instance();
+    state->useProgram(m_programColor);
 
     m_programColor.setUniformValue("color", m_color);
     setUniformMatrix(m_programColor.uniformLocation("modelViewMatrix"), view*model);
@@ -107,9 +112,8 @@ void Ring::renderSolidColor(const Eigen::Affine3d &model, const Eigen::Affine3d
     m_programColor.setUniformValue("logZbufferC", m_logZbufferC);
     m_programColor.setUniformValue("C", m_C);
 
+    state->apply(RenderState::State());
     m_vao.bind();
     glDrawArrays(GL_TRIANGLE_STRIP, 0, m_dataSize);
     m_vao.release();
-
-    m_programColor.release();
 }
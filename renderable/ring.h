@@ -10,11 +10,16 @@ class Ring : public Pickable
 public:
     Ring(float innerRadius, float outerRadius, QObject *parent = 0);
     ~Ring();
+    void setLightRadius(float radius) {m_lightRadius = radius;}
+    void setPlanetRadius(float radius) {m_planetRadius = radius;}
     void createVAO();
     void render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
     void renderSolidColor(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
 
 private:
+    float m_lightRadius;
+    float m_planetRadius;
+
     QVector<QVector3D> m_vertices;
     QVector<float> m_texCoords;
 
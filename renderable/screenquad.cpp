@@ -1,5 +1,9 @@
 #include "screenquad.h"
 
+// The dual filter chain is normalized, it spreads the light sources over a
+// much wider footprint than their disc: this brings the halo back up to them
+static const float GlowIntensity = 4.0;
+
 ScreenQuad::ScreenQuad(QObject *parent)
     : Renderable(parent)
     , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
@@ -8,17 +12,23 @@ ScreenQuad::ScreenQuad(QObject *parent)
     setShaders(m_program, "simpleTexture");
     checkProgram(m_program);
 
-    setShaders(m_programCombined, "combineTexture");
-    checkProgram(m_programCombined);
+    setShaders(m_programGlow, "glow");
+    checkProgram(m_programGlow);
+
+    setShaders(m_programDownsample, "blur.vert", "blurDown.frag");
+    checkProgram(m_programDownsample);
 
-    setShaders(m_programBlurred, "blur");
-    checkProgram(m_programBlurred);
+    setShaders(m_programUpsample, "blur.vert", "blurUp.frag");
+    checkProgram(m_programUpsample);
 
 //    setShaders(m_programFXAA, "fxaa");
     setShaders(m_programFXAA, "FXAA");
 //    setShaders(m_programFXAA, "FXAA3.11");
     checkProgram(m_programFXAA);
 
+    setShaders(m_programTAA, "taa");
+    checkProgram(m_programTAA);
+
     m_vertices.append(QVector3D(-1.0, 1.0, 0.0));
     m_texCoords.append(QVector2D(0.0, 1.0));
     m_vertices.append(QVector3D(-1.0, -1.0, 0.0));
@@ -30,26 +40,24 @@ ScreenQuad::ScreenQuad(QObject *parent)
     m_vertices.append(QVector3D(-1.0, -1.0, 0.0));
     m_texCoords.append(QVector2D(0.0, 0.0));
 
-    m_program.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-    m_program.bindAttributeLocation("texCoord", PROGRAM_TEXTURE_ATTRIBUTE);
-    m_programCombined.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-    m_programCombined.bindAttributeLocation("texCoord", PROGRAM_TEXTURE_ATTRIBUTE);
-    m_programBlurred.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-    m_programBlurred.bindAttributeLocation("texCoord", PROGRAM_TEXTURE_ATTRIBUTE);
-    m_programFXAA.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-    m_programFXAA.bindAttributeLocation("texCoord", PROGRAM_TEXTURE_ATTRIBUTE);
-
     // Textures
-    m_programCombined.bind();
-    m_programCombined.setUniformValue("texture0", 0);
-    m_programCombined.setUniformValue("texture1", 1);
-    m_programCombined.release();
-    m_programBlurred.bind();
-    m_programBlurred.setUniformValue("texture0", 0);
-    m_programBlurred.release();
+    m_programGlow.bind();
+    m_programGlow.setUniformValue("texture0", 0);
+    m_programGlow.setUniformValue("glowIntensity", GlowIntensity);
+    m_programGlow.release();
+    m_programDownsample.bind();
+    m_programDownsample.setUniformValue("texture0", 0);
+    m_programDownsample.release();
+    m_programUpsample.bind();
+    m_programUpsample.setUniformValue("texture0", 0);
+    m_programUpsample.release();
     m_programFXAA.bind();
     m_programFXAA.setUniformValue("texture0", 0);
     m_programFXAA.release();
+    m_programTAA.bind();
+    m_programTAA.setUniformValue("texture0", 0);
+    m_programTAA.setUniformValue("texture1", 1);
+    m_programTAA.release();
 
     m_dataSize = m_vertices.size();
     // Ring vertex buffer init
@@ -81,37 +89,49 @@ void ScreenQuad::createVAO()
 
     m_program.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
     m_program.enableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
-    m_programCombined.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
-    m_programCombined.enableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
-    m_programBlurred.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
-    m_programBlurred.enableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
+    m_programGlow.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_programGlow.enableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
+    m_programDownsample.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_programDownsample.enableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
+    m_programUpsample.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_programUpsample.enableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
     m_programFXAA.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
     m_programFXAA.enableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
+    m_programTAA.enableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_programTAA.enableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
 
     m_vertexBuffer.bind();
     m_program.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3);
-    m_programCombined.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3);
-    m_programBlurred.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3);
+    m_programGlow.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3);
+    m_programDownsample.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3);
+    m_programUpsample.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3);
     m_programFXAA.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3);
+    m_programTAA.setAttributeBuffer(PROGRAM_VERTEX_ATTRIBUTE, GL_FLOAT, 0, 3);
     m_vertexBuffer.release();
 
     m_texcoordBuffer.bind();
     m_program.setAttributeBuffer(PROGRAM_TEXTURE_ATTRIBUTE, GL_FLOAT, 0, 2);
-    m_programCombined.setAttributeBuffer(PROGRAM_TEXTURE_ATTRIBUTE, GL_FLOAT, 0, 2);
-    m_programBlurred.setAttributeBuffer(PROGRAM_TEXTURE_ATTRIBUTE, GL_FLOAT, 0, 2);
+    m_programGlow.setAttributeBuffer(PROGRAM_TEXTURE_ATTRIBUTE, GL_FLOAT, 0, 2);
+    m_programDownsample.setAttributeBuffer(PROGRAM_TEXTURE_ATTRIBUTE, GL_FLOAT, 0, 2);
+    m_programUpsample.setAttributeBuffer(PROGRAM_TEXTURE_ATTRIBUTE, GL_FLOAT, 0, 2);
     m_programFXAA.setAttributeBuffer(PROGRAM_TEXTURE_ATTRIBUTE, GL_FLOAT, 0, 2);
+    m_programTAA.setAttributeBuffer(PROGRAM_TEXTURE_ATTRIBUTE, GL_FLOAT, 0, 2);
     m_texcoordBuffer.release();
 
     m_vao.release();
 
     m_program.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
     m_program.disableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
-    m_programCombined.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
-    m_programCombined.disableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
-    m_programBlurred.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
-    m_programBlurred.disableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
+    m_programGlow.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_programGlow.disableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
+    m_programDownsample.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_programDownsample.disableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
+    m_programUpsample.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_programUpsample.disableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
     m_programFXAA.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
     m_programFXAA.disableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
+    m_programTAA.disableAttributeArray(PROGRAM_VERTEX_ATTRIBUTE);
+    m_programTAA.disableAttributeArray(PROGRAM_TEXTURE_ATTRIBUTE);
 }
 
 void ScreenQuad::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
@@ -135,36 +155,40 @@ void ScreenQuad::setResolution(int width, int height)
 
 void ScreenQuad::setBlurResolution(int width, int height)
 {
-    m_programBlurred.bind();
-    m_programBlurred.setUniformValue("resolution", QVector2D(width, height));
-    m_programBlurred.release();
+    // Resolution of the texture being filtered
+    m_blurTexelSize = QVector2D(1.0/width, 1.0/height);
 }
 
 void ScreenQuad::renderBlurred(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection, Blur blurType)
 {
-    m_programBlurred.bind();
-    m_programBlurred.setUniformValue("blurType", blurType);
-    setUniformMatrix(m_programBlurred.uniformLocation("modelViewMatrix"), view*model);
-    setUniformMatrix(m_programBlurred.uniformLocation("projectionMatrix"), projection);
+    QOpenGLShaderProgram &program = (blurType == UpsampleBlur) ? m_programUpsample : m_programDownsample;
+    program.bind();
+    program.setUniformValue("texelSize", m_blurTexelSize);
+    setUniformMatrix(program.uniformLocation("modelViewMatrix"), view*model);
+    setUniformMatrix(program.uniformLocation("projectionMatrix"), projection);
+
+    // Taps rely on bilinear filtering to read 4 texels at once
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     m_vao.bind();
     glDrawArrays(GL_TRIANGLE_STRIP, 0, m_dataSize);
     m_vao.release();
 
-    m_programBlurred.release();
+    program.release();
 }
 
-void ScreenQuad::renderCombinedTextures(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+void ScreenQuad::renderGlow(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
 {
-    m_programCombined.bind();
-    setUniformMatrix(m_programCombined.uniformLocation("modelViewMatrix"), view*model);
-    setUniformMatrix(m_programCombined.uniformLocation("projectionMatrix"), projection);
+    m_programGlow.bind();
+    setUniformMatrix(m_programGlow.uniformLocation("modelViewMatrix"), view*model);
+    setUniformMatrix(m_programGlow.uniformLocation("projectionMatrix"), projection);
 
     m_vao.bind();
     glDrawArrays(GL_TRIANGLE_STRIP, 0, m_dataSize);
     m_vao.release();
 
-    m_programCombined.release();
+    m_programGlow.release();
 }
 
 void ScreenQuad::renderFXAA(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
@@ -181,3 +205,18 @@ void ScreenQuad::renderFXAA(const Eigen::Affine3d &model, const Eigen::Affine3d
 
     m_programFXAA.release();
 }
+
+void ScreenQuad::renderTAA(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection, float feedback)
+{
+    m_programTAA.bind();
+    setUniformMatrix(m_programTAA.uniformLocation("modelViewMatrix"), view*model);
+    setUniformMatrix(m_programTAA.uniformLocation("projectionMatrix"), projection);
+    m_programTAA.setUniformValue("resolution", QVector2D(m_width, m_height));
+    m_programTAA.setUniformValue("feedback", feedback);
+
+    m_vao.bind();
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, m_dataSize);
+    m_vao.release();
+
+    m_programTAA.release();
+}
@@ -9,8 +9,8 @@ class ScreenQuad : public Renderable
 {
 public:
     enum Blur { NoBlur,
-                HorizontalBlur,
-                VerticalBlur };
+                DownsampleBlur,
+                UpsampleBlur };
 
     ScreenQuad(QObject *parent = 0);
     ~ScreenQuad();
@@ -19,13 +19,16 @@ public:
     void setResolution(int width, int height);
     void setBlurResolution(int width, int height);
     void renderBlurred(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection, Blur blurType);
-    void renderCombinedTextures(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+    void renderGlow(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
     void renderFXAA(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+    void renderTAA(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection, float feedback);
 
 private:
-    QOpenGLShaderProgram m_programBlurred;
-    QOpenGLShaderProgram m_programCombined;
+    QOpenGLShaderProgram m_programDownsample;
+    QOpenGLShaderProgram m_programUpsample;
+    QOpenGLShaderProgram m_programGlow;
     QOpenGLShaderProgram m_programFXAA;
+    QOpenGLShaderProgram m_programTAA;
 
     QVector<QVector3D> m_vertices;
     QVector<QVector2D> m_texCoords;
@@ -35,6 +38,7 @@ private:
 
     int m_width;
     int m_height;
+    QVector2D m_blurTexelSize;
 };
 
 #endif // SCREENQUAD_H
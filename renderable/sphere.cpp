@@ -1,20 +1,39 @@
 #include "sphere.h"
+#include "renderstate.h"
 
 #include <cmath>
 
 Sphere::Sphere(float radius, float flattening, QObject *parent)
     : Pickable(parent)
+    , m_lightRadius(1.0)
+    , m_hasRing(false)
+    , m_ringInnerRadius(0.0)
+    , m_ringOuterRadius(0.0)
     , m_indexBuffer(QOpenGLBuffer::IndexBuffer)
     , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
     , m_normalBuffer(QOpenGLBuffer::VertexBuffer)
     , m_texcoordBuffer(QOpenGLBuffer::VertexBuffer)
 {
-    setShaders(m_program, "body");
-    checkProgram(m_program);
+    init(createMesh(radius, flattening));
+}
 
-    setShaders(m_programColor, "solidColor");
-    checkProgram(m_programColor);
+Sphere::Sphere(const Mesh &mesh, QObject *parent)
+    : Pickable(parent)
+    , m_lightRadius(1.0)
+    , m_hasRing(false)
+    , m_ringInnerRadius(0.0)
+    , m_ringOuterRadius(0.0)
+    , m_indexBuffer(QOpenGLBuffer::IndexBuffer)
+    , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
+    , m_normalBuffer(QOpenGLBuffer::VertexBuffer)
+    , m_texcoordBuffer(QOpenGLBuffer::VertexBuffer)
+{
+    init(mesh);
+}
 
+Sphere::Mesh Sphere::createMesh(float radius, float flattening)
+{
+    Mesh mesh;
     const int nSub = 80;
     int indices[nSub+1][nSub+1];
     int count = 0;
@@ -26,60 +45,63 @@ Sphere::Sphere(float radius, float flattening, QObject *parent)
             QVector3D v = QVector3D(cos(theta)*sin(phi),
                                     sin(theta)*sin(phi),
                                     cos(phi));
-            m_vertices.append(radius*QVector3D(1.0, 1.0, (1.0-flattening))*v); // Spheroid
-            m_normals.append((QVector3D((1.0-flattening), (1.0-flattening), 1.0)*v).normalized());
+            mesh.vertices.append(radius*QVector3D(1.0, 1.0, (1.0-flattening))*v); // Spheroid
+            mesh.normals.append((QVector3D((1.0-flattening), (1.0-flattening), 1.0)*v).normalized());
             QVector2D uv = QVector2D((float)i/(float)nSub,
                                      1.0-(float)j/(float)nSub);
-            m_texCoords.append(uv);
+            mesh.texCoords.append(uv);
         }
     }
 
     for( int i = 0; i < nSub; ++i ) {
         for( int j = 0; j <= nSub; ++j ) {
-            m_indices.append(indices[(i+1)][j]);
-            m_indices.append(indices[i][j]);
+            mesh.indices.append(indices[(i+1)][j]);
+            mesh.indices.append(indices[i][j]);
         }
     }
+    return mesh;
+}
+
+void Sphere::init(const Mesh &mesh)
+{
+    m_programDefines = "#define MAX_OCCLUDERS "+QByteArray::number(MaxOccluders)+"\n";
+    setShaders(m_program, "body.vert", "body.frag", m_programDefines);
+    checkProgram(m_program);
 
-    m_program.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
-    m_program.bindAttributeLocation("normal", PROGRAM_NORMAL_ATTRIBUTE);
-    m_program.bindAttributeLocation("texCoord", PROGRAM_TEXTURE_ATTRIBUTE);
-    m_programColor.bindAttributeLocation("vertex", PROGRAM_VERTEX_ATTRIBUTE);
+    setShaders(m_programColor, "solidColor");
+    checkProgram(m_programColor);
 
     m_program.bind();
     // Textures
     m_program.setUniformValue("texture0", 0);
     m_program.setUniformValue("texture1", 1);
+    m_program.setUniformValue("texture2", 2);
 
     // Light settings
     m_program.setUniformValue("light.Ld", QVector4D(1.0, 1.0, 1.0, 1.0));
     m_program.release();
 
-    m_dataSize = m_indices.size();
+    m_dataSize = mesh.indices.size();
     // Sphere indices buffer init
     m_indexBuffer.create();
     m_indexBuffer.bind();
-    m_indexBuffer.allocate(m_indices.constData(), m_indices.size() * sizeof(int));
+    m_indexBuffer.allocate(mesh.indices.constData(), mesh.indices.size() * sizeof(int));
     m_indexBuffer.release();
-    m_indices.clear();
     // Sphere vertex buffer init
     m_vertexBuffer.create();
     m_vertexBuffer.bind();
-    m_vertexBuffer.allocate(m_vertices.constData(), m_vertices.size() * sizeof(QVector3D));
+    m_vertexBuffer.allocate(mesh.vertices.constData(), mesh.vertices.size() * sizeof(QVector3D));
     m_vertexBuffer.release();
-    m_vertices.clear();
     // Sphere normal buffer init
     m_normalBuffer.create();
     m_normalBuffer.bind();
-    m_normalBuffer.allocate(m_normals.constData(), m_normals.size() * sizeof(QVector3D));
+    m_normalBuffer.allocate(mesh.normals.constData(), mesh.normals.size() * sizeof(QVector3D));
     m_normalBuffer.release();
-    m_normals.clear();
     // Sphere texCoord buffer init
     m_texcoordBuffer.create();
     m_texcoordBuffer.bind();
-    m_texcoordBuffer.allocate(m_texCoords.constData(), m_texCoords.size() * sizeof(QVector2D));
+    m_texcoordBuffer.allocate(mesh.texCoords.constData(), mesh.texCoords.size() * sizeof(QVector2D));
     m_texcoordBuffer.release();
-    m_texCoords.clear();
 
     createVAO();
 }
@@ -129,28 +151,61 @@ void Sphere::createVAO()
 
 void Sphere::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
 {
-    m_program.bind();
+    RenderState *state = RenderState::instance();
+    state->useProgram(m_program);
 
     setUniformMatrix(m_program.uniformLocation("modelViewMatrix"), view*model);
     setUniformMatrix(m_program.uniformLocation("projectionMatrix"), projection);
     Eigen::Matrix3d normal = (view*model).matrix().topLeftCorner<3,3>().transpose().inverse();
     setUniformMatrix(m_program.uniformLocation("normalMatrix"), normal);
     setUniformVector(m_program.uniformLocation("light.Position"), view*Eigen::Vector4d(0.0, 0.0, 0.0, 1.0));
+    setShadowUniforms(view*model, view);
     m_program.setUniformValue("logZbufferC", m_logZbufferC);
     m_program.setUniformValue("C", m_C);
 
+    RenderState::State drawState;
+    drawState.cull = true;
+    state->apply(drawState);
     m_vao.bind();
-    glEnable(GL_CULL_FACE);
     glDrawElements(GL_TRIANGLE_STRIP, m_dataSize, GL_UNSIGNED_INT, 0);
-    glDisable(GL_CULL_FACE);
     m_vao.release();
+}
 
-    m_program.release();
+void Sphere::setRingShadow(float innerRadius, float outerRadius)
+{
+    m_hasRing = true;
+    m_ringInnerRadius = innerRadius;
+    m_ringOuterRadius = outerRadius;
+}
+
+void Sphere::setShadowUniforms(const Eigen::Affine3d &modelView, const Eigen::Affine3d &view)
+{
+    // Eclipses are computed analytically in the fragment shader against a few spheres
+    // and the ring plane, which is much cheaper than shadow maps on ES2 hardware.
+    m_program.setUniformValue("lightRadius", m_lightRadius);
+
+    const int n = qMin(m_occluders.size(), (int)MaxOccluders);
+    QVector4D occluders[MaxOccluders];
+    for (int i = 0; i < n; ++i) {
+        Eigen::Vector3d center = view*m_occluders.at(i).center;
+        occluders[i] = QVector4D(center.x(), center.y(), center.z(), m_occluders.at(i).radius);
+    }
+    m_program.setUniformValueArray("occluders", occluders, MaxOccluders);
+    m_program.setUniformValue("nOccluders", n);
+
+    m_program.setUniformValue("hasRing", (GLint)m_hasRing);
+    if (m_hasRing) {
+        // The ring lies in the equatorial plane of the body
+        setUniformVector(m_program.uniformLocation("ringCenter"), Eigen::Vector3d(modelView.translation()));
+        setUniformVector(m_program.uniformLocation("ringNormal"), Eigen::Vector3d((modelView.linear()*Eigen::Vector3d::UnitZ()).normalized()));
+        m_program.setUniformValue("ringRadii", QVector2D(m_ringInnerRadius, m_ringOuterRadius));
+    }
 }
 
 void Sphere::renderSolidColor(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
 {
-    m_programColor.bind();
+    RenderState *state = RenderState::instance();
+    state->useProgram(m_programColor);
 
     m_programColor.setUniformValue("color", m_color);
     setUniformMatrix(m_programColor.uniformLocation("modelViewMatrix"), view*model);
@@ -158,11 +213,10 @@ void Sphere::renderSolidColor(const Eigen::Affine3d &model, const Eigen::Affine3
     m_programColor.setUniformValue("logZbufferC", m_logZbufferC);
     m_programColor.setUniformValue("C", m_C);
 
+    RenderState::State drawState;
+    drawState.cull = true;
+    state->apply(drawState);
     m_vao.bind();
-    glEnable(GL_CULL_FACE);
     glDrawElements(GL_TRIANGLE_STRIP, m_dataSize, GL_UNSIGNED_INT, 0);
-    glDisable(GL_CULL_FACE);
     m_vao.release();
-
-    m_programColor.release();
 }
@@ -5,20 +5,45 @@
 
 #include <QOpenGLBuffer>
 
+struct Occluder {
+    Eigen::Vector3d center; // World coordinates
+    double radius;
+};
+
 class Sphere : public Pickable
 {
 public:
+    // Defined as MAX_OCCLUDERS in the shaders
+    static const int MaxOccluders = 4;
+
+    struct Mesh {
+        QVector<int> indices;
+        QVector<QVector3D> vertices;
+        QVector<QVector3D> normals;
+        QVector<QVector2D> texCoords;
+    };
+    // CPU only, can run on any thread
+    static Mesh createMesh(float radius, float flattening = 0.0);
+
     Sphere(float radius, float flattening = 0.0, QObject *parent = 0);
+    Sphere(const Mesh &mesh, QObject *parent = 0);
     ~Sphere();
+    void setLightRadius(float radius) {m_lightRadius = radius;}
+    void setOccluders(const QVector<Occluder> &occluders) {m_occluders = occluders;}
+    void setRingShadow(float innerRadius, float outerRadius);
     void createVAO();
     void render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
     void renderSolidColor(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
 
 private:
-    QVector<int> m_indices;
-    QVector<QVector3D> m_vertices;
-    QVector<QVector3D> m_normals;
-    QVector<QVector2D> m_texCoords;
+    void init(const Mesh &mesh);
+    void setShadowUniforms(const Eigen::Affine3d &modelView, const Eigen::Affine3d &view);
+
+    float m_lightRadius;
+    QVector<Occluder> m_occluders;
+    bool m_hasRing;
+    float m_ringInnerRadius;
+    float m_ringOuterRadius;
 
     QOpenGLBuffer m_indexBuffer;
     QOpenGLBuffer m_vertexBuffer;
@@ -0,0 +1,185 @@
+#include "trailbatch.h"
+#include "orbit.h"
+#include "renderstate.h"
+
+#include <algorithm>
+#include <cstddef>
+
+TrailBatch::TrailBatch(QObject *parent)
+    : Renderable(parent)
+    , m_allocated(false)
+    , m_vertexBuffer(QOpenGLBuffer::VertexBuffer)
+{
+    setShaders(m_program, "trail.vert", "axis.frag");
+    checkProgram(m_program);
+
+    m_program.bind();
+    m_program.setUniformValue("capacity", (GLfloat)Capacity);
+    m_program.release();
+
+    // Written in place every frame
+    m_vertexBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    m_vertexBuffer.create();
+
+    createVAO();
+}
+
+TrailBatch::~TrailBatch()
+{
+    m_vertexBuffer.destroy();
+}
+
+int TrailBatch::addTrail(double duration, const QVector3D &color)
+{
+    Trail trail;
+    trail.color = color;
+    trail.alpha = 0.0;
+    trail.interval = duration/Capacity;
+    trail.newestTime = 0.0;
+    trail.newest = 0;
+    trail.count = 0;
+    trail.dirtyBegin = Capacity;
+    trail.dirtyEnd = 0;
+    m_trails.append(trail);
+
+    Vertex vertex;
+    std::fill(vertex.high, vertex.high+3, 0.0f);
+    std::fill(vertex.low, vertex.low+3, 0.0f);
+    for (int i = 0; i < VerticesPerTrail; ++i) {
+        vertex.slot = i%Capacity;
+        m_vertices.append(vertex);
+    }
+    // The buffer grows, it is allocated again
+    m_allocated = false;
+    return m_trails.size()-1;
+}
+
+void TrailBatch::append(int trail, double time, const Eigen::Vector3d &position)
+{
+    Trail &t = m_trails[trail];
+    double age = time-t.newestTime;
+    if ((t.count == 0) || (age < 0.0) || (age > Capacity*t.interval)) {
+        t.newest = 0;
+        t.count = 1;
+        t.newestTime = time;
+    } else if (age >= t.interval) {
+        // The newest sample stays where it is, the next slot follows the body
+        t.newest = (t.newest+1)%Capacity;
+        t.count = qMin(t.count+1, Capacity);
+        t.newestTime = time;
+    }
+
+    Vertex &vertex = m_vertices[trail*VerticesPerTrail+t.newest];
+    for (int i = 0; i < 3; ++i) {
+        QVector2D value = Orbit::doubleToTwoFloats(position[i]);
+        vertex.high[i] = value.x();
+        vertex.low[i] = value.y();
+    }
+    if (t.newest == 0)
+        m_vertices[trail*VerticesPerTrail+Capacity] = vertex;
+    t.dirtyBegin = qMin(t.dirtyBegin, t.newest);
+    t.dirtyEnd = qMax(t.dirtyEnd, t.newest+1);
+}
+
+void TrailBatch::add(int trail, float alpha)
+{
+    m_trails[trail].alpha = alpha;
+}
+
+void TrailBatch::createVAO()
+{
+    m_vao.create();
+    m_vao.bind();
+
+    m_program.enableAttributeArray(PROGRAM_VERTEX_HIGH_ATTRIBUTE);
+    m_program.enableAttributeArray(PROGRAM_VERTEX_LOW_ATTRIBUTE);
+    m_program.enableAttributeArray(PROGRAM_TRAIL_SLOT_ATTRIBUTE);
+
+    m_vertexBuffer.bind();
+    m_program.setAttributeBuffer(PROGRAM_VERTEX_HIGH_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, high), 3, sizeof(Vertex));
+    m_program.setAttributeBuffer(PROGRAM_VERTEX_LOW_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, low), 3, sizeof(Vertex));
+    m_program.setAttributeBuffer(PROGRAM_TRAIL_SLOT_ATTRIBUTE, GL_FLOAT, offsetof(Vertex, slot), 1, sizeof(Vertex));
+    m_vertexBuffer.release();
+
+    m_vao.release();
+
+    m_program.disableAttributeArray(PROGRAM_VERTEX_HIGH_ATTRIBUTE);
+    m_program.disableAttributeArray(PROGRAM_VERTEX_LOW_ATTRIBUTE);
+    m_program.disableAttributeArray(PROGRAM_TRAIL_SLOT_ATTRIBUTE);
+}
+
+void TrailBatch::upload()
+{
+    m_vertexBuffer.bind();
+    if (!m_allocated) {
+        m_vertexBuffer.allocate(m_vertices.constData(), m_vertices.size() * sizeof(Vertex));
+        m_allocated = true;
+    } else {
+        // Usually the slot that follows the body, a second one when a sample starts
+        for (int i = 0; i < m_trails.size(); ++i) {
+            const Trail &trail = m_trails.at(i);
+            if (trail.dirtyBegin >= trail.dirtyEnd)
+                continue;
+            int first = i*VerticesPerTrail;
+            m_vertexBuffer.write((first+trail.dirtyBegin) * sizeof(Vertex), m_vertices.constData()+first+trail.dirtyBegin,
+                                 (trail.dirtyEnd-trail.dirtyBegin) * sizeof(Vertex));
+            if (trail.dirtyBegin == 0) {
+                m_vertexBuffer.write((first+Capacity) * sizeof(Vertex), m_vertices.constData()+first+Capacity, sizeof(Vertex));
+            }
+        }
+    }
+    m_vertexBuffer.release();
+    for (int i = 0; i < m_trails.size(); ++i) {
+        m_trails[i].dirtyBegin = Capacity;
+        m_trails[i].dirtyEnd = 0;
+    }
+}
+
+void TrailBatch::render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection)
+{
+    Q_UNUSED(model)
+    // Even when nothing is drawn, so that the buffer never lags behind
+    upload();
+
+    RenderState *state = RenderState::instance();
+    state->useProgram(m_program);
+    setUniformMatrix(m_program.uniformLocation("projectionMatrix"), projection);
+    m_program.setUniformValue("logZbufferC", m_logZbufferC);
+    m_program.setUniformValue("C", m_C);
+    // To prevent jitter, the camera is subtracted in emulated double precision, like OrbitBatch
+    const Eigen::Matrix3d rotation = view.linear();
+    setUniformMatrix(m_program.uniformLocation("rotation"), rotation);
+    Eigen::Vector3d cameraPosition = view.inverse().translation();
+    QVector2D doubleX = Orbit::doubleToTwoFloats(cameraPosition.x());
+    QVector2D doubleY = Orbit::doubleToTwoFloats(cameraPosition.y());
+    QVector2D doubleZ = Orbit::doubleToTwoFloats(cameraPosition.z());
+    m_program.setUniformValue("cameraHigh", QVector3D(doubleX.x(), doubleY.x(), doubleZ.x()));
+    m_program.setUniformValue("cameraLow", QVector3D(doubleX.y(), doubleY.y(), doubleZ.y()));
+
+    RenderState::State drawState;
+    drawState.blend = true;
+    state->apply(drawState);
+    m_vao.bind();
+    for (int i = 0; i < m_trails.size(); ++i) {
+        Trail &trail = m_trails[i];
+        if ((trail.alpha <= 0.0) || (trail.count < 2)) {
+            trail.alpha = 0.0;
+            continue;
+        }
+        m_program.setUniformValue("trailColor", QVector4D(trail.color, trail.alpha));
+        m_program.setUniformValue("newest", (GLfloat)trail.newest);
+        m_program.setUniformValue("count", (GLfloat)trail.count);
+        trail.alpha = 0.0;
+
+        // From the oldest sample to the newest, in two strips when the ring wraps
+        int first = i*VerticesPerTrail;
+        int oldest = (trail.newest-trail.count+1+Capacity)%Capacity;
+        if (oldest <= trail.newest) {
+            glDrawArrays(GL_LINE_STRIP, first+oldest, trail.count);
+        } else {
+            glDrawArrays(GL_LINE_STRIP, first+oldest, VerticesPerTrail-oldest);
+            glDrawArrays(GL_LINE_STRIP, first, trail.newest+1);
+        }
+    }
+    m_vao.release();
+}
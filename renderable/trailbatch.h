@@ -0,0 +1,63 @@
+#ifndef TRAILBATCH_H
+#define TRAILBATCH_H
+
+#include "renderable.h"
+
+#include <QOpenGLBuffer>
+
+// The paths the bodies really took in world coordinates, whatever moved
+// them: orbits, ephemerides or the N-body integrator. Each trail is a ring of
+// samples in one persistent vertex buffer; only the slots written since the
+// last frame are uploaded, with glBufferSubData, and the shader fades the
+// samples by their age. Trails are queued with add() during a pass and drawn
+// by render(), which empties the queue.
+class TrailBatch : public Renderable
+{
+public:
+    // Samples of a trail, over its duration
+    static const int Capacity = 256;
+
+    TrailBatch(QObject *parent = 0);
+    ~TrailBatch();
+    // Returns the trail id. duration is the time the trail covers, in s.
+    int addTrail(double duration, const QVector3D &color);
+    // The newest sample follows the body, a new one starts once the
+    // previous one is duration/Capacity old. Going back in time or jumping
+    // beyond the duration starts the trail over.
+    void append(int trail, double time/*seconds past J2000*/, const Eigen::Vector3d &position);
+    void add(int trail, float alpha = 1.0);
+
+    void createVAO();
+    // model is ignored, positions are in world coordinates
+    void render(const Eigen::Affine3d &model, const Eigen::Affine3d &view, const Eigen::Affine3d &projection);
+
+private:
+    struct Vertex {
+        GLfloat high[3];
+        GLfloat low[3];
+        GLfloat slot; // In the ring
+    };
+    struct Trail {
+        QVector3D color;
+        float alpha; // 0 when not queued
+        double interval; // s between two samples
+        double newestTime; // s past J2000, when the newest slot was started
+        int newest; // Slot that follows the body
+        int count; // Samples, the newest included
+        int dirtyBegin; // Slots to upload, [begin, end)
+        int dirtyEnd;
+    };
+
+    // Slot Capacity repeats slot 0 so that a wrapped ring is drawn as two strips
+    static const int VerticesPerTrail = Capacity+1;
+
+    void upload();
+
+    QVector<Trail> m_trails;
+    QVector<Vertex> m_vertices;
+    bool m_allocated;
+
+    QOpenGLBuffer m_vertexBuffer;
+};
+
+#endif // TRAILBATCH_H
@@ -0,0 +1,110 @@
+#include "sceneloader.h"
+#include "path.h"
+
+#include <QRunnable>
+#include <QSet>
+#include <QDebug>
+
+namespace {
+
+class BodyJob : public QRunnable
+{
+public:
+    BodyJob(const BodyDescriptor &descriptor, bool hasOrbit, BodyResources *resources)
+        : m_descriptor(descriptor), m_hasOrbit(hasOrbit), m_resources(resources) {}
+
+    void run()
+    {
+        m_resources->texture = SceneLoader::loadImage(resPath()+m_descriptor.texture);
+        if (!m_descriptor.nightTexture.isEmpty())
+            m_resources->nightTexture = SceneLoader::loadImage(resPath()+m_descriptor.nightTexture);
+        if (m_descriptor.hasRing)
+            m_resources->ringTexture = SceneLoader::loadImage(resPath()+m_descriptor.ringTexture);
+        m_resources->sphere = Sphere::createMesh(m_descriptor.radius, m_descriptor.flattening);
+        if (m_hasOrbit) {
+            m_resources->orbit = Orbit::createPath(m_descriptor.orbit);
+            m_resources->ephemeris = Ephemeris::create(m_descriptor.ephemeris, m_descriptor.orbit.revolutionPeriod);
+        }
+        if (m_descriptor.hasAtmosphere)
+            m_resources->atmosphere = Atmosphere::createTables(m_descriptor.radius, m_descriptor.atmosphere);
+    }
+
+private:
+    const BodyDescriptor &m_descriptor;
+    bool m_hasOrbit;
+    BodyResources *m_resources;
+};
+
+class StarsJob : public QRunnable
+{
+public:
+    StarsJob(Galaxy::Stars *stars) : m_stars(stars) {}
+    void run() {*m_stars = Galaxy::loadStars();}
+
+private:
+    Galaxy::Stars *m_stars;
+};
+
+}
+
+SceneLoader::SceneLoader(const Catalog &catalog)
+    : m_catalog(catalog)
+{
+}
+
+SceneLoader::~SceneLoader()
+{
+    // The jobs write into our members
+    m_pool.waitForDone();
+}
+
+void SceneLoader::start()
+{
+    // Only satellites have an orbit, small bodies are drawn from their elements alone
+    QSet<QString> satellites;
+    QSet<QString> smallBodies;
+    for (int i = 0; i < m_catalog.size(); ++i) {
+        foreach (const QString &satellite, m_catalog.at(i).satellites)
+            satellites.insert(satellite);
+        foreach (const QString &smallBody, m_catalog.at(i).smallBodies)
+            smallBodies.insert(smallBody);
+    }
+
+    // Each job owns one slot, the vector must not reallocate while they run
+    m_resources.resize(m_catalog.size());
+    BodyResources *resources = m_resources.data();
+
+    // The longest jobs go first so that they do not end up last on a busy pool
+    m_pool.start(new StarsJob(&m_stars), 1);
+    for (int i = 0; i < m_catalog.size(); ++i) {
+        const BodyDescriptor &descriptor = m_catalog.at(i);
+        // Also listed as a satellite, it is drawn as a body
+        if (smallBodies.contains(descriptor.name) && !satellites.contains(descriptor.name))
+            continue;
+        m_pool.start(new BodyJob(descriptor, satellites.contains(descriptor.name), resources+i),
+                     descriptor.hasAtmosphere ? 1 : 0);
+    }
+}
+
+void SceneLoader::waitForDone()
+{
+    m_pool.waitForDone();
+}
+
+const BodyResources *SceneLoader::resources(const QString &name) const
+{
+    int i = m_catalog.indexOf(name);
+    if ((i < 0) || (i >= m_resources.size()))
+        return 0;
+    return &m_resources.at(i);
+}
+
+QImage SceneLoader::loadImage(const QString &fileName)
+{
+    QImage img(fileName);
+    if (img.isNull()) {
+        qWarning()<<fileName<<"Unable to load file, unsupported file format";
+        return QImage();
+    }
+    return img.mirrored().convertToFormat(QImage::Format_RGBA8888);
+}
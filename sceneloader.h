@@ -0,0 +1,51 @@
+#ifndef SCENELOADER_H
+#define SCENELOADER_H
+
+#include "catalog.h"
+#include "renderable/sphere.h"
+#include "renderable/orbit.h"
+#include "renderable/atmosphere.h"
+#include "renderable/galaxy.h"
+#include "ephemeris/ephemeris.h"
+
+#include <QImage>
+#include <QThreadPool>
+
+// Everything a body needs that can be computed without a GL context
+struct BodyResources {
+    QImage texture; // Mirrored, RGBA8888
+    QImage nightTexture;
+    QImage ringTexture;
+    Sphere::Mesh sphere;
+    Orbit::Path orbit; // Empty for the root
+    QSharedPointer<Ephemeris> ephemeris; // Null when the Keplerian orbit is used
+    Atmosphere::Tables atmosphere; // Only if the body has an atmosphere
+};
+
+// Builds the scene in two phases: CPU preparation jobs on a thread pool
+// (image decoding, meshes, orbits, ephemerides, scattering tables, stars), then the
+// GL upload on the render thread when the bodies are constructed.
+class SceneLoader
+{
+public:
+    SceneLoader(const Catalog &catalog);
+    ~SceneLoader();
+    // Queues the preparation jobs and returns immediately
+    void start();
+    // Blocks until every job is done
+    void waitForDone();
+
+    const Catalog &catalog() const {return m_catalog;}
+    const BodyResources *resources(const QString &name) const;
+    const Galaxy::Stars &stars() const {return m_stars;}
+
+    static QImage loadImage(const QString &fileName);
+
+private:
+    const Catalog &m_catalog;
+    QThreadPool m_pool;
+    QVector<BodyResources> m_resources; // Same order as the catalog
+    Galaxy::Stars m_stars;
+};
+
+#endif // SCENELOADER_H
@@ -0,0 +1,69 @@
+varying highp vec3 eyePosition;
+
+struct LightInfo {
+  highp vec4 Position; // Light position in eye coords.
+  highp vec4 La; // Ambient light intensity
+  highp vec4 Ld; // Diffuse light intensity
+  highp vec4 Ls; // Specular light intensity
+};
+uniform LightInfo light;
+
+// Lookup tables precomputed by Atmosphere::precompute
+uniform sampler2D texture0; // Transmittance
+uniform sampler2D texture1; // Inscatter
+uniform highp float transmittanceScale;
+uniform highp float inscatterScale;
+
+uniform highp vec3 planetCenter; // eye coords
+uniform highp vec2 radii; // ground, top of the atmosphere
+uniform highp float mieG;
+
+const highp float pi = 3.14159265;
+const highp float sunIntensity = 10.0;
+
+highp vec3 transmittance(highp float r, highp float mu)
+{
+    highp vec2 uv = vec2((r-radii.x)/(radii.y-radii.x), mu);
+    return texture2D(texture0, uv).rgb*transmittanceScale;
+}
+
+void main(void)
+{
+    // The camera is at the origin of the eye coords
+    highp vec3 direction = normalize(eyePosition);
+    highp float tClosest = dot(planetCenter, direction);
+    highp vec3 closest = tClosest*direction-planetCenter;
+    highp float p = length(closest);
+    if (p > radii.y)
+        discard;
+
+    highp vec3 sun = normalize(light.Position.xyz-planetCenter);
+    highp float u;
+    highp vec3 zenith;
+    highp vec3 viewTransmittance;
+    if ((p < radii.x) && (tClosest > 0.0)) {
+        // The ray ends on the ground
+        highp vec3 ground = (tClosest-sqrt(radii.x*radii.x-p*p))*direction-planetCenter;
+        zenith = ground/radii.x;
+        highp float muG = max(dot(zenith, -direction), 0.0);
+        u = 0.5*muG;
+        viewTransmittance = transmittance(radii.x, muG);
+    } else {
+        // The ray goes through the atmosphere
+        zenith = closest/p;
+        u = 0.5+0.5*(max(p, radii.x)-radii.x)/(radii.y-radii.x);
+        highp vec3 t = transmittance(max(p, radii.x), 0.0);
+        viewTransmittance = t*t;
+    }
+    highp float muS = dot(zenith, sun);
+    highp vec4 inscatter = texture2D(texture1, vec2(u, 0.5+0.5*muS))*inscatterScale;
+
+    highp float nu = dot(direction, sun);
+    highp float phaseR = 3.0/(16.0*pi)*(1.0+nu*nu);
+    highp float g2 = mieG*mieG;
+    highp float phaseM = 3.0/(8.0*pi)*(1.0-g2)*(1.0+nu*nu)/((2.0+g2)*pow(1.0+g2-2.0*mieG*nu, 1.5));
+
+    highp vec3 color = sunIntensity*(inscatter.rgb*phaseR+vec3(inscatter.a)*phaseM);
+    // Blended with dst*alpha so the ground is attenuated by the atmosphere in front of it
+    gl_FragColor = vec4(color, dot(viewTransmittance, vec3(1.0/3.0)));
+}
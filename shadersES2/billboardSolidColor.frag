@@ -1,6 +0,0 @@
-uniform highp vec3 color;
-
-void main(void)
-{
-    gl_FragColor = vec4(color, 1.0);
-}
@@ -0,0 +1,16 @@
+varying highp vec2 textureCoord;
+
+uniform sampler2D texture0;
+uniform highp vec2 texelSize; // Of the source texture
+
+void main()
+{
+    // Dual filter downsampling: with bilinear filtering, 5 taps cover a 4x4 texels footprint
+    highp vec2 offset = texelSize;
+    highp vec4 sum = texture2D(texture0, textureCoord)*4.0;
+    sum += texture2D(texture0, textureCoord-offset);
+    sum += texture2D(texture0, textureCoord+offset);
+    sum += texture2D(texture0, textureCoord+vec2(offset.x, -offset.y));
+    sum += texture2D(texture0, textureCoord-vec2(offset.x, -offset.y));
+    gl_FragColor = sum*0.125;
+}
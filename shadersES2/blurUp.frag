@@ -0,0 +1,19 @@
+varying highp vec2 textureCoord;
+
+uniform sampler2D texture0;
+uniform highp vec2 texelSize; // Of the source texture
+
+void main()
+{
+    // Dual filter upsampling, tent shaped from 8 bilinear taps
+    highp vec2 offset = texelSize;
+    highp vec4 sum = texture2D(texture0, textureCoord+vec2(-2.0*offset.x, 0.0));
+    sum += texture2D(texture0, textureCoord+vec2(-offset.x, offset.y))*2.0;
+    sum += texture2D(texture0, textureCoord+vec2(0.0, 2.0*offset.y));
+    sum += texture2D(texture0, textureCoord+vec2(offset.x, offset.y))*2.0;
+    sum += texture2D(texture0, textureCoord+vec2(2.0*offset.x, 0.0));
+    sum += texture2D(texture0, textureCoord+vec2(offset.x, -offset.y))*2.0;
+    sum += texture2D(texture0, textureCoord+vec2(0.0, -2.0*offset.y));
+    sum += texture2D(texture0, textureCoord+vec2(-offset.x, -offset.y))*2.0;
+    gl_FragColor = sum/12.0;
+}
@@ -1,5 +1,6 @@
 varying highp vec2 textureCoord;
 varying highp float lambertTerm;
+varying highp vec3 eyePosition;
 
 struct LightInfo {
   highp vec4 Position; // Light position in eye coords.
@@ -19,9 +20,57 @@ uniform LightInfo light;
 
 uniform sampler2D texture2d;
 
+// Analytical shadows, see Sphere::render
+uniform highp vec4 occluders[MAX_OCCLUDERS]; // xyz: center in eye coords, w: radius
+uniform int nOccluders;
+uniform highp float lightRadius;
+
+uniform sampler2D texture2;
+uniform bool hasRing;
+uniform highp vec3 ringCenter; // eye coords
+uniform highp vec3 ringNormal; // eye coords
+uniform highp vec2 ringRadii; // inner, outer
+
+#include "shadow.glsl"
+
+// Light transmitted through the ring plane between p and the light.
+highp float ringShadow(highp vec3 p, highp vec3 lightDir)
+{
+    highp float denom = dot(lightDir, ringNormal);
+    if (abs(denom) < 1e-6)
+        return 1.0;
+    highp float t = dot(ringCenter-p, ringNormal)/denom;
+    if (t <= 0.0)
+        return 1.0;
+    highp float r = length(p+t*lightDir-ringCenter);
+    if (r < ringRadii.x || r > ringRadii.y)
+        return 1.0;
+    highp float u = (r-ringRadii.x)/(ringRadii.y-ringRadii.x);
+    return 1.0 - texture2D(texture2, vec2(u, 0.5)).a;
+}
+
+highp float shadow(highp vec3 p)
+{
+    highp vec3 toLight = light.Position.xyz - p;
+    highp float lightDistance = length(toLight);
+    highp vec3 lightDir = toLight/lightDistance;
+    highp float visibility = 1.0;
+    for (int i=0; i<MAX_OCCLUDERS; ++i) {
+        if (i >= nOccluders)
+            break;
+        visibility *= sphereShadow(p, lightDir, lightDistance, lightRadius, occluders[i]);
+    }
+    if (hasRing)
+        visibility *= ringShadow(p, lightDir);
+    return visibility;
+}
+
 void main(void)
 {
   highp vec4 diffuse = light.Ld*lambertTerm/*+material.Kd*lambertTerm*/;
+  // Only the lit hemisphere can be shadowed
+  if (lambertTerm > 0.0)
+    diffuse *= shadow(eyePosition);
   //Don't let the dark face all black
   diffuse = max( diffuse, 0.1 );
 
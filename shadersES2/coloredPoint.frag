@@ -1,6 +1,4 @@
-varying highp vec3 sColor;
-
-uniform float alpha;
+varying highp vec4 sColor;
 
 void main(void)
 {
@@ -9,5 +7,5 @@ void main(void)
         discard;
     highp float sigma2 = 0.02;
     highp float a = clamp(exp((-radius*radius+0.2)/(2.0*sigma2)), 0.0, 1.0);
-    gl_FragColor = vec4(sColor, alpha*a);
+    gl_FragColor = vec4(sColor.rgb, sColor.a*a);
 }
@@ -4,6 +4,7 @@ attribute vec2 texCoord;
 
 varying vec2 textureCoord;
 varying float lambertTerm;
+varying vec3 eyePosition;
 
 struct LightInfo {
     vec4 Position; // Light position in eye coords.
@@ -24,6 +25,7 @@ void main()
 {
     // transform the vertex position and its normal into view (or eye) space
     vec3 pv = vec3(modelViewMatrix * vertex);
+    eyePosition = pv;
     vec3 nv = normalMatrix * vec3(normal);
 
     // light vector (from vertex to light) in view space
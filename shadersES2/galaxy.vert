@@ -16,4 +16,9 @@ void main()
         magnitude = 6.5;
     gl_PointSize = (8.5-magnitude)*pointSizeCoeff;
     gl_Position = projectionMatrix * modelViewMatrix * vertex;
+#ifdef CUBE_FACE
+    // Texels get smaller towards the edges of the face, keep the stars the same apparent size
+    vec2 position = gl_Position.xy/gl_Position.w;
+    gl_PointSize *= pow(1.0+dot(position, position), 0.75);
+#endif
 }
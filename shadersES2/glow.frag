@@ -0,0 +1,10 @@
+varying highp vec2 textureCoord;
+
+uniform sampler2D texture0;
+uniform highp float glowIntensity;
+
+void main(void)
+{
+    // Blended additively over the scene
+    gl_FragColor = glowIntensity*texture2D(texture0, textureCoord);
+}
@@ -0,0 +1,135 @@
+attribute vec4 keplerElements; // Eccentricity, mean anomaly at J2000 and mean motion high, low, in revolutions
+attribute vec3 majorAxis; // Towards the periapsis, of length a, or q for parabolas
+attribute vec3 minorAxis; // Of length b, or 2q for parabolas
+attribute vec4 color; // w: 0 at the body, 1 at the end of its trail
+
+varying vec4 sColor;
+
+uniform mat3 rotation; // Frame of the parent to eye, without the translation
+uniform vec3 cameraHigh; // In the frame of the parent
+uniform vec3 cameraLow;
+uniform vec2 time; // s past J2000, high and low
+uniform float trailLength; // Revolutions of mean anomaly
+uniform float alpha;
+uniform mat4 projectionMatrix;
+
+uniform float pointSize;
+uniform float logZbufferC;
+uniform float C;
+
+const float PI = 3.14159265;
+// Fixed for ES2, enough for the single precision from these starters
+const int KeplerIterations = 2;
+
+//
+// Emulated double precision multiplication ported from dsmul() in DSFUN90.
+// http://crd.lbl.gov/~dhbailey/mpdist/
+//
+vec2 dsmul(vec2 a, vec2 b)
+{
+    const float split = 4097.0; // Dekker's split of the 24 bit mantissas
+    float cona = a.x*split;
+    float a1 = cona - (cona - a.x);
+    float a2 = a.x - a1;
+    float conb = b.x*split;
+    float b1 = conb - (conb - b.x);
+    float b2 = b.x - b1;
+    float c11 = a.x*b.x;
+    float c21 = a2*b2 + (a2*b1 + (a1*b2 + (a1*b1 - c11)));
+    float c2 = a.x*b.y + a.y*b.x;
+    float t1 = c11 + c2;
+    float e = t1 - c11;
+    float t2 = ((c2 - e) + (c11 - (t1 - e))) + c21;
+    float high = t1 + t2;
+    return vec2(high, t2 - (high - t1));
+}
+
+float cubeRoot(float x)
+{
+    return sign(x)*pow(abs(x), 1.0/3.0);
+}
+
+// Solves E-e*sin(E) = M, M in [-pi, pi], with Markley's starter like Orbit
+float eccentricAnomaly(float e, float M)
+{
+    float m = abs(M);
+    float k = (3.0*PI*PI + 1.6*PI*(PI - m)/(1.0 + e))/(PI*PI - 6.0);
+    float d = 3.0*(1.0 - e) + k*e;
+    float q = 2.0*k*d*(1.0 - e) - m*m;
+    float r = 3.0*k*d*(d - 1.0 + e)*m + m*m*m;
+    float w = pow(abs(r) + sqrt(q*q*q + r*r), 2.0/3.0);
+    float E = (2.0*r*w/(w*w + w*q + q*q) + m)/d;
+    for (int i = 0; i < KeplerIterations; ++i) {
+        float es = e*sin(E);
+        float ec = e*cos(E);
+        float f = E - es - m;
+        float d1 = -f/(1.0 - ec);
+        float d2 = -f/(1.0 - ec + 0.5*d1*es);
+        E += -f/(1.0 - ec + 0.5*d2*es + d2*d2*ec/6.0);
+    }
+    return sign(M)*E;
+}
+
+// Solves e*sinh(H)-H = M, with the starter of Orbit
+vec2 hyperbolicAnomaly(float e, float M)
+{
+    float m = abs(M);
+    float p = 6.0*(e - 1.0)/e;
+    float q = 3.0*m/e;
+    float s = sqrt(q*q + p*p*p/27.0);
+    float H = min(cubeRoot(q + s) + cubeRoot(q - s), log(2.0*m/e + 1.8));
+    for (int i = 0; i < KeplerIterations; ++i) {
+        float x = exp(H);
+        float sinhH = 0.5*(x - 1.0/x);
+        float coshH = 0.5*(x + 1.0/x);
+        float f = e*sinhH - H - m;
+        float d1 = -f/(e*coshH - 1.0);
+        float d2 = -f/(e*coshH - 1.0 + 0.5*d1*e*sinhH);
+        H += -f/(e*coshH - 1.0 + 0.5*d2*e*sinhH + d2*d2*e*coshH/6.0);
+    }
+    // cosh(H), sinh(H)
+    float x = exp(H);
+    return vec2(0.5*(x + 1.0/x), sign(M)*0.5*(x - 1.0/x));
+}
+
+void main()
+{
+    float e = keplerElements.x;
+    // The product is in double-single, only its fraction matters for the ellipses
+    vec2 turns = dsmul(keplerElements.zw, time);
+    float M = (turns.x - floor(turns.x)) + turns.y + keplerElements.y;
+#ifdef TRAIL
+    M -= color.w*trailLength;
+    sColor = vec4(color.rgb, alpha*(1.0 - color.w));
+#else
+    sColor = vec4(color.rgb, alpha);
+#endif
+    // The plane coordinates along the axes
+    vec2 inPlane;
+    if (e < 1.0) {
+        float E = eccentricAnomaly(e, 2.0*PI*(fract(M + 0.5) - 0.5));
+        inPlane = vec2(cos(E) - e, sin(E));
+    } else if (e > 1.0) {
+        // Not periodic, the fraction is only that of the product
+        M += floor(turns.x);
+        vec2 H = hyperbolicAnomaly(e, 2.0*PI*M);
+        inPlane = vec2(e - H.x, H.y);
+    } else {
+        // Barker's equation D+D^3/3 = M, in closed form
+        M += floor(turns.x);
+        float b = 1.5*abs(2.0*PI*M);
+        float c = cubeRoot(b + sqrt(1.0 + b*b));
+        float D = sign(M)*(c - 1.0/c);
+        inPlane = vec2(1.0 - D*D, D);
+    }
+    vec3 position = majorAxis*inPlane.x + minorAxis*inPlane.y;
+
+    // The position is only single precision, the camera is subtracted as in orbit.vert
+    vec3 difference = (position - cameraHigh) - cameraLow;
+    gl_PointSize = pointSize;
+    gl_Position = projectionMatrix * vec4(rotation * difference, 1.0);
+
+//    gl_Position.z = log2(max(1e-6, 1.0 + gl_Position.w)) * logZbufferC - 1.0;
+    gl_Position.z = log(gl_Position.w*C + 1.0) * logZbufferC - 1.0;
+    gl_Position.z *= gl_Position.w;
+}
@@ -0,0 +1,16 @@
+varying highp vec2 textureCoord;
+varying highp vec4 labelColor;
+
+uniform sampler2D texture0;
+
+uniform highp float smoothing;
+
+void main()
+{
+    // Signed distance field, the outline is at 0.5
+    highp float distance = texture2D(texture0, textureCoord).a;
+    highp float alpha = smoothstep(0.5-smoothing, 0.5+smoothing, distance);
+    if (alpha == 0.0)
+        discard;
+    gl_FragColor = vec4(labelColor.rgb, labelColor.a*alpha);
+}
@@ -0,0 +1,6 @@
+varying highp vec4 labelColor;
+
+void main(void)
+{
+    gl_FragColor = labelColor;
+}
@@ -3,15 +3,15 @@
 #endif
 
 varying highp vec4 sColor;
+varying highp float phase;
 varying highp float zClip;
 
-uniform float alpha;
-
 void main(void)
 {
-    if (sColor.a < 0.01)
+    highp float fade = fract(phase);
+    if (fade < 0.01)
         discard;
-    gl_FragColor = vec4(sColor.rgb, sColor.a*alpha);
+    gl_FragColor = vec4(sColor.rgb, fade*sColor.a);
 
 #ifndef GL_ES
     const highp float C = 1.0;
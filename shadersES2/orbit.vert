@@ -1,33 +1,63 @@
 attribute vec3 vertexHigh;
 attribute vec3 vertexLow;
-attribute vec4 color;
+attribute vec3 orbitSample; // Sample index along the orbit, orbit index in the draw, 1 if open
 
 varying vec4 sColor;
+varying float phase;
 varying float zClip;
 
-uniform mat4 modelViewMatrixRTE;
+// Parameter table, one entry per orbit of the draw
+uniform mat3 rotation[ORBITS_PER_DRAW]; // Orbital plane to eye, without the translation
+uniform vec4 cameraHigh[ORBITS_PER_DRAW]; // xyz: camera in the orbital plane frame, w: body sample
+uniform vec4 cameraLow[ORBITS_PER_DRAW]; // w: sample moved onto the body
+uniform vec4 bodyPosition[ORBITS_PER_DRAW]; // xy high, xy low
+uniform vec4 orbitColor[ORBITS_PER_DRAW]; // alpha 0 when not drawn
 uniform mat4 projectionMatrix;
 
-uniform vec3 cameraPosHigh;
-uniform vec3 cameraPosLow;
-
+uniform float steps;
 uniform float logZbufferC;
 uniform float C;
 
 void main()
 {
-    sColor = color;
+    int orbit = int(orbitSample.y + 0.5);
+    sColor = orbitColor[orbit];
+    if (sColor.a <= 0.0) {
+        // Outside of the clip volume
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        phase = 0.0;
+        zClip = 0.0;
+        return;
+    }
+
+    // Fades from the body backwards along the orbit, the wrap is done per fragment
+    vec3 positionHigh = vertexHigh;
+    vec3 positionLow = vertexLow;
+    bool openPath = orbitSample.z > 0.5;
+    phase = (orbitSample.x - cameraHigh[orbit].w)/steps;
+    // The nearest sample is moved onto the body, so the line goes through it.
+    // The ends of open paths do not meet.
+    float k = orbitSample.x - cameraLow[orbit].w;
+    if ( (abs(k) < 0.5) || (!openPath && (abs(abs(k) - steps) < 0.5)) ) {
+        positionHigh = vec3(bodyPosition[orbit].xy, 0.0);
+        positionLow = vec3(bodyPosition[orbit].zw, 0.0);
+        phase = k/steps;
+    }
+    // Open paths fade both ways from the body, without wrapping, and stay
+    // visible when it is beyond their ends
+    if (openPath)
+        phase = clamp(1.0 - abs(k)/steps, 0.25, 0.99);
 
     //
     // Emulated double precision subtraction ported from dssub() in DSFUN90.
     // http://crd.lbl.gov/~dhbailey/mpdist/
     //
-    vec3 t1 = vertexLow - cameraPosLow;
-    vec3 e = t1 - vertexLow;
-    vec3 t2 = ((-cameraPosLow - e) + (vertexLow - (t1 - e))) + vertexHigh - cameraPosHigh;
+    vec3 t1 = positionLow - cameraLow[orbit].xyz;
+    vec3 e = t1 - positionLow;
+    vec3 t2 = ((-cameraLow[orbit].xyz - e) + (positionLow - (t1 - e))) + positionHigh - cameraHigh[orbit].xyz;
     vec3 highDifference = t1 + t2;
     vec3 lowDifference = t2 - (highDifference - t1);
-    gl_Position = projectionMatrix * modelViewMatrixRTE * vec4(highDifference + lowDifference, 1.0);
+    gl_Position = projectionMatrix * vec4(rotation[orbit] * (highDifference + lowDifference), 1.0);
 
     zClip = gl_Position.z;
     //MARCHE PAS!!! faut tester l'extension
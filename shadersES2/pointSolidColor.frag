@@ -1,9 +1,9 @@
-uniform highp vec3 color;
+varying highp vec3 pickColor;
 
 void main(void)
 {
     highp float radius = distance(vec2(0.5, 0.5), gl_PointCoord);
     if (radius > 0.5)
         discard;
-    gl_FragColor = vec4(color, 1.0);
+    gl_FragColor = vec4(pickColor, 1.0);
 }
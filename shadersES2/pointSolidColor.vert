@@ -1,6 +1,8 @@
 attribute vec4 vertex;
+attribute vec3 color;
+
+varying vec3 pickColor;
 
-uniform mat4 modelViewMatrix;
 uniform mat4 projectionMatrix;
 
 uniform float pointSize;
@@ -9,8 +11,9 @@ uniform float C;
 
 void main()
 {
+    pickColor = color;
     gl_PointSize = pointSize;
-    gl_Position = projectionMatrix * modelViewMatrix * vertex;
+    gl_Position = projectionMatrix * vertex;
 
 //    gl_Position.z = log2(max(1e-6, 1.0 + gl_Position.w)) * logZbufferC - 1.0;
     gl_Position.z = log(gl_Position.w*C + 1.0) * logZbufferC - 1.0;
@@ -1,8 +1,29 @@
 varying highp vec2 textureCoord;
+varying highp vec3 eyePosition;
+
+struct LightInfo {
+  highp vec4 Position; // Light position in eye coords.
+  highp vec4 La; // Ambient light intensity
+  highp vec4 Ld; // Diffuse light intensity
+  highp vec4 Ls; // Specular light intensity
+};
+uniform LightInfo light;
+uniform highp float lightRadius;
 
 uniform sampler2D texture2d;
 
+// The planet, xyz: center in eye coords, w: radius
+uniform highp vec4 planet;
+
+#include "shadow.glsl"
+
 void main(void)
 {
-    gl_FragColor = vec4( texture2D(texture2d, textureCoord) );
+    highp vec4 color = vec4( texture2D(texture2d, textureCoord) );
+    highp vec3 toLight = light.Position.xyz - eyePosition;
+    highp float lightDistance = length(toLight);
+    highp float visibility = sphereShadow(eyePosition, toLight/lightDistance, lightDistance, lightRadius, planet);
+    //Don't let the shadowed part all black
+    color.rgb *= max(visibility, 0.1);
+    gl_FragColor = color;
 }
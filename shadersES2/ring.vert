@@ -2,6 +2,7 @@ attribute vec4 vertex;
 attribute vec2 texCoord;
 
 varying vec2 textureCoord;
+varying vec3 eyePosition;
 
 uniform mat4 modelViewMatrix;
 uniform mat4 projectionMatrix;
@@ -13,6 +14,7 @@ void main()
 {
     // connect first texture coordinates of the vertex
     textureCoord = texCoord;
+    eyePosition = vec3(modelViewMatrix * vertex);
     gl_Position = projectionMatrix * modelViewMatrix * vertex;
 
 //    gl_Position.z = log2(max(1e-6, 1.0 + gl_Position.w)) * logZbufferC - 1.0;
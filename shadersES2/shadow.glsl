@@ -0,0 +1,16 @@
+// Included by the fragment shaders of Sphere and Ring, see Renderable::shaderSource
+
+// Fraction of the light disc visible from p past a spherical occluder.
+highp float sphereShadow(highp vec3 p, highp vec3 lightDir, highp float lightDistance, highp float lightRadius, highp vec4 occluder)
+{
+    highp vec3 toOccluder = occluder.xyz - p;
+    highp float occluderDistance = length(toOccluder);
+    if (occluderDistance >= lightDistance)
+        return 1.0;
+    highp float separation = acos(clamp(dot(toOccluder/occluderDistance, lightDir), -1.0, 1.0));
+    highp float rl = asin(min(lightRadius/lightDistance, 1.0));
+    highp float ro = asin(min(occluder.w/occluderDistance, 1.0));
+    // Linear penumbra, umbra/antumbra bounded by the ratio of the disc areas
+    highp float overlap = clamp((rl+ro-separation)/(2.0*min(rl, ro)), 0.0, 1.0);
+    return 1.0 - overlap*min(ro*ro/(rl*rl), 1.0);
+}
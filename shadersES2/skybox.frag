@@ -0,0 +1,8 @@
+varying highp vec3 direction;
+
+uniform samplerCube texture0;
+
+void main(void)
+{
+    gl_FragColor = vec4(textureCube(texture0, direction).rgb, 1.0);
+}
@@ -0,0 +1,13 @@
+attribute vec4 vertex;
+
+varying vec3 direction;
+
+uniform mat4 inverseViewProjection;
+
+void main()
+{
+    // Point of the near plane seen through this corner, the camera being at the origin
+    vec4 nearPoint = inverseViewProjection * vec4(vertex.xy, -1.0, 1.0);
+    direction = nearPoint.xyz/nearPoint.w;
+    gl_Position = vec4(vertex.xy, 0.0, 1.0);
+}
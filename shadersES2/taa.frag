@@ -0,0 +1,24 @@
+varying highp vec2 textureCoord;
+
+uniform sampler2D texture0; // Current jittered frame
+uniform sampler2D texture1; // History
+uniform highp vec2 resolution;
+uniform highp float feedback;
+
+void main()
+{
+    highp vec2 texelSize = 1.0/resolution;
+    highp vec4 current = texture2D(texture0, textureCoord);
+    highp vec4 n = texture2D(texture0, textureCoord+vec2(0.0, texelSize.y));
+    highp vec4 s = texture2D(texture0, textureCoord-vec2(0.0, texelSize.y));
+    highp vec4 e = texture2D(texture0, textureCoord+vec2(texelSize.x, 0.0));
+    highp vec4 w = texture2D(texture0, textureCoord-vec2(texelSize.x, 0.0));
+
+    // Neighborhood clamping rejects the history that no longer matches the scene,
+    // we have no motion vectors.
+    highp vec4 minColor = min(current, min(min(n, s), min(e, w)));
+    highp vec4 maxColor = max(current, max(max(n, s), max(e, w)));
+    highp vec4 history = clamp(texture2D(texture1, textureCoord), minColor, maxColor);
+
+    gl_FragColor = mix(current, history, feedback);
+}
@@ -0,0 +1,39 @@
+attribute vec3 vertexHigh;
+attribute vec3 vertexLow;
+attribute float trailSlot;
+
+varying vec4 sColor;
+
+uniform mat3 rotation; // World to eye, without the translation
+uniform vec3 cameraHigh; // In world coordinates
+uniform vec3 cameraLow;
+uniform vec4 trailColor;
+uniform float newest; // Slot that follows the body
+uniform float count; // Samples in the ring
+uniform float capacity;
+uniform mat4 projectionMatrix;
+
+uniform float logZbufferC;
+uniform float C;
+
+void main()
+{
+    // Fades from the body to the oldest sample
+    float age = mod(newest - trailSlot + capacity, capacity);
+    sColor = vec4(trailColor.rgb, trailColor.a*(1.0 - age/count));
+
+    //
+    // Emulated double precision subtraction ported from dssub() in DSFUN90.
+    // http://crd.lbl.gov/~dhbailey/mpdist/
+    //
+    vec3 t1 = vertexLow - cameraLow;
+    vec3 e = t1 - vertexLow;
+    vec3 t2 = ((-cameraLow - e) + (vertexLow - (t1 - e))) + vertexHigh - cameraHigh;
+    vec3 highDifference = t1 + t2;
+    vec3 lowDifference = t2 - (highDifference - t1);
+    gl_Position = projectionMatrix * vec4(rotation * (highDifference + lowDifference), 1.0);
+
+//    gl_Position.z = log2(max(1e-6, 1.0 + gl_Position.w)) * logZbufferC - 1.0;
+    gl_Position.z = log(gl_Position.w*C + 1.0) * logZbufferC - 1.0;
+    gl_Position.z *= gl_Position.w;
+}
@@ -5,6 +5,11 @@ QT += gui quick qml
 
 HEADERS +=  \
     body.h \
+    bodymotion.h \
+    catalog.h \
+    eventsearch.h \
+    positionquery.h \
+    sceneloader.h \
     timeline.h \
     renderable/axis.h \
     renderable/galaxy.h \
@@ -15,15 +20,36 @@ HEADERS +=  \
     viewitem.h \
     path.h \
     osdetails.h \
-    renderable/pointobject.h \
+    renderable/pointbatch.h \
+    renderable/orbitbatch.h \
+    renderable/keplerbatch.h \
+    renderable/trailbatch.h \
+    renderable/renderstate.h \
+    renderable/renderqueue.h \
+    renderable/rendertargetpool.h \
     camera.h \
-    renderable/textbillboard.h \
+    renderable/glyphatlas.h \
+    renderable/labelbatch.h \
     renderable/pickable.h \
     renderable/screenquad.h \
-    renderable/flare.h
+    renderable/flare.h \
+    renderable/atmosphere.h \
+    renderable/programcache.h \
+    ephemeris/ephemeris.h \
+    ephemeris/chebyshevcache.h \
+    ephemeris/elp2000.h \
+    ephemeris/vsop87.h \
+    ephemeris/spkkernel.h \
+    ephemeris/jplephemeris.h \
+    ephemeris/nbodyintegrator.h
 
 SOURCES +=  \
     body.cpp \
+    bodymotion.cpp \
+    catalog.cpp \
+    eventsearch.cpp \
+    positionquery.cpp \
+    sceneloader.cpp \
     main.cpp \
     timeline.cpp \
     renderable/axis.cpp \
@@ -34,32 +60,52 @@ SOURCES +=  \
     renderable/sphere.cpp \
     viewitem.cpp \
     osdetails.cpp \
-    renderable/pointobject.cpp \
+    renderable/pointbatch.cpp \
+    renderable/orbitbatch.cpp \
+    renderable/keplerbatch.cpp \
+    renderable/trailbatch.cpp \
+    renderable/renderstate.cpp \
+    renderable/renderqueue.cpp \
+    renderable/rendertargetpool.cpp \
     camera.cpp \
-    renderable/textbillboard.cpp \
+    renderable/glyphatlas.cpp \
+    renderable/labelbatch.cpp \
     renderable/pickable.cpp \
     renderable/screenquad.cpp \
-    renderable/flare.cpp
+    renderable/flare.cpp \
+    renderable/atmosphere.cpp \
+    renderable/programcache.cpp \
+    ephemeris/ephemeris.cpp \
+    ephemeris/chebyshevcache.cpp \
+    ephemeris/elp2000.cpp \
+    ephemeris/vsop87.cpp \
+    ephemeris/spkkernel.cpp \
+    ephemeris/jplephemeris.cpp \
+    ephemeris/nbodyintegrator.cpp
 
 OTHER_FILES += \
     android/AndroidManifest.xml \
     data/data.txt \
     qml/main.qml \
-    shadersES2/blur.frag \
+    shadersES2/blurDown.frag \
+    shadersES2/blurUp.frag \
     shadersES2/body.frag \
-    shadersES2/combineTexture.frag \
+    shadersES2/glow.frag \
     shadersES2/earth.frag \
     shadersES2/galaxy.frag \
     shadersES2/orbit.frag \
     shadersES2/ring.frag \
+    shadersES2/shadow.glsl \
     shadersES2/solidColor.frag \
     shadersES2/sun.frag \
     shadersES2/blur.vert \
     shadersES2/body.vert \
-    shadersES2/combineTexture.vert \
+    shadersES2/glow.vert \
     shadersES2/earth.vert \
     shadersES2/galaxy.vert \
     shadersES2/orbit.vert \
+    shadersES2/kepler.vert \
+    shadersES2/trail.vert \
     shadersES2/ring.vert \
     shadersES2/solidColor.vert \
     shadersES2/sun.vert \
@@ -77,10 +123,6 @@ OTHER_FILES += \
     qml/CustomSlider.qml \
     shadersES2/axis.vert \
     shadersES2/axis.frag \
-    shadersES2/textBillboard.frag \
-    shadersES2/textBillboard.vert \
-    shadersES2/billboardSolidColor.frag \
-    shadersES2/billboardSolidColor.vert \
     shadersES2/flare.frag \
     shadersES2/flare.vert \
     shadersES2/fxaa.frag \
@@ -88,7 +130,17 @@ OTHER_FILES += \
     shadersES2/FXAA.frag \
     shadersES2/FXAA.vert \
     shadersES2/FXAA3.11.frag \
-    shadersES2/FXAA3.11.vert
+    shadersES2/FXAA3.11.vert \
+    shadersES2/atmosphere.frag \
+    shadersES2/atmosphere.vert \
+    shadersES2/taa.frag \
+    shadersES2/taa.vert \
+    shadersES2/label.frag \
+    shadersES2/label.vert \
+    shadersES2/labelSolidColor.frag \
+    shadersES2/labelSolidColor.vert \
+    shadersES2/skybox.frag \
+    shadersES2/skybox.vert
 
 RESOURCES +=
 
@@ -1,14 +1,30 @@
 #include "timeline.h"
 
 static const int interval = 10; //ms
+// 2000-01-01 12:00 TT in Unix time
+static const double J2000 = 946727935.0;
 
 Timeline::Timeline()
-    : J2000(946727935.0)
 {
     realTime();
     startTimer(interval);
 }
 
+double Timeline::currentTime() const
+{
+    return m_currentTime/1000.0-J2000;
+}
+
+double Timeline::toTime(const QDateTime &dateTime)
+{
+    return dateTime.toMSecsSinceEpoch()/1000.0-J2000;
+}
+
+QDateTime Timeline::toDateTime(double time)
+{
+    return QDateTime::fromMSecsSinceEpoch((qint64)qRound64((time+J2000)*1000.0));
+}
+
 void Timeline::realTime()
 {
     realRate();
@@ -9,7 +9,7 @@ class Timeline : public QObject
     Q_OBJECT
 public:
     Timeline();
-    double currentTime() const {return m_currentTime/1000.0d-J2000;}
+    double currentTime() const; // Seconds past J2000, leap seconds ignored
     void realTime();
     qint64 rate() {return m_speedRate;}
     void realRate() {m_speedRate = 1; emit rateChanged();}
@@ -18,6 +18,8 @@ public:
     void pause() {m_speedRate = 0; emit rateChanged();}
     QDateTime dateTime() const;
     void setDateTime(const QDateTime& dateTime);
+    static double toTime(const QDateTime &dateTime);
+    static QDateTime toDateTime(double time);
 
 signals:
     void tick();
@@ -27,7 +29,6 @@ protected:
     void timerEvent(QTimerEvent *event);
 
 private:
-    double J2000;
     qint64 m_currentTime;
     qint64 m_speedRate;
 };
@@ -1,11 +1,56 @@
 #include "viewitem.h"
+#include "path.h"
+#include "sceneloader.h"
 
 
 #include <QtQuick/QQuickWindow>
 #include <QOpenGLFramebufferObject>
 #include <QSGSimpleTextureNode>
+#include <QRunnable>
 #include <QtMath>
 
+static double halton(int index, int base)
+{
+    // Low discrepancy sequence in [0, 1[
+    double f = 1.0;
+    double result = 0.0;
+    while (index > 0) {
+        f /= base;
+        result += f*(index%base);
+        index /= base;
+    }
+    return result;
+}
+
+namespace {
+
+// A century of events from start, handed back to the GUI thread
+class EventSearchJob : public QRunnable
+{
+public:
+    EventSearchJob(const EventSearch &search, double start, const QAtomicInt &latestId, QObject *receiver)
+        : m_search(search), m_start(start), m_id(latestId.load()), m_latestId(latestId), m_receiver(receiver) {}
+
+    void run()
+    {
+        // Superseded while it was queued
+        if (m_latestId.load() != m_id)
+            return;
+        QVector<Event> events = m_search.search(m_start, m_start+100.0*365.25*86400.0);
+        QMetaObject::invokeMethod(m_receiver, "setEvents", Qt::QueuedConnection,
+                                  Q_ARG(int, m_id), Q_ARG(QVector<Event>, events));
+    }
+
+private:
+    const EventSearch &m_search;
+    double m_start;
+    int m_id;
+    const QAtomicInt &m_latestId;
+    QObject *m_receiver;
+};
+
+}
+
 class TextureNode : public QObject, public QSGSimpleTextureNode
 {
     Q_OBJECT
@@ -64,37 +109,54 @@ private:
 
 ViewItem::ViewItem(QQuickItem * parent)
     : QQuickItem(parent)
-    , m_multiSampleFbo(0)
-    , m_superSampleFbo(0)
-    , m_simpleFbo(0)
-    , m_simpleFbo2(0)
-    , m_postProcessFbo1(0)
-    , m_postProcessFbo2(0)
+    , m_historyIndex(0)
+    , m_historyValid(false)
+    , m_frameIndex(0)
     , m_nBlurPass(4)
     , m_antiAliasingType(NOAA)
     , m_node(0)
     , m_camera(0)
     , m_selectedBody(0)
     , m_galaxy(0)
+    , m_labels(0)
+    , m_points(0)
+    , m_orbits(0)
+    , m_smallBodies(0)
+    , m_trails(0)
+    , m_eventSearch(0)
+    , m_eventsStart(0.0)
+    , m_searchId(0)
     , m_sun(0)
+    , m_nBody(false)
 {
+    m_historyFbo[0] = 0;
+    m_historyFbo[1] = 0;
     setFlag(ItemHasContents, true);
     setAcceptedMouseButtons(Qt::AllButtons);
 
     m_camera = new Camera(this);
+
+    qRegisterMetaType<QVector<Event> >("QVector<Event>");
+    // The search spreads its windows on a pool of its own
+    m_searchPool.setMaxThreadCount(1);
 }
 
 ViewItem::~ViewItem()
 {
     m_screenQuad->deleteLater();
     m_galaxy->deleteLater();
+    m_labels->deleteLater();
+    m_points->deleteLater();
+    m_orbits->deleteLater();
+    m_smallBodies->deleteLater();
+    m_trails->deleteLater();
     m_sun->deleteLater();
-    delete m_multiSampleFbo;
-    delete m_superSampleFbo;
-    delete m_simpleFbo;
-    delete m_simpleFbo2;
-    delete m_postProcessFbo1;
-    delete m_postProcessFbo2;
+    // The job reads the search
+    m_searchPool.waitForDone();
+    delete m_eventSearch;
+    m_targets.clear();
+    delete m_historyFbo[0];
+    delete m_historyFbo[1];
 }
 
 QSGNode *ViewItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
@@ -142,6 +204,7 @@ void ViewItem::setAntiAliasingType(int type)
 {
     m_mutex.lock();
     m_antiAliasingType = type;
+    m_historyValid = false;
     float coeff = (m_antiAliasingType==SSAA) ? 2.0 : 1.0;
     Body::setPointSizeThreshold(coeff*10.0);
     if (m_galaxy) m_galaxy->setPointSizeCoeff(coeff);
@@ -158,6 +221,7 @@ void ViewItem::init()
         m_aaTypes << MSAA;
     m_aaTypes << SSAA;
     m_aaTypes << FXAA;
+    m_aaTypes << TAA;
     emit aaTypesChanged();
 
     glEnable( GL_DEPTH_TEST );
@@ -172,15 +236,40 @@ void ViewItem::init()
     glLineWidth(2.0);
 #endif
 
-    m_screenQuad = new ScreenQuad();
-
-    m_galaxy = new Galaxy();
+    // The CPU side of the scene is prepared on worker threads
+    // while this thread compiles the post-processing shaders.
+    m_catalog.load(resPath()+"data/data.txt");
+    const BodyDescriptor *sun = m_catalog.body("sun");
+    if (!sun)
+        qFatal("No sun in the catalog");
+    SceneLoader loader(m_catalog);
+    loader.start();
 
-    m_sun = new Body("sun");
+    m_screenQuad = new ScreenQuad();
+    m_labels = new LabelBatch();
+    Body::setLabels(m_labels);
+    m_points = new PointBatch();
+    Body::setPoints(m_points);
+    m_orbits = new OrbitBatch();
+    Body::setOrbits(m_orbits);
+    m_smallBodies = new KeplerBatch();
+    Body::setSmallBodies(m_smallBodies);
+    m_trails = new TrailBatch();
+    Body::setTrails(m_trails);
+    Body::setIntegrator(&m_integrator);
+
+    // GL upload
+    loader.waitForDone();
+    m_galaxy = new Galaxy(loader.stars());
+    m_sun = new Body(*sun, loader);
     addBody(m_sun);
+    // searchEvents() reads it on the GUI thread
+    EventSearch *eventSearch = new EventSearch(m_catalog);
+    m_mutex.lock();
+    m_eventSearch = eventSearch;
+    m_mutex.unlock();
 
     // We need the earth frame at J2000 for the galaxy
-    m_sun->setReferenceFrame(Eigen::Affine3d::Identity());
     m_sun->setTime(0.0);
     foreach (const Body* body, m_bodies) {
         if (body->name() == "earth") {
@@ -198,6 +287,8 @@ void ViewItem::init()
     // Use current time
     double time = m_timeline.currentTime();
     m_sun->setTime(time);
+    if (m_nBody)
+        startIntegrator(time);
     selectBody(m_sun);
 
     connect(m_camera, SIGNAL(positionChanged()), this, SIGNAL(distanceToGroundChanged()));
@@ -212,10 +303,11 @@ void ViewItem::init()
 
 void ViewItem::renderScene(int width, int height)
 {
-    Q_UNUSED(width)
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // The post-processing and Qt Quick change the state behind the cache
+    RenderState *state = RenderState::instance();
+    state->invalidate();
 
     const Eigen::Affine3d &mv = m_camera->modelView();
     const Eigen::Affine3d &p = m_camera->projection();
@@ -237,18 +329,28 @@ void ViewItem::renderScene(int width, int height)
 
     // Depth test is disabled when rendering the stars so we have to draw them first
     glDisable( GL_DEPTH_TEST );
+    m_galaxy->setViewport(width, height);
     m_galaxy->render(EME2000, mv, p);
     glEnable( GL_DEPTH_TEST );
-    // Sort the bodies by distance to camera, near to far
-    qSort(m_bodies.begin(), m_bodies.end(), Sort(this));
-    // First pass, render opaque objects near to far
-    for (int i = 0; i < m_bodies.size(); ++i) {
-        m_bodies.at(i)->render(mv, p, RenderMode::Opaque);
+    // First pass, opaque objects sorted by state then near to far
+    m_queue.begin(mv, p, RenderQueue::StateOrder);
+    foreach (Body* body, m_bodies) {
+        body->render(m_queue, RenderMode::Opaque);
     }
-    // Second pass, render transluscent objects far to near
-    for (int i = m_bodies.size()-1; i >= 0; --i) {
-        m_bodies.at(i)->render(mv, p, RenderMode::Translucent);
+    m_queue.submit();
+    // Second pass, transluscent objects far to near
+    m_queue.begin(mv, p, RenderQueue::BackToFront);
+    foreach (Body* body, m_bodies) {
+        body->render(m_queue, RenderMode::Translucent);
     }
+    m_queue.submit();
+    // Orbits, points and labels queued by the bodies, one draw each
+    m_orbits->render(Eigen::Affine3d::Identity(), mv, p);
+    m_smallBodies->render(Eigen::Affine3d::Identity(), mv, p);
+    m_trails->render(Eigen::Affine3d::Identity(), mv, p);
+    m_points->render(Eigen::Affine3d::Identity(), mv, p);
+    m_labels->render(Eigen::Affine3d::Identity(), mv, p);
+    state->reset();
 }
 
 void ViewItem::renderTo(QOpenGLFramebufferObject *fbo)
@@ -257,92 +359,174 @@ void ViewItem::renderTo(QOpenGLFramebufferObject *fbo)
     const Eigen::Affine3d &mv = m_camera->modelView();
     const Eigen::Affine3d &p = m_camera->projection();
 
-    if (m_nBlurPass > 0) {
+    // Only TAA keeps targets from one frame to the next
+    if ( (m_antiAliasingType != TAA) && m_historyFbo[0] ) {
+        delete m_historyFbo[0];
+        delete m_historyFbo[1];
+        m_historyFbo[0] = 0;
+        m_historyFbo[1] = 0;
+    }
+
+    // Nothing to glow when all light sources are off-screen or hidden.
+    // The glow spreads about 4<<(nBlurPass+1) pixels around the light source.
+    bool glow = (m_nBlurPass > 0) && lightSourceVisible(fbo->size().height(), 4 << (m_nBlurPass+1));
+
+    QOpenGLFramebufferObject *lightMap = 0;
+    if (glow) {
         // Generate light map, use a smaller fbo for efficiency
-        glViewport(0, 0, m_postProcessFbo1->size().width(),  m_postProcessFbo1->size().height());
-        m_postProcessFbo1->bind();
+        lightMap = m_targets.acquire(QSize(m_size.width()/4, m_size.height()/4), true);
+        glViewport(0, 0, lightMap->width(), lightMap->height());
+        lightMap->bind();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glEnable( GL_DEPTH_TEST );
+        RenderState::instance()->invalidate();
+        m_queue.begin(mv, p, RenderQueue::StateOrder);
         foreach (Body* body, m_bodies) {
-            body->render(mv, p, RenderMode::LightSource);
+            body->render(m_queue, RenderMode::LightSource);
         }
-        m_postProcessFbo1->release();
+        m_queue.submit();
+        RenderState::instance()->reset();
+        lightMap->release();
     }
 
-    for (int i = 0; i < m_nBlurPass; ++i) {
-        // Apply horizontal blur
-        m_postProcessFbo2->bind();
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glBindTexture(GL_TEXTURE_2D, m_postProcessFbo1->texture());
-        m_screenQuad->renderBlurred(Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity(), ScreenQuad::HorizontalBlur);
-        m_postProcessFbo2->release();
-
-        // Apply vertical blur
-        m_postProcessFbo1->bind();
+    // Glow: progressive downsampling then upsampling of the light map (dual filter),
+    // each level being half the size of the previous one. No depth needed.
+    QList<QOpenGLFramebufferObject*> bloomLevels;
+    QSize levelSize = lightMap ? QSize(lightMap->width()/2, lightMap->height()/2) : QSize();
+    while ( glow && (bloomLevels.size() < qMin(m_nBlurPass, (int)MaxBlurPass))
+          &&(levelSize.width() >= 2) && (levelSize.height() >= 2) ) {
+        bloomLevels.append(m_targets.acquire(levelSize));
+        levelSize = QSize(levelSize.width()/2, levelSize.height()/2);
+    }
+    int nLevels = bloomLevels.size();
+    for (int i = 0; i < nLevels; ++i) {
+        QOpenGLFramebufferObject *source = (i > 0) ? bloomLevels.at(i-1) : lightMap;
+        QOpenGLFramebufferObject *target = bloomLevels.at(i);
+        glViewport(0, 0, target->width(), target->height());
+        target->bind();
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBindTexture(GL_TEXTURE_2D, source->texture());
+        m_screenQuad->setBlurResolution(source->width(), source->height());
+        m_screenQuad->renderBlurred(Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity(), ScreenQuad::DownsampleBlur);
+        target->release();
+    }
+    for (int i = nLevels-1; i >= 0; --i) {
+        QOpenGLFramebufferObject *source = bloomLevels.at(i);
+        QOpenGLFramebufferObject *target = (i > 0) ? bloomLevels.at(i-1) : lightMap;
+        glViewport(0, 0, target->width(), target->height());
+        target->bind();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glBindTexture(GL_TEXTURE_2D, m_postProcessFbo2->texture());
-        m_screenQuad->renderBlurred(Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity(), ScreenQuad::VerticalBlur);
-        m_postProcessFbo1->release();
+        glBindTexture(GL_TEXTURE_2D, source->texture());
+        m_screenQuad->setBlurResolution(source->width(), source->height());
+        m_screenQuad->renderBlurred(Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity(), ScreenQuad::UpsampleBlur);
+        target->release();
     }
+    foreach (QOpenGLFramebufferObject *level, bloomLevels)
+        m_targets.release(level);
 
-    // Render the scene
+    // Render the scene, the last stage of each mode writes straight into the Qt Quick target
     if (m_antiAliasingType == MSAA) {
-        // Multisampled antialiasing
-        glViewport(0, 0, m_multiSampleFbo->size().width(),  m_multiSampleFbo->size().height());
-        m_multiSampleFbo->bind();
-        renderScene(m_multiSampleFbo->size().width(),  m_multiSampleFbo->size().height());
-        m_multiSampleFbo->release();
-        QOpenGLFramebufferObject::blitFramebuffer(m_simpleFbo, m_multiSampleFbo);
+        // Multisampled antialiasing, resolved by the blit
+        QOpenGLFramebufferObject *multiSampleFbo = m_targets.acquire(m_size, true, 4);
+        glViewport(0, 0, multiSampleFbo->width(), multiSampleFbo->height());
+        multiSampleFbo->bind();
+        renderScene(multiSampleFbo->width(), multiSampleFbo->height());
+        multiSampleFbo->release();
+        QOpenGLFramebufferObject::blitFramebuffer(fbo, multiSampleFbo);
+        m_targets.release(multiSampleFbo);
     } else if (m_antiAliasingType == SSAA) {
-        // Supersampled antialiasing
-        glViewport(0, 0, m_superSampleFbo->size().width(),  m_superSampleFbo->size().height());
-        m_superSampleFbo->bind();
+        // Supersampled antialiasing, resolved by the bilinear downsampling
+        QOpenGLFramebufferObject *superSampleFbo = m_targets.acquire(m_size*2, true);
+        glViewport(0, 0, superSampleFbo->width(), superSampleFbo->height());
+        superSampleFbo->bind();
         GLfloat lineWidth;
         glGetFloatv(GL_LINE_WIDTH, &lineWidth);
         glLineWidth(lineWidth*2.0);
-        renderScene(m_superSampleFbo->size().width(),  m_superSampleFbo->size().height());
+        renderScene(superSampleFbo->width(), superSampleFbo->height());
         glLineWidth(lineWidth);
-        m_superSampleFbo->release();
-    } else {
-        // No antialiasing
-        glViewport(0, 0, m_simpleFbo->size().width(),  m_simpleFbo->size().height());
-        m_simpleFbo->bind();
-        renderScene(m_simpleFbo->size().width(),  m_simpleFbo->size().height());
-        m_simpleFbo->release();
+        superSampleFbo->release();
 
-        if (m_antiAliasingType == FXAA) {
-            m_simpleFbo2->bind();
+        glViewport(0, 0, fbo->width(), fbo->height());
+        fbo->bind();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBindTexture(GL_TEXTURE_2D, superSampleFbo->texture());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        m_screenQuad->render(Eigen::Affine3d::Identity(),Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity());
+        fbo->release();
+        m_targets.release(superSampleFbo);
+    } else if ( (m_antiAliasingType == TAA) || (m_antiAliasingType == FXAA) ) {
+        if (m_antiAliasingType == TAA) {
+            // Temporal antialiasing, move the projection by a subpixel offset every frame
+            m_frameIndex = (m_frameIndex+1)%8;
+            Eigen::Vector2d jitter(halton(m_frameIndex+1, 2)-0.5, halton(m_frameIndex+1, 3)-0.5);
+            m_camera->setJitter(2.0*jitter.cwiseQuotient(Eigen::Vector2d(m_size.width(), m_size.height())));
+        }
+        QOpenGLFramebufferObject *sceneFbo = m_targets.acquire(m_size, true);
+        glViewport(0, 0, sceneFbo->width(), sceneFbo->height());
+        sceneFbo->bind();
+        renderScene(sceneFbo->width(), sceneFbo->height());
+        sceneFbo->release();
+
+        if (m_antiAliasingType == TAA) {
+            m_camera->setJitter(Eigen::Vector2d::Zero());
+            if (!m_historyFbo[0]) {
+                m_historyFbo[0] = new QOpenGLFramebufferObject(m_size);
+                m_historyFbo[1] = new QOpenGLFramebufferObject(m_size);
+                m_historyValid = false;
+            }
+            // Accumulate into the history
+            QOpenGLFramebufferObject *history = m_historyFbo[1-m_historyIndex];
+            QOpenGLFramebufferObject *resolved = m_historyFbo[m_historyIndex];
+            resolved->bind();
+            glClear(GL_COLOR_BUFFER_BIT);
+            glViewport(0, 0, resolved->width(), resolved->height());
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, history->texture());
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, sceneFbo->texture());
+            m_screenQuad->setResolution(resolved->width(), resolved->height());
+            m_screenQuad->renderTAA(Eigen::Affine3d::Identity(),Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity(),
+                                    m_historyValid ? 0.9 : 0.0);
+            resolved->release();
+            m_historyValid = true;
+            m_historyIndex = 1-m_historyIndex;
+
+            // The history is read again next frame, so it can't be the Qt Quick target
+            QOpenGLFramebufferObject::blitFramebuffer(fbo, resolved);
+        } else {
+            glViewport(0, 0, fbo->width(), fbo->height());
+            fbo->bind();
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glViewport(0, 0, m_simpleFbo2->size().width(),  m_simpleFbo2->size().height());
-            glBindTexture(GL_TEXTURE_2D, m_simpleFbo->texture());
+            glBindTexture(GL_TEXTURE_2D, sceneFbo->texture());
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            m_screenQuad->setResolution(m_simpleFbo2->width(), m_simpleFbo2->height());
+            m_screenQuad->setResolution(fbo->width(), fbo->height());
             m_screenQuad->renderFXAA(Eigen::Affine3d::Identity(),Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity());
-            m_simpleFbo2->release();
+            fbo->release();
         }
+        m_targets.release(sceneFbo);
+    } else {
+        // No antialiasing
+        glViewport(0, 0, fbo->width(), fbo->height());
+        fbo->bind();
+        renderScene(fbo->width(), fbo->height());
+        fbo->release();
     }
 
-    QOpenGLFramebufferObject *sceneFbo = (m_antiAliasingType == SSAA) ? m_superSampleFbo : m_simpleFbo;
-    if (m_antiAliasingType == FXAA) sceneFbo = m_simpleFbo2;
-    glViewport(0, 0, fbo->size().width(),  fbo->size().height());
-    fbo->bind();
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    if (m_nBlurPass > 0) {
-        // Add the blurred texture to the scene
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, m_postProcessFbo1->texture());
+    if (glow) {
+        // Add the blurred light map on top of the scene
+        glViewport(0, 0, fbo->width(), fbo->height());
+        fbo->bind();
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glBindTexture(GL_TEXTURE_2D, lightMap->texture());
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, sceneFbo->texture());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        m_screenQuad->renderCombinedTextures(Eigen::Affine3d::Identity(),Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity());
-    } else {
-         // No blur, just the scene texture
-        glBindTexture(GL_TEXTURE_2D, sceneFbo->texture());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        m_screenQuad->render(Eigen::Affine3d::Identity(),Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity());
+        m_screenQuad->renderGlow(Eigen::Affine3d::Identity(),Eigen::Affine3d::Identity(), Eigen::Affine3d::Identity());
+        glDisable(GL_BLEND);
+        fbo->release();
+        m_targets.release(lightMap);
     }
-    fbo->release();
+    m_targets.endFrame();
 
     m_mutex.unlock();
 }
@@ -352,29 +536,16 @@ void ViewItem::resizeGL(int width, int height)
     m_mutex.lock();
     m_camera->setAspectRatio((float)width/(float)height);
 
-    QOpenGLFramebufferObjectFormat fboFormat;
-    fboFormat.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
-    fboFormat.setSamples(4);
-
-    int smallWidth = width/4;
-    int smallHeight = height/4;
-    if (m_multiSampleFbo) delete m_multiSampleFbo;
-    m_multiSampleFbo = new QOpenGLFramebufferObject(width, height, fboFormat);
-
-    fboFormat.setSamples(0);
-    if (m_superSampleFbo) delete m_superSampleFbo;
-    m_superSampleFbo = new QOpenGLFramebufferObject(width*2, height*2, fboFormat);
-    if (m_simpleFbo) delete m_simpleFbo;
-    m_simpleFbo = new QOpenGLFramebufferObject(width, height, fboFormat);
-    if (m_simpleFbo2) delete m_simpleFbo2;
-    m_simpleFbo2 = new QOpenGLFramebufferObject(width, height, fboFormat);
-    if (m_postProcessFbo2) delete m_postProcessFbo2;
-    m_postProcessFbo2 = new QOpenGLFramebufferObject(smallWidth, smallHeight, fboFormat);
-    if (m_postProcessFbo1) delete m_postProcessFbo1;
-    m_postProcessFbo1 = new QOpenGLFramebufferObject(smallWidth, smallHeight, fboFormat);
-
-    m_screenQuad->setBlurResolution(smallWidth, smallHeight);
-    TextBillboard::setResolution(QSizeF(width, height));
+    // Render targets are created on demand for the new size
+    m_size = QSize(width, height);
+    m_targets.clear();
+    delete m_historyFbo[0];
+    delete m_historyFbo[1];
+    m_historyFbo[0] = 0;
+    m_historyFbo[1] = 0;
+    m_historyValid = false;
+
+    LabelBatch::setResolution(QSizeF(width, height));
     m_mutex.unlock();
 }
 
@@ -393,6 +564,7 @@ void ViewItem::selectBody(Body *body)
 {
     m_mutex.lock();
     m_selectedBody = body;
+    m_labels->setSelectedLabel(body->label());
 
     m_camera->setCenter(body->center());
     m_camera->setSceneRadius(body->radius()*1.3);
@@ -406,9 +578,12 @@ void ViewItem::animate()
 {
     m_mutex.lock();
     Eigen::Vector3d oldBodyCenterd = m_selectedBody->center();
-    m_sun->setReferenceFrame(Eigen::Affine3d::Identity());
 
     double time = m_timeline.currentTime();
+    // Too far from the integrated state for a frame, after a jump in time or at
+    // a time-lapse faster than the integrator follows: start again from the elements
+    if (m_integrator.isRunning() && !m_integrator.integrate(time))
+        startIntegrator(time);
     m_sun->setTime(time);
 
     Eigen::Vector3d bodyCenter = m_selectedBody->center();
@@ -419,18 +594,36 @@ void ViewItem::animate()
     m_mutex.unlock();
 }
 
+void ViewItem::startIntegrator(double time)
+{
+    // The elements are placed in the frames of the Keplerian orbits
+    m_integrator.stop();
+    m_sun->setTime(time);
+    m_sun->initializeIntegrator(time);
+    m_integrator.start(time);
+}
+
 void ViewItem::pickObject(int x, int y)
 {
-    glViewport(0, 0, m_simpleFbo->size().width(),  m_simpleFbo->size().height());
-    m_simpleFbo->bind();
+    // Shares the pool with the passes of the frame, freed again when picking stops
+    QOpenGLFramebufferObject *pickingFbo = m_targets.acquire(m_size, true);
+    glViewport(0, 0, pickingFbo->width(), pickingFbo->height());
+    pickingFbo->bind();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glEnable( GL_DEPTH_TEST );
+    RenderState::instance()->invalidate();
+    m_queue.begin(m_camera->modelView(), m_camera->projection(), RenderQueue::StateOrder);
     foreach (Body* body, m_bodies) {
-        body->render(m_camera->modelView(), m_camera->projection(), RenderMode::Picking);
+        body->render(m_queue, RenderMode::Picking);
     }
-    m_simpleFbo->release();
-
-    QRgb color = m_simpleFbo->toImage().pixel(x, y);
+    m_queue.submit();
+    m_points->renderSolidColor(Eigen::Affine3d::Identity(), m_camera->modelView(), m_camera->projection());
+    m_labels->renderSolidColor(Eigen::Affine3d::Identity(), m_camera->modelView(), m_camera->projection());
+    RenderState::instance()->reset();
+    pickingFbo->release();
+
+    QRgb color = pickingFbo->toImage().pixel(x, y);
+    m_targets.release(pickingFbo);
     int ob = qRed(color)*256*256+qGreen(color)*256+qBlue(color);
 
     foreach (Body* body, m_bodies) {
@@ -465,6 +658,73 @@ void ViewItem::setShowOrbits(bool showOrbits)
     emit showOrbitsChanged();
 }
 
+void ViewItem::setShowTrails(bool showTrails)
+{
+    Body::setShowTrail(showTrails);
+    emit showTrailsChanged();
+}
+
+void ViewItem::setNBody(bool nBody)
+{
+    m_mutex.lock();
+    m_nBody = nBody;
+    // Before init, the bodies do not exist yet
+    if (m_sun) {
+        if (m_nBody)
+            startIntegrator(m_timeline.currentTime());
+        else
+            m_integrator.stop();
+    }
+    m_mutex.unlock();
+    emit nBodyChanged();
+}
+
+void ViewItem::searchEvents()
+{
+    m_mutex.lock();
+    // Before init, the catalog is not loaded yet
+    const EventSearch *search = m_eventSearch;
+    double start = m_timeline.currentTime();
+    m_mutex.unlock();
+    if (!search)
+        return;
+    // Already searched, or being searched, from about the same time
+    if ((m_searchId.load() > 0) && (qAbs(start-m_eventsStart) < EventSearch::ScanStep))
+        return;
+    m_eventsStart = start;
+    m_searchId.ref();
+    m_searchPool.start(new EventSearchJob(*search, start, m_searchId, this));
+}
+
+void ViewItem::setEvents(int id, const QVector<Event> &events)
+{
+    // Only the latest search is kept
+    if (id != m_searchId.load())
+        return;
+    m_events = events;
+    m_eventNames.clear();
+    foreach (const Event &event, m_events) {
+        m_eventNames.append(Timeline::toDateTime(event.time).toUTC().toString("yyyy-MM-dd hh:mm")+" "+event.description);
+    }
+    emit eventsChanged();
+}
+
+void ViewItem::goToEvent(int index)
+{
+    if ((index < 0) || (index >= m_events.size()))
+        return;
+    const Event &event = m_events.at(index);
+    m_mutex.lock();
+    m_timeline.setDateTime(Timeline::toDateTime(event.time));
+    // The search uses the Keplerian orbits and the ephemerides
+    if (m_nBody)
+        startIntegrator(event.time);
+    m_mutex.unlock();
+    m_timeline.pause();
+    goToObject(event.body);
+    emit dateUpdated();
+}
+
 void ViewItem::keyPressEvent(QKeyEvent *event)
 {
     switch (event->key())
@@ -491,6 +751,10 @@ void ViewItem::keyPressEvent(QKeyEvent *event)
         Body::setShowOrbit(!Body::showOrbit());
         emit showOrbitsChanged();
         break;
+    case Qt::Key_T :
+        Body::setShowTrail(!Body::showTrail());
+        emit showTrailsChanged();
+        break;
     case Qt::Key_F :
         if (window()->visibility() == QWindow::FullScreen)
             window()->showMaximized();
@@ -602,13 +866,49 @@ void ViewItem::zoom(qreal delta)
     m_mutex.unlock();
 }
 
-bool ViewItem::closerToCamera(const Body* body1, const Body* body2)
+bool ViewItem::lightSourceVisible(int height, int glowRadius) const
 {
-    Eigen::Vector3d camPos = m_camera->position();
-
-    double d1 = (body1->center()-camPos).norm();
-    double d2 = (body2->center()-camPos).norm();
-    return d1 < d2;
+    const Eigen::Affine3d &mv = m_camera->modelView();
+    const Eigen::Vector3d camPos = m_camera->position();
+    // View frustum widened by the glow radius
+    const double tanV = tan(qDegreesToRadians(m_camera->fov())/2.0)*(1.0+2.0*glowRadius/(double)height);
+    const double tanH = tanV*m_camera->aspectRatio();
+    const double normV = sqrt(1.0+tanV*tanV);
+    const double normH = sqrt(1.0+tanH*tanH);
+
+    foreach (const Body* light, m_bodies) {
+        if (!light->isLightSource())
+            continue;
+        // Frustum culling in eye coordinates, the camera looks down -z
+        Eigen::Vector3d c = mv*light->center();
+        double r = light->radius();
+        if ( (c.z() > r)
+           ||((c.x()+tanH*c.z())/normH > r) || ((-c.x()+tanH*c.z())/normH > r)
+           ||((c.y()+tanV*c.z())/normV > r) || ((-c.y()+tanV*c.z())/normV > r) ) {
+            continue;
+        }
+        // Occlusion by a body closer to the camera, covering the whole light disc
+        Eigen::Vector3d toLight = light->center()-camPos;
+        double lightDistance = toLight.norm();
+        double lightAngle = asin(qMin(1.0, r/lightDistance));
+        bool occluded = false;
+        foreach (const Body* body, m_bodies) {
+            if (body == light)
+                continue;
+            Eigen::Vector3d toBody = body->center()-camPos;
+            double distance = toBody.norm();
+            if ( (distance >= lightDistance) || (distance <= body->radius()) )
+                continue;
+            double separation = acos(qBound(-1.0, toBody.dot(toLight)/(distance*lightDistance), 1.0));
+            if (asin(body->radius()/distance) >= separation+lightAngle) {
+                occluded = true;
+                break;
+            }
+        }
+        if (!occluded)
+            return true;
+    }
+    return false;
 }
 
 #include "viewitem.moc"
@@ -3,13 +3,18 @@
 
 #include "camera.h"
 #include "body.h"
+#include "catalog.h"
+#include "eventsearch.h"
 #include "timeline.h"
 #include "renderable/galaxy.h"
 #include "renderable/screenquad.h"
+#include "renderable/rendertargetpool.h"
 
 #include <QQuickItem>
 #include <QOpenGLFramebufferObject>
 #include <QMutex>
+#include <QThreadPool>
+#include <QAtomicInt>
 #include <QStringList>
 
 class TextureNode;
@@ -27,7 +32,10 @@ class ViewItem : public QQuickItem, protected QOpenGLFunctions
     Q_PROPERTY(QStringList bodies READ bodies NOTIFY bodyAdded)
     Q_PROPERTY(bool showAxis READ showAxis WRITE setShowAxis NOTIFY showAxisChanged)
     Q_PROPERTY(bool showOrbits READ showOrbits WRITE setShowOrbits NOTIFY showOrbitsChanged)
+    Q_PROPERTY(bool showTrails READ showTrails WRITE setShowTrails NOTIFY showTrailsChanged)
+    Q_PROPERTY(bool nBody READ nBody WRITE setNBody NOTIFY nBodyChanged)
     Q_PROPERTY(qint64 timeLineRate READ timeLineRate NOTIFY timeLineRateChanged)
+    Q_PROPERTY(QStringList events READ events NOTIFY eventsChanged)
 
 public:
 
@@ -35,9 +43,13 @@ public:
         NOAA = 0,
         MSAA = 1,
         SSAA = 2,
-        FXAA = 3
+        FXAA = 3,
+        TAA = 4
     };
 
+    // Glow levels, each one halves the resolution
+    static const int MaxBlurPass = 8;
+
     explicit ViewItem(QQuickItem * parent = 0);
     ~ViewItem();
     QString date() const {return m_timeline.dateTime().toString();}
@@ -54,6 +66,20 @@ public:
     void setShowAxis(bool showAxis);
     bool showOrbits() {return Body::showOrbit();}
     void setShowOrbits(bool showOrbits);
+    // The paths really followed, N-body motion and ephemerides included
+    bool showTrails() {return Body::showTrail();}
+    void setShowTrails(bool showTrails);
+    // Mutual perturbations instead of the Keplerian orbits and the ephemerides
+    bool nBody() const {return m_nBody;}
+    void setNBody(bool nBody);
+    // Eclipses, conjunctions, oppositions and closest approaches seen from
+    // the earth, over the century from the current time
+    QStringList events() const {return m_eventNames;}
+    // In the background, eventsChanged is emitted once the century from the
+    // current time is searched. Does nothing if the last search started
+    // less than a day away from it.
+    Q_INVOKABLE void searchEvents();
+    Q_INVOKABLE void goToEvent(int index);
 
     void renderTo(QOpenGLFramebufferObject *fbo);
     void pickObject(int x, int y);
@@ -73,7 +99,10 @@ signals:
     void bodyAdded();
     void showAxisChanged();
     void showOrbitsChanged();
+    void showTrailsChanged();
+    void nBodyChanged();
     void timeLineRateChanged();
+    void eventsChanged();
     void nBlurChanged();
     void antialiasingTypeChanged();
     void aaTypesChanged();
@@ -90,6 +119,8 @@ protected:
 
 private slots:
     void animate();
+    // Queued by the search job, id is that of the search
+    void setEvents(int id, const QVector<Event> &events);
 
 private:
     void init();
@@ -98,17 +129,17 @@ private:
     void addBody(Body *body);
     void selectBody(Body* body);
     void zoom(qreal delta);
+    void startIntegrator(double time);
 
-    bool closerToCamera(const Body* body1, const Body* body2);
+    bool lightSourceVisible(int height, int glowRadius) const;
 
     QMutex m_mutex;
 
-    QOpenGLFramebufferObject *m_multiSampleFbo;
-    QOpenGLFramebufferObject *m_superSampleFbo;
-    QOpenGLFramebufferObject *m_simpleFbo;
-    QOpenGLFramebufferObject *m_simpleFbo2;
-    QOpenGLFramebufferObject *m_postProcessFbo1;
-    QOpenGLFramebufferObject *m_postProcessFbo2;
+    RenderTargetPool m_targets;
+    QOpenGLFramebufferObject *m_historyFbo[2];
+    int m_historyIndex;
+    bool m_historyValid;
+    int m_frameIndex;
     ScreenQuad *m_screenQuad;
     int m_nBlurPass;
     int m_antiAliasingType;
@@ -122,23 +153,26 @@ private:
     QSize m_size;
 
     Galaxy *m_galaxy;
+    LabelBatch *m_labels;
+    PointBatch *m_points;
+    OrbitBatch *m_orbits;
+    KeplerBatch *m_smallBodies;
+    TrailBatch *m_trails;
+    RenderQueue m_queue;
+    Catalog m_catalog;
+    EventSearch *m_eventSearch;
+    QThreadPool m_searchPool;
+    double m_eventsStart; // Of the last search
+    QAtomicInt m_searchId; // Of the last search, 0 before the first one
+    QVector<Event> m_events;
+    QStringList m_eventNames;
     Body *m_sun;
+    NBodyIntegrator m_integrator;
+    bool m_nBody;
     QList<Body*> m_bodies;
     QStringList m_bodiesNames;
     Eigen::Affine3d EME2000;
 
-    class Sort
-    {
-    public:
-        Sort(ViewItem* p) : m(p) {}
-        bool operator() ( const Body* body1, const Body* body2 )
-        {
-            return m->closerToCamera(body1, body2);
-        }
-    private:
-        ViewItem* m;
-    };
-
 };
 
 #endif // VIEWITEM_H